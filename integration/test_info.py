@@ -38,6 +38,10 @@ class TestVSSBasic(ValkeySearchTestCaseBase):
             "search_string_interning_store_size",
             "search_string_interning_memory_bytes",
             "search_string_interning_memory_human", # less than 1KiB
+            "search_huge_page_arena_region_count",
+            "search_huge_page_arena_mapped_bytes",
+            "search_huge_page_arena_advised_bytes",
+            "search_huge_page_arena_map_failure_count",
             "search_vector_externing_entry_count",
             "search_vector_externing_hash_extern_errors",
             "search_vector_externing_generated_value_cnt",
@@ -53,7 +57,10 @@ class TestVSSBasic(ValkeySearchTestCaseBase):
             "search_total_active_write_threads",
             "search_total_indexing_time",
             "search_used_memory_bytes",
-            "search_index_reclaimable_memory"
+            "search_index_reclaimable_memory",
+            "search_index_content_hashes_memory_bytes",
+            "search_index_mutation_sequences_memory_bytes",
+            "search_index_stored_fields_memory_bytes"
         ]
 
         string_fields = [
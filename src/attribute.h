@@ -8,6 +8,7 @@
 #ifndef VALKEYSEARCH_SRC_ATTRIBUTE_H_
 #define VALKEYSEARCH_SRC_ATTRIBUTE_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -15,6 +16,7 @@
 #include "absl/strings/string_view.h"
 #include "src/index_schema.pb.h"
 #include "src/indexes/index_base.h"
+#include "src/stored_field.h"
 #include "vmsdk/src/managed_pointers.h"
 #include "vmsdk/src/valkey_module_api/valkey_module.h"
 
@@ -23,16 +25,35 @@ namespace valkey_search {
 class Attribute {
  public:
   Attribute(absl::string_view alias, absl::string_view identifier,
-            std::shared_ptr<indexes::IndexBase> index)
-      : alias_(alias), identifier_(identifier), index_(index) {}
+            std::shared_ptr<indexes::IndexBase> index, size_t position = 0,
+            bool sortable = false)
+      : alias_(alias),
+        identifier_(identifier),
+        index_(index),
+        position_(position),
+        sortable_(sortable) {
+    // Vector indexes return their vectors themselves.
+    auto type = index_->GetIndexerType();
+    if (sortable_ && type != indexes::IndexerType::kVector &&
+        type != indexes::IndexerType::kHNSW &&
+        type != indexes::IndexerType::kFlat) {
+      stored_field_ = std::make_shared<StoredField>();
+    }
+  }
   inline const std::string& GetAlias() const { return alias_; }
   inline const std::string& GetIdentifier() const { return identifier_; }
+  // The order in which the attribute was added to its schema.
+  inline size_t GetPosition() const { return position_; }
+  inline bool IsSortable() const { return sortable_; }
+  // The raw values of a SORTABLE attribute, null for other attributes.
+  inline StoredField* GetStoredField() const { return stored_field_.get(); }
   std::shared_ptr<indexes::IndexBase> GetIndex() const { return index_; }
   std::unique_ptr<data_model::Attribute> ToProto() const {
     auto attribute_proto = std::make_unique<data_model::Attribute>();
     attribute_proto->set_alias(alias_);
     attribute_proto->set_identifier(identifier_);
     attribute_proto->set_allocated_index(index_->ToProto().release());
+    attribute_proto->set_sortable(sortable_);
     return attribute_proto;
   }
   inline int RespondWithInfo(ValkeyModuleCtx* ctx) const {
@@ -58,6 +79,9 @@ class Attribute {
   std::string alias_;
   std::string identifier_;
   std::shared_ptr<indexes::IndexBase> index_;
+  size_t position_;
+  bool sortable_;
+  std::shared_ptr<StoredField> stored_field_;
   // Maintaining a cached version
   mutable vmsdk::UniqueValkeyString cached_score_as_;
 };
@@ -10,15 +10,21 @@
 #include "fanout.h"
 #include "ft_create_parser.h"
 #include "src/acl.h"
+#include "src/commands/ft_aggregate_partition.h"
 #include "src/commands/ft_search.h"
 #include "src/coordinator/metadata_manager.h"
 #include "src/query/fanout.h"
+#include "src/query/response_generator.h"
 #include "src/query/search.h"
 #include "src/schema_manager.h"
 #include "src/valkey_search.h"
 #include "valkey_search_options.h"
 #include "vmsdk/src/cluster_map.h"
+#include "vmsdk/src/blocked_client.h"
 #include "vmsdk/src/debug.h"
+#include "vmsdk/src/managed_pointers.h"
+#include "vmsdk/src/thread_pool.h"
+#include "vmsdk/src/utils.h"
 
 namespace valkey_search {
 namespace async {
@@ -63,6 +69,74 @@ void Free([[maybe_unused]] ValkeyModuleCtx *ctx, void *privdata) {
   delete result;
 }
 
+// Prepares the reply on the current reader thread, then hands the result
+// over.
+void PrepareReplyNow(vmsdk::BlockedClient blocked_client,
+                     std::unique_ptr<Result> result) {
+  auto status = result->parameters->PrepareReply(result->neighbors.value());
+  if (!status.ok()) {
+    result->neighbors = status;
+  }
+  blocked_client.SetReplyPrivateData(result.release());
+}
+
+// Prepares the reply on a reader thread, then hands the result over.
+void PrepareReply(vmsdk::BlockedClient blocked_client,
+                  std::unique_ptr<Result> result) {
+  ValkeySearch::Instance().GetReaderThreadPool()->Schedule(
+      [blocked_client = std::move(blocked_client),
+       result = std::move(result)]() mutable {
+        PrepareReplyNow(std::move(blocked_client), std::move(result));
+      },
+      vmsdk::ThreadPool::Priority::kHigh);
+}
+
+// Fetches the content of the neighbors in the database of the query, on the
+// calling thread.
+absl::Status FetchReplyContent(Result &result) {
+  auto ctx = vmsdk::MakeUniqueValkeyThreadSafeContext(nullptr);
+  ValkeyModule_SelectDb(ctx.get(), result.parameters->db_num);
+  return result.parameters->FetchReplyContent(ctx.get(),
+                                              result.neighbors.value());
+}
+
+// Fetches the content of the neighbors, if needed, then prepares the reply on
+// a reader thread. The content is fetched on the main thread, unless a content
+// fetch batch size is set, when the reader thread fetches it under the GIL.
+// The client stays blocked until the result is handed over for the reply.
+void OffloadReply(vmsdk::BlockedClient blocked_client,
+                  std::unique_ptr<Result> result) {
+  if (!result->parameters->FetchesReplyContent()) {
+    PrepareReply(std::move(blocked_client), std::move(result));
+    return;
+  }
+  if (options::GetContentFetchBatchSize().GetValue() > 0) {
+    ValkeySearch::Instance().GetReaderThreadPool()->Schedule(
+        [blocked_client = std::move(blocked_client),
+         result = std::move(result)]() mutable {
+          auto status = FetchReplyContent(*result);
+          if (!status.ok()) {
+            result->neighbors = status;
+            blocked_client.SetReplyPrivateData(result.release());
+            return;
+          }
+          PrepareReplyNow(std::move(blocked_client), std::move(result));
+        },
+        vmsdk::ThreadPool::Priority::kHigh);
+    return;
+  }
+  vmsdk::RunByMain([blocked_client = std::move(blocked_client),
+                    result = std::move(result)]() mutable {
+    auto status = FetchReplyContent(*result);
+    if (!status.ok()) {
+      result->neighbors = status;
+      blocked_client.SetReplyPrivateData(result.release());
+      return;
+    }
+    PrepareReply(std::move(blocked_client), std::move(result));
+  });
+}
+
 }  // namespace async
 
 CONTROLLED_BOOLEAN(ForceReplicasOnly, false);
@@ -128,6 +202,10 @@ absl::Status QueryCommand::Execute(ValkeyModuleCtx *ctx,
           .neighbors = std::move(neighbors),
           .parameters = std::move(upcast_parameters),
       });
+      if (result->neighbors.ok() && result->parameters->OffloadsReply()) {
+        async::OffloadReply(std::move(blocked_client), std::move(result));
+        return;
+      }
       blocked_client.SetReplyPrivateData(result.release());
     };
 
@@ -155,6 +233,14 @@ absl::Status QueryCommand::Execute(ValkeyModuleCtx *ctx,
             parameters->index_schema->GetVersion());
       }
 
+      if (parameters->FansOutPipeline()) {
+        return aggregate::PerformAggregateFanoutAsync(
+            ctx, search_targets,
+            ValkeySearch::Instance().GetCoordinatorClientPool(),
+            std::move(parameters),
+            ValkeySearch::Instance().GetReaderThreadPool(),
+            std::move(on_done_callback));
+      }
       return query::fanout::PerformSearchFanoutAsync(
           ctx, search_targets,
           ValkeySearch::Instance().GetCoordinatorClientPool(),
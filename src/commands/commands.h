@@ -40,6 +40,7 @@ constexpr absl::string_view kListCommand{"FT._LIST"};
 constexpr absl::string_view kSearchCommand{"FT.SEARCH"};
 constexpr absl::string_view kDebugCommand{"FT._DEBUG"};
 constexpr absl::string_view kAggregateCommand{"FT.AGGREGATE"};
+constexpr absl::string_view kCursorCommand{"FT.CURSOR"};
 
 const absl::flat_hash_set<absl::string_view> kCreateCmdPermissions{
     kSearchCategory, kWriteCategory, kFastCategory};
@@ -76,6 +77,8 @@ absl::Status FTDebugCmd(ValkeyModuleCtx *ctx, ValkeyModuleString **argv,
                         int argc);
 absl::Status FTAggregateCmd(ValkeyModuleCtx *ctx, ValkeyModuleString **argv,
                             int argc);
+absl::Status FTCursorCmd(ValkeyModuleCtx *ctx, ValkeyModuleString **argv,
+                         int argc);
 
 //
 // Common stuff for FT.SEARCH and FT.AGGREGATE command
@@ -97,6 +100,29 @@ struct QueryCommand : public query::SearchParameters {
   //
   virtual void SendReply(ValkeyModuleCtx *ctx,
                          std::deque<indexes::Neighbor> &neighbors) = 0;
+  //
+  // Commands which post-process the neighbors before SendReply may move that
+  // work off the main thread. When OffloadsReply() is true, the asynchronous
+  // path calls FetchReplyContent on the main thread, since it needs the
+  // keyspace, then PrepareReply on a reader thread, and only then unblocks
+  // the client for SendReply. Commands which don't need the keyspace return
+  // false from FetchesReplyContent, skipping the trip to the main thread.
+  //
+  virtual bool OffloadsReply() const { return false; }
+  virtual bool FetchesReplyContent() const { return true; }
+  virtual absl::Status FetchReplyContent(
+      ValkeyModuleCtx *ctx, std::deque<indexes::Neighbor> &neighbors) {
+    return absl::OkStatus();
+  }
+  virtual absl::Status PrepareReply(std::deque<indexes::Neighbor> &neighbors) {
+    return absl::OkStatus();
+  }
+  //
+  // In cluster mode, commands which can run their post-processing on each
+  // partition fan out through AggregateIndexPartition rather than collecting
+  // the neighbors of every partition.
+  //
+  virtual bool FansOutPipeline() const { return false; }
 };
 
 namespace async {
@@ -4,18 +4,33 @@
  * SPDX-License-Identifier: BSD 3-Clause
  */
 
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <ranges>
+#include <utility>
+#include <vector>
 
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "ft_search_parser.h"
 #include "src/commands/commands.h"
 #include "src/commands/ft_aggregate_exec.h"
+#include "src/commands/ft_cursor.h"
 #include "src/index_schema.h"
 #include "src/indexes/index_base.h"
+#include "src/indexes/numeric.h"
+#include "src/indexes/tag.h"
 #include "src/metrics.h"
+#include "src/query/predicate_program.h"
 #include "src/query/response_generator.h"
+#include "src/stored_field.h"
+#include "src/valkey_search_options.h"
+#include "vmsdk/src/time_sliced_mrmw_mutex.h"
 
 namespace valkey_search {
 namespace aggregate {
@@ -78,6 +93,19 @@ absl::Status ManipulateReturnsClause(AggregateParameters &params) {
     }
   }
   params.no_content = !content;
+  // Tag and numeric LOADs are read from their indexes on a reader thread by
+  // MakeRecords, rather than from the keyspace on the main thread.
+  params.reads_indexed_content = std::ranges::all_of(
+      params.return_attributes, [&](const query::ReturnAttribute &attribute) {
+        if (!attribute.attribute_alias) {
+          return false;
+        }
+        auto index = params.index_schema->GetIndex(
+            vmsdk::ToStringView(attribute.attribute_alias.get()));
+        return index.ok() &&
+               ((*index)->GetIndexerType() == indexes::IndexerType::kTag ||
+                (*index)->GetIndexerType() == indexes::IndexerType::kNumeric);
+      });
   return absl::OkStatus();
 }
 
@@ -87,6 +115,9 @@ absl::Status AggregateParameters::ParseCommand(vmsdk::ArgsIterator &itr) {
   RealIndexInterface real_index_interface(index_schema);
   parse_vars_.index_interface_ = &real_index_interface;
 
+  for (auto args = itr; args.HasNext(); args.Next()) {
+    arguments_.emplace_back(vmsdk::RetainUniqueValkeyString(*args.Get()));
+  }
   VMSDK_RETURN_IF_ERROR(PreParseQueryString(*this));
   // Ensure that key is first value if it gets included...
   CHECK(AddRecordAttribute("__key", "__key", indexes::IndexerType::kNone) == 0);
@@ -164,65 +195,166 @@ bool ReplyWithValue(ValkeyModuleCtx *ctx,
   return true;
 }
 
-absl::Status SendReplyInner(ValkeyModuleCtx *ctx,
-                            std::deque<indexes::Neighbor> &neighbors,
-                            AggregateParameters &parameters) {
-  auto identifier =
-      parameters.index_schema->GetIdentifier(parameters.attribute_alias);
-  if (!identifier.ok()) {
-    ++Metrics::GetStats().query_failed_requests_cnt;
-    return identifier.status();
+AggregateParameters::AggregateParameters(int db_num)
+    : QueryCommand(db_num) {}
+
+AggregateParameters::~AggregateParameters() = default;
+
+absl::Status AggregateParameters::FetchReplyContent(
+    ValkeyModuleCtx *ctx, std::deque<indexes::Neighbor> &neighbors) {
+  if (reads_indexed_content) {
+    return absl::OkStatus();
   }
+  if (IsNonVectorQuery()) {
+    query::ProcessNonVectorNeighborsForReply(
+        ctx, index_schema->GetAttributeDataType(), neighbors, *this);
+    return absl::OkStatus();
+  }
+  VMSDK_ASSIGN_OR_RETURN(auto identifier,
+                         index_schema->GetIdentifier(attribute_alias));
+  query::ProcessNeighborsForReply(ctx, index_schema->GetAttributeDataType(),
+                                  neighbors, *this, identifier);
+  return absl::OkStatus();
+}
 
-  query::ProcessNeighborsForReply(
-      ctx, parameters.index_schema->GetAttributeDataType(), neighbors,
-      parameters, identifier.value());
+// The value of the key in a tag or numeric index. Numbers stay doubles. The
+// values of a SORTABLE attribute are read as written from its stored field,
+// which RETURN serves as well, then parsed as a fetched value would be.
+static expr::Value GetIndexedValue(const indexes::IndexBase &index,
+                                   const StoredField *stored_field,
+                                   const InternedStringPtr &key,
+                                   expr::Arena &arena) {
+  if (stored_field != nullptr) {
+    auto value = stored_field->Get(key);
+    if (!value) {
+      return expr::Value();
+    }
+    if (index.GetIndexerType() == indexes::IndexerType::kNumeric) {
+      auto number = vmsdk::To<double>(value->Str());
+      return number.ok() ? expr::Value(*number) : expr::Value();
+    }
+    return expr::Value::MakeString(value->Str(), &arena);
+  }
+  switch (index.GetIndexerType()) {
+    case indexes::IndexerType::kNumeric: {
+      auto value = dynamic_cast<const indexes::Numeric &>(index).GetValue(key);
+      return value ? expr::Value(*value) : expr::Value();
+    }
+    case indexes::IndexerType::kTag: {
+      auto value = dynamic_cast<const indexes::Tag &>(index).GetRawValue(key);
+      return value ? expr::Value::MakeString(value->Str(), &arena)
+                   : expr::Value();
+    }
+    default:
+      CHECK(false) << " Received type " << int(index.GetIndexerType());
+  }
+}
 
+absl::StatusOr<std::unique_ptr<RecordSet>> AggregateParameters::MakeRecords(
+    std::deque<indexes::Neighbor> &neighbors, size_t max_bytes) {
   size_t key_index = 0, scores_index = 0;
-  if (parameters.load_key) {
-    key_index = parameters.AddRecordAttribute("__key", "__key",
-                                              indexes::IndexerType::kNone);
+  if (load_key) {
+    key_index =
+        AddRecordAttribute("__key", "__key", indexes::IndexerType::kNone);
   }
-  if (parameters.IsVectorQuery()) {
-    auto score_sv = vmsdk::ToStringView(parameters.score_as.get());
-    scores_index = parameters.AddRecordAttribute(score_sv, score_sv,
-                                                 indexes::IndexerType::kNone);
+  if (IsVectorQuery()) {
+    auto score_sv = vmsdk::ToStringView(score_as.get());
+    scores_index =
+        AddRecordAttribute(score_sv, score_sv, indexes::IndexerType::kNone);
   }
 
-  //
-  //  1. Process the collected Neighbors into Aggregate Records.
-  //
-  auto data_type = parameters.index_schema->GetAttributeDataType().ToProto();
-  RecordSet records(&parameters);
+  auto data_type = index_schema->GetAttributeDataType().ToProto();
+  auto records = std::make_unique<RecordSet>(this);
+  // The local neighbors have no content when the LOADs are read from the
+  // indexes, which mutations leave alone while the lock is held.
+  struct IndexedLoad {
+    size_t record_index;
+    std::shared_ptr<indexes::IndexBase> index;
+    const StoredField *stored_field;
+  };
+  std::vector<IndexedLoad> indexed_loads;
+  std::optional<vmsdk::ReaderMutexLock> lock;
+  std::optional<query::PredicateProgram> filter_program;
+  // Whether the current values of the indexes still match the filter.
+  auto still_matches = [&](const InternedStringPtr &key) {
+    if (!index_schema->IsTrackedByAnyIndex(key)) {
+      return false;
+    }
+    if (filter_parse_results.root_predicate == nullptr) {
+      return true;
+    }
+    if (!filter_program) {
+      filter_program.emplace(*filter_parse_results.root_predicate);
+    }
+    return filter_program->Evaluate(key);
+  };
+  // Only the records beyond the first reply would stay in a cursor.
+  const bool bounded = max_bytes != std::numeric_limits<size_t>::max() &&
+                       neighbors.size() > cursor_count_;
+  size_t bytes = 0;
+  if (bounded) {
+    for (const auto &n : neighbors) {
+      bytes += Cursor::NeighborMemory(n);
+    }
+    if (bytes > max_bytes) {
+      return CursorMemoryError();
+    }
+  }
+  if (reads_indexed_content) {
+    if (!no_content) {
+      for (const auto &attribute : return_attributes) {
+        auto alias = vmsdk::ToStringView(attribute.attribute_alias.get());
+        auto index = index_schema->GetIndex(alias);
+        CHECK(index.ok());
+        indexed_loads.push_back(
+            IndexedLoad{record_indexes_by_alias_.at(alias), std::move(*index),
+                        index_schema->GetStoredField(alias)});
+      }
+    }
+    lock.emplace(&index_schema->GetTimeSlicedMutex());
+  }
   for (auto &n : neighbors) {
-    auto rec =
-        std::make_unique<Record>(parameters.record_indexes_by_alias_.size());
-    if (parameters.load_key) {
+    // The skipped keyspace fetch would drop the keys deleted since the search
+    // and verify the filter of those changed since. The indexes hold their
+    // new values, against which the keys mutated since are verified instead.
+    if (lock && !n.attribute_contents.has_value() &&
+        (!mutation_sequence ||
+         index_schema->MutatedSince(n.external_id, *mutation_sequence)) &&
+        !still_matches(n.external_id)) {
+      continue;
+    }
+    auto rec = std::make_unique<Record>(record_indexes_by_alias_.size());
+    if (load_key) {
       rec->fields_.at(key_index) = expr::Value(n.external_id.get()->Str());
     }
-    if (parameters.IsVectorQuery()) {
+    if (IsVectorQuery()) {
       rec->fields_.at(scores_index) = expr::Value(n.distance);
     }
+    if (!n.attribute_contents.has_value()) {
+      for (const auto &load : indexed_loads) {
+        rec->fields_[load.record_index] = GetIndexedValue(
+            *load.index, load.stored_field, n.external_id, records->arena_);
+      }
+    }
     // For the fields that were fetched, stash them into the RecordSet
-    if (n.attribute_contents.has_value() && !parameters.no_content) {
+    if (n.attribute_contents.has_value() && !no_content) {
       for (auto &[name, records_map_value] : *n.attribute_contents) {
         auto value = vmsdk::ToStringView(records_map_value.value.get());
         std::optional<size_t> record_index;
-        if (auto by_alias = parameters.record_indexes_by_alias_.find(name);
-            by_alias != parameters.record_indexes_by_alias_.end()) {
+        if (auto by_alias = record_indexes_by_alias_.find(name);
+            by_alias != record_indexes_by_alias_.end()) {
           record_index = by_alias->second;
           assert(record_index < rec->fields_.size());
         } else if (auto by_identifier =
-                       parameters.record_indexes_by_identifier_.find(name);
-                   by_identifier !=
-                   parameters.record_indexes_by_identifier_.end()) {
+                       record_indexes_by_identifier_.find(name);
+                   by_identifier != record_indexes_by_identifier_.end()) {
           record_index = by_identifier->second;
           assert(record_index < rec->fields_.size());
         }
         if (record_index) {
           // Need to find the field type
           indexes::IndexerType indexer_type =
-              parameters.record_info_by_index_[*record_index].data_type_;
+              record_info_by_index_[*record_index].data_type_;
           switch (indexer_type) {
             case indexes::IndexerType::kNumeric: {
               auto numeric_value = vmsdk::To<double>(value);
@@ -256,20 +388,48 @@ absl::Status SendReplyInner(ValkeyModuleCtx *ctx,
         }
       }
     }
-    records.push_back(std::move(rec));
+    if (bounded) {
+      bytes += Cursor::RecordMemory(*rec);
+      if (records->size() >= cursor_count_ &&
+          bytes + records->arena_.GetBytes() > max_bytes) {
+        return CursorMemoryError();
+      }
+    }
+    records->push_back(std::move(rec));
   drop_record:;
   }
-  //
-  //  2. Perform the aggregation stages
-  //
-  for (auto &stage : parameters.stages_) {
-    // Todo Check for timeout
-    VMSDK_RETURN_IF_ERROR(stage->Execute(records));
+  return records;
+}
+
+absl::Status AggregateParameters::ExecuteStages(RecordSet &records,
+                                                size_t begin,
+                                                size_t end) const {
+  for (auto i = begin; i < end; ++i) {
+    if (cancellation_token->IsCancelled()) {
+      return absl::DeadlineExceededError(
+          "Search operation cancelled due to timeout");
+    }
+    VMSDK_RETURN_IF_ERROR(stages_[i]->Execute(records));
   }
+  return absl::OkStatus();
+}
 
-  //
-  //  3. Generate the result
-  //
+absl::Status AggregateParameters::PrepareReply(
+    std::deque<indexes::Neighbor> &neighbors) {
+  auto max_bytes = std::numeric_limits<size_t>::max();
+  if (with_cursor_) {
+    // The records are bounded while they are made, before the cursor which
+    // would hold them is checked against the memory left.
+    size_t max_memory = options::GetCursorMaxMemory().GetValue();
+    size_t used = CursorStore::Instance().GetMemory();
+    max_bytes = used < max_memory ? max_memory - used : 0;
+  }
+  VMSDK_ASSIGN_OR_RETURN(records_, MakeRecords(neighbors, max_bytes));
+  return ExecuteStages(*records_, 0, stages_.size());
+}
+
+void ReplyWithRecords(ValkeyModuleCtx *ctx, const ReplyFormat &format,
+                      RecordSet &records) {
   ValkeyModule_ReplyWithArray(ctx, 1 + records.size());
   ValkeyModule_ReplyWithLongLong(ctx, static_cast<long long>(records.size()));
   while (!records.empty()) {
@@ -279,13 +439,12 @@ absl::Status SendReplyInner(ValkeyModuleCtx *ctx,
     // First the referenced fields
     //
     size_t array_count = 0;
-    CHECK(rec->fields_.size() <= parameters.record_info_by_index_.size());
+    CHECK(rec->fields_.size() <= format.record_info_by_index_.size());
     for (size_t i = 0; i < rec->fields_.size(); ++i) {
-      if (ReplyWithValue(
-              ctx, parameters.index_schema->GetAttributeDataType().ToProto(),
-              parameters.record_info_by_index_[i].identifier_,
-              parameters.record_info_by_index_[i].data_type_, rec->fields_[i],
-              parameters.dialect)) {
+      if (ReplyWithValue(ctx, format.data_type_,
+                         format.record_info_by_index_[i].identifier_,
+                         format.record_info_by_index_[i].data_type_,
+                         rec->fields_[i], format.dialect_)) {
         array_count += 2;
       }
     }
@@ -293,25 +452,68 @@ absl::Status SendReplyInner(ValkeyModuleCtx *ctx,
     // Now the unreferenced ones
     //
     for (const auto &[name, value] : rec->extra_fields_) {
-      if (ReplyWithValue(
-              ctx, parameters.index_schema->GetAttributeDataType().ToProto(),
-              name, indexes::IndexerType::kNone, value, parameters.dialect)) {
+      if (ReplyWithValue(ctx, format.data_type_, name,
+                         indexes::IndexerType::kNone, value,
+                         format.dialect_)) {
         array_count += 2;
       }
     }
     ValkeyModule_ReplySetArrayLength(ctx, array_count);
   }
-  return absl::OkStatus();
 }
 
 void AggregateParameters::SendReply(ValkeyModuleCtx *ctx,
                                     std::deque<indexes::Neighbor> &neighbors) {
-  auto identifier = index_schema->GetIdentifier(attribute_alias);
-  auto result = SendReplyInner(ctx, neighbors, *this);
+  // The asynchronous path prepares the records on a reader thread, others
+  // do it here.
+  auto result = [&]() -> absl::Status {
+    if (!records_) {
+      VMSDK_RETURN_IF_ERROR(FetchReplyContent(ctx, neighbors));
+      VMSDK_RETURN_IF_ERROR(PrepareReply(neighbors));
+    }
+    return absl::OkStatus();
+  }();
   if (!result.ok()) {
     ++Metrics::GetStats().query_failed_requests_cnt;
     ValkeyModule_ReplyWithError(ctx, result.message().data());
+    return;
+  }
+  ReplyFormat format{
+      .data_type_ = index_schema->GetAttributeDataType().ToProto(),
+      .record_info_by_index_ = record_info_by_index_,
+      .dialect_ = dialect,
+  };
+  if (!with_cursor_) {
+    ReplyWithRecords(ctx, format, *records_);
+    return;
+  }
+  if (records_->size() <= cursor_count_) {
+    ValkeyModule_ReplyWithArray(ctx, 2);
+    ReplyWithRecords(ctx, format, *records_);
+    ValkeyModule_ReplyWithLongLong(ctx, 0);
+    return;
+  }
+  // The rest of the records, and the neighbors they reference, move into a
+  // cursor.
+  auto max_idle = absl::Milliseconds(options::GetCursorMaxIdleMs().GetValue());
+  if (cursor_max_idle_ms_) {
+    max_idle = std::min(max_idle, absl::Milliseconds(*cursor_max_idle_ms_));
+  }
+  auto &store = CursorStore::Instance();
+  auto now = absl::Now();
+  auto id = store.Add(
+      std::make_unique<Cursor>(index_schema_name, db_num, std::move(format),
+                               std::move(records_), std::move(neighbors),
+                               cursor_count_, max_idle),
+      options::GetCursorMaxMemory().GetValue(), now);
+  if (!id.ok()) {
+    ++Metrics::GetStats().query_failed_requests_cnt;
+    ValkeyModule_ReplyWithError(ctx, id.status().message().data());
+    return;
   }
+  auto cursor = store.Find(db_num, index_schema_name, *id, now);
+  CHECK(cursor != nullptr);
+  ReplyFromCursor(ctx, *id, *cursor, cursor_count_);
 }
 
 }  // namespace aggregate
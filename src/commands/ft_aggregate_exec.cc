@@ -7,11 +7,31 @@
 #include "src/commands/ft_aggregate_exec.h"
 
 #include <algorithm>
-#include <queue>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/base/casts.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
+#include "absl/hash/hash.h"
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "src/commands/ft_aggregate_parser.h"
+#include "src/utils/hyperloglog.h"
+#include "src/utils/t_digest.h"
+#include "src/valkey_search.h"
+#include "vmsdk/src/thread_pool.h"
 
 // #define DBG std::cerr
 #define DBG 0 && std::cerr
@@ -21,11 +41,20 @@ namespace aggregate {
 
 expr::Value Attribute::GetValue(expr::Expression::EvalContext& ctx,
                                 const expr::Expression::Record& record) const {
-  auto rec = reinterpret_cast<const Record&>(record);
+  const auto& rec = reinterpret_cast<const Record&>(record);
   return rec.fields_.at(record_index_);
 };
 
-expr::Expression::EvalContext ctx;
+void Attribute::GetValues(
+    expr::Expression::EvalContext& ctx,
+    absl::Span<const expr::Expression::Record* const> records,
+    expr::Column& values) const {
+  values.Reset(records.size());
+  for (size_t row = 0; row < records.size(); ++row) {
+    const auto& rec = reinterpret_cast<const Record&>(*records[row]);
+    values.Set(row, rec.fields_.at(record_index_));
+  }
+}
 
 std::ostream& operator<<(std::ostream& os, const RecordSet& rs) {
   os << "<RecordSet> " << rs.size() << "\n";
@@ -80,10 +109,78 @@ void SetField(Record& record, Attribute& dest, expr::Value value) {
   record.fields_[dest.record_index_] = value;
 }
 
+// APPLY and FILTER evaluate their expression over batches of records.
+constexpr size_t kBatchSize = 1024;
+
+// GROUPBYs over fewer records are reduced on the calling thread.
+constexpr size_t kPartitionedGroupByRecords = 16 * 1024;
+
+// Unbounded SORTBYs over fewer records are sorted on the calling thread.
+constexpr size_t kParallelSortRecords = 64 * 1024;
+
+using Batch = std::vector<const expr::Expression::Record*>;
+
+static void MakeBatch(const RecordSet& records, size_t begin, Batch& batch) {
+  batch.clear();
+  for (size_t i = begin; i < records.size() && batch.size() < kBatchSize;
+       ++i) {
+    batch.push_back(records[i].get());
+  }
+}
+
+//
+// Runs fn for each index below count, on the pool's threads and the calling
+// one. The caller only waits for indexes other threads have started, so it
+// doesn't deadlock when called from a thread of the pool.
+//
+static void ParallelFor(vmsdk::ThreadPool* pool, size_t count,
+                        absl::FunctionRef<void(size_t)> fn) {
+  struct Shared {
+    Shared(size_t count, absl::FunctionRef<void(size_t)> fn)
+        : count_(count), fn_(fn), done_(count) {}
+    // Returns false once every index is taken.
+    bool RunNext() {
+      auto index = next_.fetch_add(1);
+      if (index >= count_) {
+        return false;
+      }
+      fn_(index);
+      done_.DecrementCount();
+      return true;
+    }
+    const size_t count_;
+    absl::FunctionRef<void(size_t)> fn_;
+    std::atomic<size_t> next_{0};
+    absl::BlockingCounter done_;
+  };
+  auto shared = std::make_shared<Shared>(count, fn);
+  if (pool) {
+    for (size_t i = 1; i < std::min(count, pool->Size()); ++i) {
+      pool->Schedule(
+          [shared]() {
+            while (shared->RunNext()) {
+            }
+          },
+          vmsdk::ThreadPool::Priority::kHigh);
+    }
+  }
+  while (shared->RunNext()) {
+  }
+  shared->done_.Wait();
+}
+
 absl::Status Apply::Execute(RecordSet& records) const {
   DBG << "Executing APPLY with expr: " << *expr_ << "\n";
-  for (auto& r : records) {
-    SetField(*r, *name_, expr_->Evaluate(ctx, *r));
+  expr::Expression::EvalContext eval_ctx;
+  eval_ctx.arena_ = &records.arena_;
+  Batch batch;
+  expr::Column values;
+  for (size_t begin = 0; begin < records.size(); begin += batch.size()) {
+    MakeBatch(records, begin, batch);
+    expr_->EvaluateBatch(eval_ctx, batch, values);
+    for (size_t row = 0; row < batch.size(); ++row) {
+      SetField(*records[begin + row], *name_, values.Get(row));
+    }
   }
   return absl::OkStatus();
 }
@@ -91,72 +188,320 @@ absl::Status Apply::Execute(RecordSet& records) const {
 absl::Status Filter::Execute(RecordSet& records) const {
   DBG << "Executing FILTER with expr: " << *expr_ << "\n";
   RecordSet filtered(records.agg_params_);
+  expr::Expression::EvalContext eval_ctx;
+  Batch batch;
+  expr::Column results;
   while (!records.empty()) {
-    auto r = records.pop_front();
-    auto result = expr_->Evaluate(ctx, *r);
-    if (result.IsTrue()) {
-      filtered.push_back(std::move(r));
+    MakeBatch(records, 0, batch);
+    expr_->EvaluateBatch(eval_ctx, batch, results);
+    for (size_t row = 0; row < batch.size(); ++row) {
+      auto r = records.pop_front();
+      if (results.IsTrue(row)) {
+        filtered.push_back(std::move(r));
+      }
     }
   }
   records.swap(filtered);
   return absl::OkStatus();
 }
 
-template <typename T>
-struct SortFunctor {
+//
+// SORTBY evaluates its keys once per record, up front. When each key is a
+// number for every record, or a string for every record, the keys of a
+// record are encoded into bytes which memcmp in sort order, so that the sort
+// doesn't look at the Values at all. Otherwise, e.g. with missing values,
+// the evaluated Values are compared.
+//
+namespace {
+
+struct SortEntry {
+  absl::string_view key_;  // The encoded keys, if any.
+  size_t index_;           // The position of the record, to break ties.
+};
+
+enum class KeyEncoding { kNumber, kString, kNone };
+
+constexpr uint64_t kSignBit = 0x8000000000000000ull;
+
+// Built-in isnan doesn't work with fast-math.
+bool IsNan(double d) {
+  auto bits = absl::bit_cast<uint64_t>(d);
+  return (bits & ~kSignBit) > 0x7FF0000000000000ull;
+}
+
+KeyEncoding ChooseEncoding(const expr::Column& column) {
+  if (!column.IsBoxed()) {
+    for (size_t row = 0; row < column.Size(); ++row) {
+      if (!column.Present()[row] || IsNan(column.Numbers()[row])) {
+        return KeyEncoding::kNone;
+      }
+    }
+    return KeyEncoding::kNumber;
+  }
+  bool numbers = true;
+  bool strings = true;
+  for (size_t row = 0; row < column.Size() && (numbers || strings); ++row) {
+    auto value = column.Get(row);
+    numbers = numbers && (value.IsBool() ||
+                          (value.IsDouble() && !IsNan(value.GetDouble())));
+    strings = strings && value.IsString();
+  }
+  return numbers   ? KeyEncoding::kNumber
+         : strings ? KeyEncoding::kString
+                   : KeyEncoding::kNone;
+}
+
+// Big endian, with the sign bit flipped for positive numbers and every bit
+// flipped for negative ones. -0 sorts with 0, as in expr::Compare.
+void AppendNumber(double d, bool invert, std::string& out) {
+  auto bits = absl::bit_cast<uint64_t>(d);
+  if (bits == kSignBit) {
+    bits = 0;
+  }
+  bits = (bits & kSignBit) ? ~bits : bits | kSignBit;
+  if (invert) {
+    bits = ~bits;
+  }
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<char>(bits >> shift));
+  }
+}
+
+// Zero bytes are escaped as 00 FF and the string ends with 00 00, so that a
+// string sorts ahead of the strings it's a prefix of.
+void AppendString(absl::string_view s, bool invert, std::string& out) {
+  char flip = invert ? '\xFF' : '\0';
+  for (char c : s) {
+    out.push_back(c ^ flip);
+    if (c == '\0') {
+      out.push_back('\xFF' ^ flip);
+    }
+  }
+  out.push_back(flip);
+  out.push_back(flip);
+}
+
+struct KeyOrder {
+  bool operator()(const SortEntry& l, const SortEntry& r) const {
+    auto cmp = l.key_.compare(r.key_);
+    return cmp < 0 || (cmp == 0 && l.index_ < r.index_);
+  }
+};
+
+// Not a strict weak ordering when values are unordered, so only for the
+// sorts which stay in bounds regardless.
+struct ValueOrder {
   const absl::InlinedVector<SortBy::SortKey, 4>* sortkeys_;
-  bool operator()(const T& l, const T& r) const {
-    for (auto& sk : *sortkeys_) {
-      auto lvalue = sk.expr_->Evaluate(ctx, *l);
-      auto rvalue = sk.expr_->Evaluate(ctx, *r);
-      auto cmp = expr::Compare(lvalue, rvalue);
+  // By sort key, then by record.
+  const std::vector<std::vector<expr::Value>>* values_;
+  bool operator()(const SortEntry& l, const SortEntry& r) const {
+    for (size_t i = 0; i < sortkeys_->size(); ++i) {
+      auto& values = (*values_)[i];
+      auto cmp = expr::Compare(values[l.index_], values[r.index_]);
       switch (cmp) {
         case expr::Ordering::kEQUAL:
         case expr::Ordering::kUNORDERED:
           continue;
         case expr::Ordering::kLESS:
-          return sk.direction_ == SortBy::Direction::kASC;
+          return (*sortkeys_)[i].direction_ == SortBy::Direction::kASC;
         case expr::Ordering::kGREATER:
-          return sk.direction_ == SortBy::Direction::kDESC;
+          return (*sortkeys_)[i].direction_ == SortBy::Direction::kDESC;
       }
     }
-    return false;
+    return l.index_ < r.index_;
   }
 };
 
+// Sorts the slices in parallel, then merges pairs of them in parallel.
+void MergeSort(std::vector<SortEntry>& entries, size_t slices,
+               vmsdk::ThreadPool* pool) {
+  std::vector<size_t> bounds(slices + 1);
+  for (size_t slice = 0; slice <= slices; ++slice) {
+    bounds[slice] = entries.size() * slice / slices;
+  }
+  ParallelFor(pool, slices, [&](size_t slice) {
+    std::sort(entries.begin() + bounds[slice],
+              entries.begin() + bounds[slice + 1], KeyOrder());
+  });
+  std::vector<SortEntry> merged(entries.size());
+  for (size_t width = 1; width < slices; width *= 2) {
+    ParallelFor(pool, (slices + 2 * width - 1) / (2 * width), [&](size_t i) {
+      auto first = bounds[i * 2 * width];
+      auto middle = bounds[std::min(slices, (i * 2 + 1) * width)];
+      auto last = bounds[std::min(slices, (i + 1) * 2 * width)];
+      std::merge(entries.begin() + first, entries.begin() + middle,
+                 entries.begin() + middle, entries.begin() + last,
+                 merged.begin() + first, KeyOrder());
+    });
+    entries.swap(merged);
+  }
+}
+
+}  // namespace
+
 absl::Status SortBy::Execute(RecordSet& records) const {
   DBG << "Executing SORTBY with sortkeys: " << sortkeys_.size() << "\n";
-  if (records.size() > max_) {
-    // Sadly std::priority_queue can't operate on unique_ptr's. so we need an
-    // extra copy
-    SortFunctor<Record*> sorter{&sortkeys_};
-    std::priority_queue<Record*, std::vector<Record*>, SortFunctor<Record*>>
-        heap(sorter);
-    for (auto i = 0; i < max_; ++i) {
-      heap.push(records.pop_front().release());
-    }
-    while (!records.empty()) {
-      heap.push(records.pop_front().release());
-      auto top = RecordPtr(heap.top());  // no leak....
-      heap.pop();
-    }
-    while (!heap.empty()) {
-      records.emplace_front(RecordPtr(heap.top()));
-      heap.pop();
-    }
+  auto pool = records.size() >= kParallelSortRecords && max_ >= records.size()
+                  ? ValkeySearch::Instance().GetReaderThreadPool()
+                  : nullptr;
+  if (pool && pool->Size() > 1) {
+    Sort(records, pool->Size(), pool);
   } else {
-    SortFunctor<RecordPtr> sorter{&sortkeys_};
-    std::stable_sort(records.begin(), records.end(), sorter);
+    Sort(records, 1, nullptr);
   }
   return absl::OkStatus();
 }
 
-absl::Status GroupBy::Execute(RecordSet& records) const {
-  DBG << "Executing GROUPBY with groups: " << groups_.size()
-      << " and reducers: " << reducers_.size() << "\n";
-  absl::flat_hash_map<GroupKey,
-                      absl::InlinedVector<std::unique_ptr<ReducerInstance>, 4>>
-      groups;
+void SortBy::Sort(RecordSet& records, size_t slices,
+                  vmsdk::ThreadPool* pool) const {
+  auto count = records.size();
+  auto keep = std::min(count, max_);
+  Batch batch;
+  batch.reserve(count);
+  for (auto& record : records) {
+    batch.push_back(record.get());
+  }
+  expr::Expression::EvalContext eval_ctx;
+  eval_ctx.arena_ = &records.arena_;
+  std::vector<expr::Column> columns(sortkeys_.size());
+  absl::InlinedVector<KeyEncoding, 4> encodings;
+  bool encoded = true;
+  for (size_t i = 0; i < sortkeys_.size(); ++i) {
+    sortkeys_[i].expr_->EvaluateBatch(eval_ctx, batch, columns[i]);
+    encodings.push_back(ChooseEncoding(columns[i]));
+    encoded = encoded && encodings.back() != KeyEncoding::kNone;
+  }
+  std::vector<SortEntry> entries(count);
+  for (size_t row = 0; row < count; ++row) {
+    entries[row].index_ = row;
+  }
+  std::string keys;
+  std::vector<std::vector<expr::Value>> values;
+  if (encoded) {
+    std::vector<size_t> ends(count);
+    for (size_t row = 0; row < count; ++row) {
+      for (size_t i = 0; i < sortkeys_.size(); ++i) {
+        bool invert = sortkeys_[i].direction_ == Direction::kDESC;
+        if (!columns[i].IsBoxed()) {
+          AppendNumber(columns[i].Numbers()[row], invert, keys);
+        } else if (encodings[i] == KeyEncoding::kNumber) {
+          AppendNumber(*columns[i].Get(row).AsDouble(), invert, keys);
+        } else {
+          AppendString(columns[i].Get(row).GetStringView(), invert, keys);
+        }
+      }
+      ends[row] = keys.size();
+    }
+    for (size_t row = 0; row < count; ++row) {
+      auto begin = row ? ends[row - 1] : 0;
+      entries[row].key_ =
+          absl::string_view(keys.data() + begin, ends[row] - begin);
+    }
+    if (keep < count) {
+      std::nth_element(entries.begin(), entries.begin() + keep, entries.end(),
+                       KeyOrder());
+      std::sort(entries.begin(), entries.begin() + keep, KeyOrder());
+    } else {
+      MergeSort(entries, std::max(slices, size_t(1)), pool);
+    }
+  } else {
+    for (auto& column : columns) {
+      auto& column_values = values.emplace_back(count);
+      for (size_t row = 0; row < count; ++row) {
+        column_values[row] = column.Get(row);
+      }
+    }
+    ValueOrder order{&sortkeys_, &values};
+    std::partial_sort(entries.begin(), entries.begin() + keep, entries.end(),
+                      order);
+  }
+  std::vector<RecordPtr> unsorted(std::make_move_iterator(records.begin()),
+                                  std::make_move_iterator(records.end()));
+  records.clear();
+  for (size_t i = 0; i < keep; ++i) {
+    records.push_back(std::move(unsorted[entries[i].index_]));
+  }
+}
+
+void GroupBy::LayOutStates() {
+  state_offsets_.clear();
+  state_size_ = 0;
+  state_align_ = 1;
+  for (auto& reducer : reducers_) {
+    auto align = reducer.info_->align_;
+    state_size_ = (state_size_ + align - 1) / align * align;
+    state_offsets_.push_back(state_size_);
+    state_size_ += reducer.info_->size_;
+    state_align_ = std::max(state_align_, align);
+  }
+}
+
+GroupBy::GroupState::GroupState(char* block, const GroupBy* group_by)
+    : block_(block), group_by_(group_by) {
+  for (size_t i = 0; i < group_by_->reducers_.size(); ++i) {
+    auto where = block_ + group_by_->state_offsets_[i];
+    auto instance = group_by_->reducers_[i].info_->construct_(where);
+    // operator[] relies on the instance starting where it's constructed.
+    CHECK(static_cast<void*>(instance) == where);
+  }
+}
+
+GroupBy::GroupState::~GroupState() {
+  if (block_) {
+    for (size_t i = 0; i < size(); ++i) {
+      (*this)[i].~ReducerInstance();
+    }
+  }
+}
+
+char* GroupBy::Groups::Allocate(size_t size, size_t align) {
+  CHECK(align <= alignof(std::max_align_t));
+  auto padding = (align - reinterpret_cast<uintptr_t>(next_) % align) % align;
+  if (available_ < padding + size) {
+    auto chunk_size = std::max(kChunkSize, size);
+    chunks_.emplace_back(new char[chunk_size]);
+    next_ = chunks_.back().get();
+    available_ = chunk_size;
+    padding = 0;
+  }
+  auto result = next_ + padding;
+  next_ += padding + size;
+  available_ -= padding + size;
+  return result;
+}
+
+GroupBy::GroupState& GroupBy::Groups::FindOrInsert(GroupKey&& key,
+                                                   const GroupBy& group_by) {
+  auto itr = map_.find(key);
+  if (itr != map_.end()) {
+    return itr->second;
+  }
+  auto block = Allocate(group_by.state_size_, group_by.state_align_);
+  return map_.try_emplace(std::move(key), block, &group_by).first->second;
+}
+
+void GroupBy::Groups::Absorb(Groups&& other) {
+  for (auto& chunk : other.chunks_) {
+    chunks_.emplace_back(std::move(chunk));
+  }
+  other.chunks_.clear();
+  other.next_ = nullptr;
+  other.available_ = 0;
+  for (auto itr = other.map_.begin(); itr != other.map_.end();) {
+    auto inserted = map_.insert(other.map_.extract(itr++)).inserted;
+    CHECK(inserted);
+  }
+}
+
+size_t GroupBy::Reduce(RecordSet& records, Groups& groups) const {
+  auto pool = records.size() >= kPartitionedGroupByRecords
+                  ? ValkeySearch::Instance().GetReaderThreadPool()
+                  : nullptr;
+  if (pool && pool->Size() > 1) {
+    return ReducePartitioned(records, groups, pool->Size(), pool);
+  }
+  expr::Expression::EvalContext eval_ctx;
+  eval_ctx.arena_ = &records.arena_;
   size_t record_field_count = 0;
   while (!records.empty()) {
     auto record = records.pop_front();
@@ -169,38 +514,95 @@ absl::Status GroupBy::Execute(RecordSet& records) const {
     // todo: How do we handle keys that have a missing attribute in the key??
     // Skip them?
     for (auto& g : groups_) {
-      k.keys_.emplace_back(g->GetValue(ctx, *record));
+      k.keys_.emplace_back(g->GetValue(eval_ctx, *record));
     }
     DBG << "Record: " << *record << " GroupKey: " << k << "\n";
-    auto [group_it, inserted] = groups.try_emplace(std::move(k));
-    if (inserted) {
-      DBG << "Was inserted, now have " << groups.size() << " groups\n";
-      for (auto& reducer : reducers_) {
-        group_it->second.emplace_back(reducer.info_->make_instance());
+    ProcessRecord(eval_ctx, *record, groups.FindOrInsert(std::move(k), *this));
+  }
+  return record_field_count;
+}
+
+void GroupBy::ProcessRecord(expr::Expression::EvalContext& eval_ctx,
+                            const Record& record, GroupState& state) const {
+  for (auto i = 0; i < reducers_.size(); ++i) {
+    absl::InlinedVector<expr::Value, 4> args;
+    for (auto& nargs : reducers_[i].args_) {
+      args.emplace_back(nargs->Evaluate(eval_ctx, record));
+    }
+    state[i].ProcessRecord(args);
+  }
+}
+
+size_t GroupBy::ReducePartitioned(RecordSet& records, Groups& groups,
+                                  size_t partitions,
+                                  vmsdk::ThreadPool* pool) const {
+  if (records.empty()) {
+    return 0;
+  }
+  size_t record_field_count = records.front()->fields_.size();
+  // First the keys are found, a slice of the records per partition, along
+  // with the records of each partition within each slice.
+  std::vector<GroupKey> keys(records.size());
+  std::vector<std::vector<std::vector<size_t>>> slices(partitions);
+  ParallelFor(pool, partitions, [&](size_t slice) {
+    expr::Expression::EvalContext eval_ctx;
+    slices[slice].resize(partitions);
+    auto end = (slice + 1) * records.size() / partitions;
+    for (auto i = slice * records.size() / partitions; i < end; ++i) {
+      CHECK(record_field_count == records[i]->fields_.size());
+      for (auto& g : groups_) {
+        keys[i].keys_.emplace_back(g->GetValue(eval_ctx, *records[i]));
       }
+      // The map of the partition uses the low bits of the hash.
+      auto hash = absl::Hash<GroupKey>{}(keys[i]);
+      slices[slice][(uint64_t(hash) >> 32) % partitions].push_back(i);
     }
-    for (auto i = 0; i < reducers_.size(); ++i) {
-      absl::InlinedVector<expr::Value, 4> args;
-      for (auto& nargs : reducers_[i].args_) {
-        args.emplace_back(nargs->Evaluate(ctx, *record));
+  });
+  // Then each partition reduces its records, without the arena, which isn't
+  // thread safe.
+  std::vector<Groups> partition_groups(partitions);
+  ParallelFor(pool, partitions, [&](size_t partition) {
+    expr::Expression::EvalContext eval_ctx;
+    auto& partition_group = partition_groups[partition];
+    for (auto& slice : slices) {
+      for (auto i : slice[partition]) {
+        ProcessRecord(eval_ctx, *records[i],
+                      partition_group.FindOrInsert(std::move(keys[i]), *this));
       }
-      group_it->second[i]->ProcessRecord(args);
     }
+  });
+  // The partitions have different keys, so no states need merging.
+  for (auto& partition_group : partition_groups) {
+    groups.Absorb(std::move(partition_group));
   }
+  records.clear();
+  return record_field_count;
+}
+
+void GroupBy::Emit(Groups& groups, size_t field_count,
+                   RecordSet& records) const {
   for (auto& group : groups) {
     DBG << "Making record for group " << group.first << "\n";
-    RecordPtr record = std::make_unique<Record>(record_field_count);
+    RecordPtr record = std::make_unique<Record>(field_count);
     CHECK(groups_.size() == group.first.keys_.size());
     for (auto i = 0; i < groups_.size(); ++i) {
       SetField(*record, *groups_[i], group.first.keys_[i]);
     }
     CHECK(reducers_.size() == group.second.size());
     for (auto i = 0; i < reducers_.size(); ++i) {
-      SetField(*record, *reducers_[i].output_, group.second[i]->GetResult());
+      SetField(*record, *reducers_[i].output_, group.second[i].GetResult());
     }
     DBG << "Record (" << records.size() << ") is : " << *record << "\n";
     records.push_back(std::move(record));
   }
+}
+
+absl::Status GroupBy::Execute(RecordSet& records) const {
+  DBG << "Executing GROUPBY with groups: " << groups_.size()
+      << " and reducers: " << reducers_.size() << "\n";
+  Groups groups;
+  size_t record_field_count = Reduce(records, groups);
+  Emit(groups, record_field_count, records);
   return absl::OkStatus();
 }
 
@@ -210,6 +612,13 @@ class Count : public GroupBy::ReducerInstance {
     count_++;
   }
   expr::Value GetResult() const override { return expr::Value(double(count_)); }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {expr::Value(double(count_))};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    count_ += state[0].AsDouble().value_or(0);
+  }
 };
 
 class Min : public GroupBy::ReducerInstance {
@@ -229,6 +638,14 @@ class Min : public GroupBy::ReducerInstance {
     }
   }
   expr::Value GetResult() const override { return min_; }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {min_};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    absl::InlinedVector<expr::Value, 4> values{state[0]};
+    ProcessRecord(values);
+  }
 };
 
 class Max : public GroupBy::ReducerInstance {
@@ -244,6 +661,14 @@ class Max : public GroupBy::ReducerInstance {
     }
   }
   expr::Value GetResult() const override { return max_; }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {max_};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    absl::InlinedVector<expr::Value, 4> values{state[0]};
+    ProcessRecord(values);
+  }
 };
 
 class Sum : public GroupBy::ReducerInstance {
@@ -255,6 +680,13 @@ class Sum : public GroupBy::ReducerInstance {
     }
   }
   expr::Value GetResult() const override { return expr::Value(sum_); }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {expr::Value(sum_)};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    sum_ += state[0].AsDouble().value_or(0);
+  }
 };
 
 class Avg : public GroupBy::ReducerInstance {
@@ -270,6 +702,14 @@ class Avg : public GroupBy::ReducerInstance {
   expr::Value GetResult() const override {
     return expr::Value(count_ ? sum_ / count_ : 0.0);
   }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {expr::Value(sum_), expr::Value(double(count_))};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    sum_ += state[0].AsDouble().value_or(0);
+    count_ += state[1].AsDouble().value_or(0);
+  }
 };
 
 class Stddev : public GroupBy::ReducerInstance {
@@ -291,6 +731,16 @@ class Stddev : public GroupBy::ReducerInstance {
       return expr::Value(std::sqrt(variance));
     }
   }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {expr::Value(sum_), expr::Value(sq_sum_),
+            expr::Value(double(count_))};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    sum_ += state[0].AsDouble().value_or(0);
+    sq_sum_ += state[1].AsDouble().value_or(0);
+    count_ += state[2].AsDouble().value_or(0);
+  }
 };
 
 class CountDistinct : public GroupBy::ReducerInstance {
@@ -305,20 +755,106 @@ class CountDistinct : public GroupBy::ReducerInstance {
   }
 };
 
+// A hash of the value which, unlike absl::Hash, is the same in every
+// process, so that the sketches of different partitions can be merged.
+static uint64_t StableHash(const expr::Value& value) {
+  auto mix = [](uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  };
+  if (value.IsDouble()) {
+    auto bits = absl::bit_cast<uint64_t>(value.GetDouble());
+    return mix(bits == kSignBit ? 0 : bits);
+  }
+  auto s = value.AsStringView();
+  auto hash = mix(s.size() ^ 0x9E3779B97F4A7C15ull);
+  for (size_t i = 0; i < s.size(); i += sizeof(uint64_t)) {
+    uint64_t word = 0;
+    std::memcpy(&word, s.data() + i, std::min(sizeof(word), s.size() - i));
+    hash = mix(hash ^ word);
+  }
+  return hash;
+}
+
+class CountDistinctish : public GroupBy::ReducerInstance {
+  utils::HyperLogLog<8> hll_;
+  void ProcessRecord(absl::InlinedVector<expr::Value, 4>& values) override {
+    if (!values[0].IsNil()) {
+      hll_.Add(StableHash(values[0]));
+    }
+  }
+  expr::Value GetResult() const override {
+    return expr::Value(std::round(hll_.Estimate()));
+  }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {expr::Value(std::string(hll_.Serialize()))};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    if (state[0].IsString()) {
+      hll_.MergeSerialized(state[0].GetStringView());
+    }
+  }
+};
+
+class Quantile : public GroupBy::ReducerInstance {
+  utils::TDigest digest_;
+  std::optional<double> quantile_;
+  void ProcessRecord(absl::InlinedVector<expr::Value, 4>& values) override {
+    if (!quantile_) {
+      quantile_ = values[1].AsDouble();
+    }
+    auto val = values[0].AsDouble();
+    if (val) {
+      digest_.Add(*val);
+    }
+  }
+  expr::Value GetResult() const override {
+    if (digest_.Empty() || !quantile_) {
+      return expr::Value();
+    }
+    return expr::Value(digest_.Quantile(*quantile_));
+  }
+  absl::InlinedVector<expr::Value, 4> GetPartialState() const override {
+    return {quantile_ ? expr::Value(*quantile_) : expr::Value(),
+            expr::Value(digest_.Serialize())};
+  }
+  void MergePartialState(
+      const absl::InlinedVector<expr::Value, 4>& state) override {
+    if (!quantile_) {
+      quantile_ = state[0].AsDouble();
+    }
+    if (state[1].IsString()) {
+      digest_.MergeSerialized(state[1].GetStringView());
+    }
+  }
+};
+
+template <typename T>
+GroupBy::ReducerInstance* ConstructReducer(void* where) {
+  return new (where) T();
+}
+
 template <typename T>
-std::unique_ptr<GroupBy::ReducerInstance> MakeReducer() {
-  return std::unique_ptr<GroupBy::ReducerInstance>(std::make_unique<T>());
+GroupBy::ReducerInfo MakeReducer(std::string name, size_t min_nargs,
+                                 size_t max_nargs, bool mergeable = false) {
+  return GroupBy::ReducerInfo{std::move(name), min_nargs, max_nargs,
+                              &ConstructReducer<T>, sizeof(T), alignof(T),
+                              mergeable};
 }
 
 absl::flat_hash_map<std::string, GroupBy::ReducerInfo> GroupBy::reducerTable{
-    {"AVG", GroupBy::ReducerInfo{"AVG", 1, 1, &MakeReducer<Avg>}},
-    {"COUNT", GroupBy::ReducerInfo{"COUNT", 0, 0, &MakeReducer<Count>}},
-    {"COUNT_DISTINCT",
-     GroupBy::ReducerInfo{"COUNT_DISTINCT", 1, 1, &MakeReducer<CountDistinct>}},
-    {"MIN", GroupBy::ReducerInfo{"MIN", 1, 1, &MakeReducer<Min>}},
-    {"MAX", GroupBy::ReducerInfo{"MAX", 1, 1, &MakeReducer<Max>}},
-    {"STDDEV", GroupBy::ReducerInfo{"STDDEV", 1, 1, &MakeReducer<Stddev>}},
-    {"SUM", GroupBy::ReducerInfo{"SUM", 1, 1, &MakeReducer<Sum>}},
+    {"AVG", MakeReducer<Avg>("AVG", 1, 1, true)},
+    {"COUNT", MakeReducer<Count>("COUNT", 0, 0, true)},
+    {"COUNT_DISTINCT", MakeReducer<CountDistinct>("COUNT_DISTINCT", 1, 1)},
+    {"COUNT_DISTINCTISH",
+     MakeReducer<CountDistinctish>("COUNT_DISTINCTISH", 1, 1, true)},
+    {"MIN", MakeReducer<Min>("MIN", 1, 1, true)},
+    {"MAX", MakeReducer<Max>("MAX", 1, 1, true)},
+    {"QUANTILE", MakeReducer<Quantile>("QUANTILE", 2, 2, true)},
+    {"STDDEV", MakeReducer<Stddev>("STDDEV", 1, 1, true)},
+    {"SUM", MakeReducer<Sum>("SUM", 1, 1, true)},
 };
 
 }  // namespace aggregate
@@ -8,7 +8,11 @@
 #define VALKEYSEARCH_COMMANDS_FT_AGGREGATE_EXEC
 
 #include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/inlined_vector.h"
 #include "src/commands/ft_aggregate_parser.h"
 #include "src/expr/expr.h"
@@ -50,6 +54,8 @@ class RecordSet : public std::deque<RecordPtr> {
   friend std::ostream& operator<<(std::ostream& os, const RecordSet& rs);
 
   const AggregateParameters* agg_params_;
+  // Holds the strings computed by the stages for the records of this set.
+  expr::Arena arena_;
 };
 
 struct GroupKey {
@@ -72,6 +78,70 @@ struct GroupKey {
   }
 };
 
+//
+// The reducer instances of a group, constructed in place in a single block
+// laid out by the GroupBy, instead of being allocated one by one. Owns the
+// instances, not the block.
+//
+class GroupBy::GroupState {
+ public:
+  GroupState(char* block, const GroupBy* group_by);
+  GroupState(GroupState&& other) noexcept
+      : block_(std::exchange(other.block_, nullptr)),
+        group_by_(other.group_by_) {}
+  GroupState& operator=(GroupState&& other) = delete;
+  ~GroupState();
+
+  size_t size() const { return group_by_->reducers_.size(); }
+  ReducerInstance& operator[](size_t i) const {
+    return *reinterpret_cast<ReducerInstance*>(block_ +
+                                               group_by_->state_offsets_[i]);
+  }
+
+ private:
+  char* block_;
+  const GroupBy* group_by_;
+};
+
+//
+// The groups found by a GroupBy. The blocks of their states are carved out
+// of larger chunks, which the groups share.
+//
+class GroupBy::Groups {
+ public:
+  using Map = absl::flat_hash_map<GroupKey, GroupState>;
+
+  Groups() = default;
+  Groups(Groups&& other) noexcept
+      : chunks_(std::move(other.chunks_)),
+        next_(std::exchange(other.next_, nullptr)),
+        available_(std::exchange(other.available_, 0)),
+        map_(std::move(other.map_)) {}
+
+  // The state of the group with the key. The reducers of a new group are
+  // constructed.
+  GroupState& FindOrInsert(GroupKey&& key, const GroupBy& group_by);
+  // Moves in the groups of other, whose keys must all be new.
+  void Absorb(Groups&& other);
+
+  size_t size() const { return map_.size(); }
+  Map::iterator begin() { return map_.begin(); }
+  Map::iterator end() { return map_.end(); }
+  Map::const_iterator begin() const { return map_.begin(); }
+  Map::const_iterator end() const { return map_.end(); }
+
+ private:
+  char* Allocate(size_t size, size_t align);
+
+  static constexpr size_t kChunkSize = 16 * 1024;
+
+  // Declared ahead of the map, to outlive the states in it.
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char* next_{nullptr};
+  size_t available_{0};
+  Map map_;
+};
+
 inline std::ostream& operator<<(std::ostream& os, const Record& r) {
   for (auto& f : r.fields_) {
     if (&f != &r.fields_[0]) {
@@ -6,6 +6,7 @@
 
 #include "src/commands/ft_aggregate_parser.h"
 
+#include "absl/algorithm/container.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -24,6 +25,7 @@ constexpr absl::string_view kAddScoresParam{"ADDSCORES"};
 constexpr absl::string_view kApplyParam{"APPLY"};
 constexpr absl::string_view kAsParam{"AS"};
 constexpr absl::string_view kAscParam{"ASC"};
+constexpr absl::string_view kCountParam{"COUNT"};
 constexpr absl::string_view kDescParam{"DESC"};
 constexpr absl::string_view kDialectParam{"DIALECT"};
 constexpr absl::string_view kFilterParam{"FILTER"};
@@ -31,10 +33,12 @@ constexpr absl::string_view kGroupByParam{"GROUPBY"};
 constexpr absl::string_view kLimitParam{"LIMIT"};
 constexpr absl::string_view kLoadParam{"LOAD"};
 constexpr absl::string_view kMaxParam{"MAX"};
+constexpr absl::string_view kMaxIdleParam{"MAXIDLE"};
 constexpr absl::string_view kParamsParam{"PARAMS"};
 constexpr absl::string_view kReduceParam{"REDUCE"};
 constexpr absl::string_view kSortByParam{"SORTBY"};
 constexpr absl::string_view kTimeoutParam{"TIMEOUT"};
+constexpr absl::string_view kWithCursorParam{"WITHCURSOR"};
 
 std::unique_ptr<vmsdk::ParamParser<AggregateParameters>> ConstructLoadParser() {
   return std::make_unique<vmsdk::ParamParser<AggregateParameters>>(
@@ -72,6 +76,7 @@ ConstructApplyParser() {
          vmsdk::ArgsIterator &itr) -> absl::Status {
         auto apply = std::make_unique<Apply>();
         VMSDK_ASSIGN_OR_RETURN(auto expr_string, itr.PopNext());
+        parameters.parse_vars_.references_.clear();
         VMSDK_ASSIGN_OR_RETURN(
             apply->expr_, expr::Expression::Compile(
                               parameters, vmsdk::ToStringView(expr_string)));
@@ -85,6 +90,8 @@ ConstructApplyParser() {
             parameters.MakeReference(vmsdk::ToStringView(name_string), true));
         apply->name_ = std::unique_ptr<Attribute>(
             dynamic_cast<Attribute *>(name.release()));
+        parameters.Overwrite(*apply->name_);
+        parameters.AddComputed(*apply->expr_, *apply->name_);
         DBG << *apply << "\n";
         parameters.stages_.emplace_back(std::move(apply));
         return absl::OkStatus();
@@ -119,6 +126,30 @@ ConstructLimitParser() {
       });
 }
 
+std::unique_ptr<vmsdk::ParamParser<AggregateParameters>>
+ConstructWithCursorParser() {
+  return std::make_unique<vmsdk::ParamParser<AggregateParameters>>(
+      [](AggregateParameters &parameters,
+         vmsdk::ArgsIterator &itr) -> absl::Status {
+        parameters.with_cursor_ = true;
+        while (true) {
+          if (itr.PopIfNextIgnoreCase(kCountParam)) {
+            VMSDK_RETURN_IF_ERROR(
+                vmsdk::ParseParamValue(itr, parameters.cursor_count_));
+            if (parameters.cursor_count_ == 0) {
+              return absl::InvalidArgumentError(
+                  "COUNT of WITHCURSOR must be positive");
+            }
+          } else if (itr.PopIfNextIgnoreCase(kMaxIdleParam)) {
+            VMSDK_RETURN_IF_ERROR(
+                vmsdk::ParseParamValue(itr, parameters.cursor_max_idle_ms_));
+          } else {
+            return absl::OkStatus();
+          }
+        }
+      });
+}
+
 std::unique_ptr<vmsdk::ParamParser<AggregateParameters>>
 ConstructParamsParser() {
   return std::make_unique<vmsdk::ParamParser<AggregateParameters>>(
@@ -256,7 +287,10 @@ ConstructGroupByParser() {
           }
           groupby->reducers_.emplace_back(std::move(r));
         }
+        groupby->LayOutStates();
         parameters.stages_.emplace_back(std::move(groupby));
+        // The records after a GROUPBY hold only its keys and reducers.
+        parameters.parse_vars_.computed_.clear();
         DBG << "After groupby: " << parameters << "\n";
         return absl::OkStatus();
       });
@@ -277,6 +311,7 @@ vmsdk::KeyValueParser<AggregateParameters> CreateAggregateParser() {
   parser.AddParamParser(kLimitParam, ConstructLimitParser());
   parser.AddParamParser(kParamsParam, ConstructParamsParser());
   parser.AddParamParser(kSortByParam, ConstructSortByParser());
+  parser.AddParamParser(kWithCursorParam, ConstructWithCursorParser());
   return parser;
 }
 
@@ -285,10 +320,16 @@ AggregateParameters::MakeReference(const absl::string_view name, bool create) {
   DBG << "MakeReference : " << name << " Create:" << create << "\n";
   auto it = record_indexes_by_identifier_.find(name);
   if (it != record_indexes_by_identifier_.end()) {
+    if (!create) {
+      parse_vars_.references_.push_back(it->second);
+    }
     return std::make_unique<Attribute>(name, it->second);
   }
   it = record_indexes_by_alias_.find(name);
   if (it != record_indexes_by_alias_.end()) {
+    if (!create) {
+      parse_vars_.references_.push_back(it->second);
+    }
     return std::make_unique<Attribute>(name, it->second);
   }
   indexes::IndexerType fieldType = indexes::IndexerType::kNone;
@@ -318,9 +359,40 @@ AggregateParameters::MakeReference(const absl::string_view name, bool create) {
     //     << " with synthetic alias (no index schema)\n";
     new_index = AddRecordAttribute(name, name, indexes::IndexerType::kNone);
   }
+  if (!create) {
+    parse_vars_.references_.push_back(new_index);
+  }
   return std::make_unique<Attribute>(name, new_index);
 }
 
+std::unique_ptr<expr::Expression::AttributeReference>
+AggregateParameters::FindComputed(absl::string_view key) {
+  auto it = parse_vars_.computed_.find(key);
+  if (it == parse_vars_.computed_.end()) {
+    return nullptr;
+  }
+  return std::make_unique<Attribute>(it->second.name_, it->second.index_);
+}
+
+void AggregateParameters::AddComputed(const expr::Expression &expr,
+                                      const Attribute &attribute) {
+  auto &inputs = parse_vars_.references_;
+  if (absl::c_linear_search(inputs, attribute.record_index_)) {
+    // The expression reads the value it replaces.
+    return;
+  }
+  parse_vars_.computed_[expr.Key()] = {attribute.name_,
+                                       attribute.record_index_, inputs};
+}
+
+void AggregateParameters::Overwrite(const Attribute &attribute) {
+  absl::erase_if(parse_vars_.computed_, [&](const auto &entry) {
+    return entry.second.index_ == attribute.record_index_ ||
+           absl::c_linear_search(entry.second.inputs_,
+                                 attribute.record_index_);
+  });
+}
+
 std::ostream &operator<<(std::ostream &os, const AggregateParameters &agg) {
   os << "\nAggregate command Parameters: " << "\n";
   for (const auto &[key, value] : agg.parse_vars.params) {
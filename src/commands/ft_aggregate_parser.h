@@ -7,20 +7,27 @@
 #ifndef VALKEYSEARCH_SRC_COMMANDS_FT_AGGREGATE_PARSER_H
 #define VALKEYSEARCH_SRC_COMMANDS_FT_AGGREGATE_PARSER_H
 
+#include <cstddef>
+#include <limits>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "src/commands/commands.h"
 #include "src/expr/expr.h"
 #include "src/expr/value.h"
 #include "src/query/search.h"
 #include "src/schema_manager.h"
 #include "vmsdk/src/command_parser.h"
+#include "vmsdk/src/thread_pool.h"
 
 namespace valkey_search {
 namespace aggregate {
 
+struct Attribute;
 class Command;
+struct GroupKey;
 class Record;
 class RecordSet;
 class Stage;
@@ -36,19 +43,52 @@ struct IndexInterface {
 
 struct AggregateParameters : public expr::Expression::CompileContext,
                              public QueryCommand {
-  ~AggregateParameters() override = default;
-  AggregateParameters(int db_num) : QueryCommand(db_num){};
+  ~AggregateParameters() override;
+  AggregateParameters(int db_num);
   absl::Status ParseCommand(vmsdk::ArgsIterator& itr) override;
   void SendReply(ValkeyModuleCtx* ctx,
                  std::deque<indexes::Neighbor>& neighbors) override;
+  // The cluster fan-out prepares the records itself.
+  bool OffloadsReply() const override { return records_ == nullptr; }
+  bool FetchesReplyContent() const override { return !reads_indexed_content; }
+  absl::Status FetchReplyContent(
+      ValkeyModuleCtx* ctx, std::deque<indexes::Neighbor>& neighbors) override;
+  absl::Status PrepareReply(std::deque<indexes::Neighbor>& neighbors) override;
+  // Vector queries need the global nearest neighbors before any stage runs.
+  bool FansOutPipeline() const override { return IsNonVectorQuery(); }
+  // Fails once the neighbors and the records made beyond the first
+  // cursor_count_ take more than max_bytes, which bounds the records of a
+  // cursor while they are made.
+  absl::StatusOr<std::unique_ptr<RecordSet>> MakeRecords(
+      std::deque<indexes::Neighbor>& neighbors,
+      size_t max_bytes = std::numeric_limits<size_t>::max());
+  absl::Status ExecuteStages(RecordSet& records, size_t begin,
+                             size_t end) const;
+  // The output of the stages, set once PrepareReply has run.
+  std::unique_ptr<RecordSet> records_;
+  // The arguments following the query string, which the partitions of a
+  // cluster parse into the same pipeline.
+  std::vector<vmsdk::UniqueValkeyString> arguments_;
   bool loadall_{false};
   std::vector<std::string> loads_;
   bool load_key{false};
   bool addscores_{false};
+  // WITHCURSOR replies with cursor_count_ records at a time, keeping the rest
+  // in a cursor which FT.CURSOR READ continues from.
+  static constexpr uint32_t kDefaultCursorCount{1000};
+  bool with_cursor_{false};
+  uint32_t cursor_count_{kDefaultCursorCount};
+  std::optional<uint32_t> cursor_max_idle_ms_;
   std::vector<std::unique_ptr<Stage>> stages_;
 
   absl::StatusOr<std::unique_ptr<expr::Expression::AttributeReference>>
   MakeReference(const absl::string_view s, bool create) override;
+  std::unique_ptr<expr::Expression::AttributeReference> FindComputed(
+      absl::string_view key) override;
+  // Notes that an APPLY stage stores the value of expr in the attribute.
+  void AddComputed(const expr::Expression& expr, const Attribute& attribute);
+  // Forgets the values depending on the attribute, which a stage writes.
+  void Overwrite(const Attribute& attribute);
 
   absl::StatusOr<expr::Value> GetParam(
       const absl::string_view s) const override {
@@ -116,9 +156,23 @@ struct AggregateParameters : public expr::Expression::CompileContext,
     // For testing
     IndexInterface* index_interface_;
 
+    // The values the APPLY stages parsed so far store, by expression key,
+    // which later expressions can use rather than recompute.
+    struct Computed {
+      std::string name_;
+      size_t index_;
+      // The attributes the expression reads.
+      std::vector<size_t> inputs_;
+    };
+    absl::flat_hash_map<std::string, Computed> computed_;
+    // The attributes referenced since the last compilation began.
+    std::vector<size_t> references_;
+
   } parse_vars_;
   void ClearAtEndOfParse() {
     parse_vars_.index_interface_ = nullptr;
+    parse_vars_.computed_.clear();
+    parse_vars_.references_.clear();
     parse_vars.ClearAtEndOfParse();
   }
 
@@ -150,6 +204,9 @@ struct Attribute : expr::Expression::AttributeReference {
   void Dump(std::ostream& os) const override { os << name_; }
   expr::Value GetValue(expr::Expression::EvalContext& ctx,
                        const expr::Expression::Record& record) const override;
+  void GetValues(expr::Expression::EvalContext& ctx,
+                 absl::Span<const expr::Expression::Record* const> records,
+                 expr::Column& values) const override;
 };
 
 class Limit : public Stage {
@@ -191,12 +248,28 @@ class GroupBy : public Stage {
     virtual ~ReducerInstance() = default;
     virtual void ProcessRecord(absl::InlinedVector<expr::Value, 4>& values) = 0;
     virtual expr::Value GetResult() const = 0;
+    //
+    // Mergeable reducers summarize the records they processed in a partial
+    // state, which can be folded into another instance of the same reducer.
+    // This lets every partition of a cluster reduce its own records.
+    //
+    virtual absl::InlinedVector<expr::Value, 4> GetPartialState() const {
+      CHECK(false) << "Reducer has no partial state";
+    }
+    virtual void MergePartialState(
+        const absl::InlinedVector<expr::Value, 4>& state) {
+      CHECK(false) << "Reducer has no partial state";
+    }
   };
   struct ReducerInfo {
     std::string name_;
     size_t min_nargs_{0};
     size_t max_nargs_{0};
-    std::unique_ptr<ReducerInstance> (*make_instance)();
+    // Constructs an instance in place, in size_ bytes aligned to align_.
+    ReducerInstance* (*construct_)(void* where);
+    size_t size_{0};
+    size_t align_{0};
+    bool mergeable_{false};
   };
   static absl::flat_hash_map<std::string, ReducerInfo> reducerTable;
 
@@ -219,6 +292,38 @@ class GroupBy : public Stage {
   absl::InlinedVector<std::unique_ptr<Attribute>, 4> groups_;
   absl::InlinedVector<Reducer, 4> reducers_;
 
+  //
+  // The reducer instances of a group are constructed in one block, at these
+  // offsets. Set by LayOutStates once the reducers are known.
+  //
+  absl::InlinedVector<size_t, 4> state_offsets_;
+  size_t state_size_{0};
+  size_t state_align_{1};
+  void LayOutStates();
+
+  class GroupState;
+  class Groups;
+  // Consumes the records into the reducers of their groups, returns the
+  // number of fields of the records. Many records are reduced by
+  // ReducePartitioned on the reader threads.
+  size_t Reduce(RecordSet& records, Groups& groups) const;
+  // Same as Reduce, but the records are hash partitioned by group key and
+  // the partitions are reduced in parallel on the thread pool, when given.
+  size_t ReducePartitioned(RecordSet& records, Groups& groups,
+                           size_t partitions, vmsdk::ThreadPool* pool) const;
+  void ProcessRecord(expr::Expression::EvalContext& eval_ctx,
+                     const Record& record, GroupState& state) const;
+  // Appends one record with `field_count` fields per group to the records.
+  void Emit(Groups& groups, size_t field_count, RecordSet& records) const;
+  bool IsMergeable() const {
+    for (auto& r : reducers_) {
+      if (!r.info_->mergeable_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   void Dump(std::ostream& os) const override {
     os << "GROUPBY ";
     for (auto& g : groups_) {
@@ -246,6 +351,10 @@ class SortBy : public Stage {
   };
   size_t max_{10};
   absl::InlinedVector<SortKey, 4> sortkeys_;
+  // Keeps the first max_ records in sort order. The records are sorted in
+  // `slices` which are merged, in parallel on the thread pool, when given.
+  // Many records are sorted this way on the reader threads by Execute.
+  void Sort(RecordSet& records, size_t slices, vmsdk::ThreadPool* pool) const;
   void Dump(std::ostream& os) const override {
     os << "SORTBY:";
     for (auto& k : sortkeys_) {
@@ -0,0 +1,439 @@
+/*
+ * Copyright Valkey Contributors.
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ */
+
+#include "src/commands/ft_aggregate_partition.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "grpcpp/support/status.h"
+#include "src/coordinator/util.h"
+#include "src/schema_manager.h"
+#include "src/utils/cancel.h"
+#include "src/valkey_search.h"
+#include "vmsdk/src/command_parser.h"
+#include "vmsdk/src/log.h"
+#include "vmsdk/src/managed_pointers.h"
+#include "vmsdk/src/status/status_macros.h"
+#include "vmsdk/src/thread_pool.h"
+#include "vmsdk/src/utils.h"
+
+namespace valkey_search {
+namespace aggregate {
+
+namespace {
+
+void ValueToProto(const expr::Value &value,
+                  coordinator::AggregateValue *proto) {
+  if (value.IsBool()) {
+    proto->set_boolean(value.GetBool());
+  } else if (value.IsDouble()) {
+    proto->set_number(value.GetDouble());
+  } else if (value.IsString()) {
+    proto->set_string(std::string(value.GetStringView()));
+  }
+}
+
+expr::Value ProtoToValue(const coordinator::AggregateValue &proto) {
+  switch (proto.value_case()) {
+    case coordinator::AggregateValue::kBoolean:
+      return expr::Value(proto.boolean());
+    case coordinator::AggregateValue::kNumber:
+      return expr::Value(proto.number());
+    case coordinator::AggregateValue::kString:
+      return expr::Value(std::string(proto.string()));
+    case coordinator::AggregateValue::VALUE_NOT_SET:
+      return expr::Value();
+  }
+  CHECK(false);
+}
+
+// The GROUPBY ending the partition stages, if any.
+const GroupBy *PartitionGroupBy(const AggregateParameters &parameters,
+                                size_t partition_stages) {
+  if (partition_stages == 0) {
+    return nullptr;
+  }
+  return dynamic_cast<const GroupBy *>(
+      parameters.stages_[partition_stages - 1].get());
+}
+
+absl::StatusOr<std::unique_ptr<AggregateParameters>> RequestToParameters(
+    const coordinator::AggregateIndexPartitionRequest &request,
+    grpc::CallbackServerContext *context) {
+  auto parameters = std::make_unique<AggregateParameters>(request.db_num());
+  parameters->db_num = request.db_num();
+  parameters->index_schema_name = request.index_schema_name();
+  parameters->timeout_ms = request.timeout_ms();
+  VMSDK_ASSIGN_OR_RETURN(parameters->index_schema,
+                         SchemaManager::Instance().GetIndexSchema(
+                             request.db_num(), request.index_schema_name()));
+  std::vector<vmsdk::UniqueValkeyString> arguments;
+  std::vector<ValkeyModuleString *> argv;
+  for (const auto &argument : request.arguments()) {
+    arguments.emplace_back(vmsdk::MakeUniqueValkeyString(argument));
+    argv.push_back(arguments.back().get());
+  }
+  vmsdk::ArgsIterator itr{argv.data(), static_cast<int>(argv.size())};
+  parameters->parse_vars.query_string = request.query();
+  VMSDK_RETURN_IF_ERROR(parameters->ParseCommand(itr));
+  parameters->parse_vars.ClearAtEndOfParse();
+  parameters->cancellation_token =
+      cancel::Make(parameters->timeout_ms, context);
+  parameters->enable_partial_results = request.enable_partial_results();
+  parameters->enable_consistency = request.enable_consistency();
+  parameters->index_fingerprint_version = request.index_fingerprint_version();
+  parameters->slot_fingerprint = request.slot_fingerprint();
+  if (request.partition_stages() > PartitionStageCount(*parameters)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Can't run ", request.partition_stages(),
+                     " aggregation stages on a partition"));
+  }
+  return parameters;
+}
+
+// AggregatePartitionTracker collects the results of the partitions of an
+// aggregation fanout. Once all of them arrived, it runs the remaining stages
+// on a reader thread and hands the parameters to the callback.
+struct AggregatePartitionTracker {
+  absl::Mutex mutex;
+  std::unique_ptr<AggregateParameters> parameters;
+  size_t partition_stages;
+  std::unique_ptr<RecordSet> records ABSL_GUARDED_BY(mutex);
+  GroupBy::Groups groups ABSL_GUARDED_BY(mutex);
+  absl::Status status ABSL_GUARDED_BY(mutex);
+  query::SearchResponseCallback callback;
+  vmsdk::ThreadPool *thread_pool;
+  std::atomic_bool reached_oom{false};
+  std::atomic_bool consistency_failed{false};
+
+  AggregatePartitionTracker(std::unique_ptr<AggregateParameters> parameters,
+                            size_t partition_stages,
+                            query::SearchResponseCallback callback,
+                            vmsdk::ThreadPool *thread_pool)
+      : parameters(std::move(parameters)),
+        partition_stages(partition_stages),
+        records(std::make_unique<RecordSet>(this->parameters.get())),
+        callback(std::move(callback)),
+        thread_pool(thread_pool) {}
+
+  void HandleResponse(const grpc::Status &grpc_status,
+                      coordinator::AggregateIndexPartitionResponse &response,
+                      absl::string_view address) {
+    if (!grpc_status.ok()) {
+      if (parameters->enable_consistency &&
+          grpc_status.error_code() == grpc::FAILED_PRECONDITION) {
+        consistency_failed.store(true);
+      }
+      if (grpc_status.error_code() == grpc::RESOURCE_EXHAUSTED) {
+        reached_oom.store(true);
+      }
+      if (grpc_status.error_code() == grpc::RESOURCE_EXHAUSTED ||
+          !parameters->enable_partial_results || consistency_failed.load()) {
+        parameters->cancellation_token->Cancel();
+      }
+      VMSDK_LOG_EVERY_N_SEC(WARNING, nullptr, 1)
+          << "Error during handling of FT.AGGREGATE on node " << address
+          << ": " << grpc_status.error_message();
+      return;
+    }
+    absl::MutexLock lock(&mutex);
+    auto merged = MergePartitionResults(*parameters, partition_stages,
+                                        response, *records, groups);
+    if (!merged.ok()) {
+      status = merged;
+    }
+  }
+
+  ~AggregatePartitionTracker() {
+    absl::MutexLock lock(&mutex);
+    if (consistency_failed) {
+      status = absl::FailedPreconditionError(query::kFailedPreconditionMsg);
+    } else if (reached_oom) {
+      status = absl::ResourceExhaustedError(query::kOOMMsg);
+    }
+    thread_pool->Schedule(
+        [parameters = std::move(parameters), records = std::move(records),
+         groups = std::move(groups), status = std::move(status),
+         partition_stages = partition_stages,
+         callback = std::move(callback)]() mutable {
+          if (status.ok()) {
+            status = FinishPartitionResults(*parameters, partition_stages,
+                                            *records, groups);
+          }
+          absl::StatusOr<std::deque<indexes::Neighbor>> result =
+              std::deque<indexes::Neighbor>();
+          if (status.ok()) {
+            parameters->records_ = std::move(records);
+          } else {
+            result = status;
+          }
+          callback(result, std::move(parameters));
+        },
+        vmsdk::ThreadPool::Priority::kHigh);
+  }
+};
+
+}  // namespace
+
+size_t PartitionStageCount(const AggregateParameters &parameters) {
+  size_t count = 0;
+  for (const auto &stage : parameters.stages_) {
+    if (dynamic_cast<const Filter *>(stage.get()) ||
+        dynamic_cast<const Apply *>(stage.get())) {
+      ++count;
+      continue;
+    }
+    auto group_by = dynamic_cast<const GroupBy *>(stage.get());
+    if ((group_by && group_by->IsMergeable()) ||
+        dynamic_cast<const SortBy *>(stage.get())) {
+      ++count;
+    }
+    break;
+  }
+  return count;
+}
+
+absl::Status ExecutePartitionStages(
+    const AggregateParameters &parameters, RecordSet &records,
+    size_t partition_stages,
+    coordinator::AggregateIndexPartitionResponse &response) {
+  auto group_by = PartitionGroupBy(parameters, partition_stages);
+  VMSDK_RETURN_IF_ERROR(parameters.ExecuteStages(
+      records, 0, group_by ? partition_stages - 1 : partition_stages));
+  if (group_by) {
+    GroupBy::Groups groups;
+    group_by->Reduce(records, groups);
+    for (const auto &[key, reducers] : groups) {
+      auto group = response.add_groups();
+      for (const auto &value : key.keys_) {
+        ValueToProto(value, group->add_keys());
+      }
+      for (size_t i = 0; i < reducers.size(); ++i) {
+        auto state = group->add_states();
+        for (const auto &value : reducers[i].GetPartialState()) {
+          ValueToProto(value, state->add_values());
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+  while (!records.empty()) {
+    auto record = records.pop_front();
+    auto record_proto = response.add_records();
+    for (const auto &value : record->fields_) {
+      ValueToProto(value, record_proto->add_fields());
+    }
+    for (const auto &[name, value] : record->extra_fields_) {
+      auto extra_field = record_proto->add_extra_fields();
+      extra_field->set_name(name);
+      ValueToProto(value, extra_field->mutable_value());
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status MergePartitionResults(
+    const AggregateParameters &parameters, size_t partition_stages,
+    coordinator::AggregateIndexPartitionResponse &response, RecordSet &records,
+    GroupBy::Groups &groups) {
+  auto group_by = PartitionGroupBy(parameters, partition_stages);
+  if (!group_by) {
+    for (const auto &record_proto : response.records()) {
+      auto record = std::make_unique<Record>(record_proto.fields_size());
+      for (auto i = 0; i < record_proto.fields_size(); ++i) {
+        record->fields_[i] = ProtoToValue(record_proto.fields(i));
+      }
+      for (const auto &extra_field : record_proto.extra_fields()) {
+        record->extra_fields_.emplace_back(extra_field.name(),
+                                           ProtoToValue(extra_field.value()));
+      }
+      records.push_back(std::move(record));
+    }
+    return absl::OkStatus();
+  }
+  for (const auto &group : response.groups()) {
+    if (group.keys_size() != group_by->groups_.size() ||
+        group.states_size() != group_by->reducers_.size()) {
+      return absl::InternalError("Partition returned a malformed group");
+    }
+    GroupKey key;
+    for (const auto &value : group.keys()) {
+      key.keys_.emplace_back(ProtoToValue(value));
+    }
+    auto &reducers = groups.FindOrInsert(std::move(key), *group_by);
+    for (auto i = 0; i < group.states_size(); ++i) {
+      absl::InlinedVector<expr::Value, 4> state;
+      for (const auto &value : group.states(i).values()) {
+        state.emplace_back(ProtoToValue(value));
+      }
+      reducers[i].MergePartialState(state);
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FinishPartitionResults(const AggregateParameters &parameters,
+                                    size_t partition_stages,
+                                    RecordSet &records,
+                                    GroupBy::Groups &groups) {
+  size_t next_stage = partition_stages;
+  if (auto group_by = PartitionGroupBy(parameters, partition_stages)) {
+    group_by->Emit(groups, parameters.record_info_by_index_.size(), records);
+  } else if (partition_stages > 0 &&
+             dynamic_cast<const SortBy *>(
+                 parameters.stages_[partition_stages - 1].get())) {
+    // The top records overall are among the top records of the partitions.
+    --next_stage;
+  }
+  return parameters.ExecuteStages(records, next_stage,
+                                  parameters.stages_.size());
+}
+
+absl::Status AggregateIndexPartition(
+    grpc::CallbackServerContext *context,
+    const coordinator::AggregateIndexPartitionRequest &request,
+    coordinator::AggregateIndexPartitionResponse *response,
+    absl::AnyInvocable<void(absl::Status)> done) {
+  VMSDK_ASSIGN_OR_RETURN(auto parameters,
+                         RequestToParameters(request, context));
+  auto reader_thread_pool = ValkeySearch::Instance().GetReaderThreadPool();
+  return query::SearchAsync(
+      std::move(parameters), reader_thread_pool,
+      [response, reader_thread_pool,
+       partition_stages = request.partition_stages(),
+       done = std::move(done)](
+          absl::StatusOr<std::deque<indexes::Neighbor>> &neighbors,
+          std::unique_ptr<query::SearchParameters> search_parameters) mutable {
+        if (!neighbors.ok()) {
+          done(neighbors.status());
+          return;
+        }
+        std::unique_ptr<AggregateParameters> parameters(
+            dynamic_cast<AggregateParameters *>(search_parameters.release()));
+        CHECK(parameters != nullptr);
+        if (parameters->cancellation_token->IsCancelled() &&
+            !parameters->enable_partial_results) {
+          done(absl::DeadlineExceededError(
+              "Search operation cancelled due to timeout"));
+          return;
+        }
+        auto execute = [reader_thread_pool, response, partition_stages](
+                           auto done, auto parameters, auto neighbors) {
+          reader_thread_pool->Schedule(
+              [response, partition_stages, done = std::move(done),
+               parameters = std::move(parameters),
+               neighbors = std::move(neighbors)]() mutable {
+                auto records = parameters->MakeRecords(neighbors);
+                if (!records.ok()) {
+                  done(records.status());
+                  return;
+                }
+                done(ExecutePartitionStages(*parameters, **records,
+                                            partition_stages, *response));
+              },
+              vmsdk::ThreadPool::Priority::kHigh);
+        };
+        if (!parameters->FetchesReplyContent()) {
+          execute(std::move(done), std::move(parameters),
+                  std::move(neighbors.value()));
+          return;
+        }
+        vmsdk::RunByMain([execute, done = std::move(done),
+                          parameters = std::move(parameters),
+                          neighbors = std::move(
+                              neighbors.value())]() mutable {
+          auto ctx = vmsdk::MakeUniqueValkeyThreadSafeContext(nullptr);
+          ValkeyModule_SelectDb(ctx.get(), parameters->db_num);
+          auto status = parameters->FetchReplyContent(ctx.get(), neighbors);
+          if (!status.ok()) {
+            done(status);
+            return;
+          }
+          execute(std::move(done), std::move(parameters),
+                  std::move(neighbors));
+        });
+      },
+      query::SearchMode::kRemote);
+}
+
+absl::Status PerformAggregateFanoutAsync(
+    ValkeyModuleCtx *ctx,
+    std::vector<vmsdk::cluster_map::NodeInfo> &search_targets,
+    coordinator::ClientPool *coordinator_client_pool,
+    std::unique_ptr<QueryCommand> parameters, vmsdk::ThreadPool *thread_pool,
+    query::SearchResponseCallback callback) {
+  std::unique_ptr<AggregateParameters> aggregate_parameters(
+      dynamic_cast<AggregateParameters *>(parameters.release()));
+  CHECK(aggregate_parameters != nullptr);
+  coordinator::AggregateIndexPartitionRequest request;
+  request.set_db_num(aggregate_parameters->db_num);
+  request.set_index_schema_name(aggregate_parameters->index_schema_name);
+  request.set_query(aggregate_parameters->query);
+  for (const auto &argument : aggregate_parameters->arguments_) {
+    request.add_arguments(std::string(vmsdk::ToStringView(argument.get())));
+  }
+  size_t partition_stages = PartitionStageCount(*aggregate_parameters);
+  request.set_partition_stages(partition_stages);
+  request.set_timeout_ms(aggregate_parameters->timeout_ms);
+  request.set_enable_partial_results(
+      aggregate_parameters->enable_partial_results);
+  request.set_enable_consistency(aggregate_parameters->enable_consistency);
+  *request.mutable_index_fingerprint_version() =
+      aggregate_parameters->index_fingerprint_version;
+  auto tracker = std::make_shared<AggregatePartitionTracker>(
+      std::move(aggregate_parameters), partition_stages, std::move(callback),
+      thread_pool);
+  bool has_local_target = false;
+  for (auto &node : search_targets) {
+    if (node.is_local) {
+      has_local_target = true;
+      continue;
+    }
+    auto request_copy =
+        std::make_unique<coordinator::AggregateIndexPartitionRequest>(request);
+    if (node.shard != nullptr) {
+      request_copy->set_slot_fingerprint(node.shard->slots_fingerprint);
+    }
+    std::string target_address =
+        absl::StrCat(node.socket_address.primary_endpoint, ":",
+                     coordinator::GetCoordinatorPort(node.socket_address.port));
+    coordinator_client_pool->GetClient(target_address)
+        ->AggregateIndexPartition(
+            std::move(request_copy),
+            [tracker, target_address](
+                grpc::Status status,
+                coordinator::AggregateIndexPartitionResponse &response) {
+              tracker->HandleResponse(status, response, target_address);
+            });
+  }
+  if (has_local_target) {
+    auto response =
+        std::make_shared<coordinator::AggregateIndexPartitionResponse>();
+    auto status = AggregateIndexPartition(
+        nullptr, request, response.get(),
+        [tracker, response](absl::Status status) {
+          tracker->HandleResponse(ToGrpcStatus(status), *response, "local");
+        });
+    if (!status.ok()) {
+      tracker->HandleResponse(ToGrpcStatus(status), *response, "local");
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace aggregate
+}  // namespace valkey_search
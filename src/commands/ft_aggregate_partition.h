@@ -0,0 +1,81 @@
+/*
+ * Copyright Valkey Contributors.
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ */
+
+#ifndef VALKEYSEARCH_SRC_COMMANDS_FT_AGGREGATE_PARTITION_H
+#define VALKEYSEARCH_SRC_COMMANDS_FT_AGGREGATE_PARTITION_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "grpcpp/server_context.h"
+#include "src/commands/commands.h"
+#include "src/commands/ft_aggregate_exec.h"
+#include "src/commands/ft_aggregate_parser.h"
+#include "src/coordinator/client_pool.h"
+#include "src/coordinator/coordinator.pb.h"
+#include "src/query/search.h"
+#include "vmsdk/src/cluster_map.h"
+#include "vmsdk/src/thread_pool.h"
+#include "vmsdk/src/valkey_module_api/valkey_module.h"
+
+namespace valkey_search {
+namespace aggregate {
+
+//
+// Distributed FT.AGGREGATE: every partition runs the leading stages of the
+// pipeline over its own records and the coordinator merges the results
+// before running the remaining stages. FILTER and APPLY work record by
+// record. A GROUPBY whose reducers are all mergeable ends the partition
+// stages, partitions return one partial state per group and reducer. A
+// SORTBY also ends them, partitions return their top MAX records which the
+// coordinator sorts again.
+//
+size_t PartitionStageCount(const AggregateParameters& parameters);
+
+//
+// Fans the aggregation out to the search targets. The callback receives no
+// neighbors, the parameters hold the records of the whole pipeline.
+//
+absl::Status PerformAggregateFanoutAsync(
+    ValkeyModuleCtx* ctx,
+    std::vector<vmsdk::cluster_map::NodeInfo>& search_targets,
+    coordinator::ClientPool* coordinator_client_pool,
+    std::unique_ptr<QueryCommand> parameters, vmsdk::ThreadPool* thread_pool,
+    query::SearchResponseCallback callback);
+
+//
+// Serves an AggregateIndexPartition request from the local index.
+//
+absl::Status AggregateIndexPartition(
+    grpc::CallbackServerContext* context,
+    const coordinator::AggregateIndexPartitionRequest& request,
+    coordinator::AggregateIndexPartitionResponse* response,
+    absl::AnyInvocable<void(absl::Status)> done);
+
+//
+// Only here for unit tests
+//
+absl::Status ExecutePartitionStages(
+    const AggregateParameters& parameters, RecordSet& records,
+    size_t partition_stages,
+    coordinator::AggregateIndexPartitionResponse& response);
+
+absl::Status MergePartitionResults(
+    const AggregateParameters& parameters, size_t partition_stages,
+    coordinator::AggregateIndexPartitionResponse& response, RecordSet& records,
+    GroupBy::Groups& groups);
+
+absl::Status FinishPartitionResults(const AggregateParameters& parameters,
+                                    size_t partition_stages,
+                                    RecordSet& records,
+                                    GroupBy::Groups& groups);
+
+}  // namespace aggregate
+}  // namespace valkey_search
+#endif
@@ -405,12 +405,13 @@ absl::StatusOr<data_model::Attribute *> ParseAttributeArgs(
     CHECK(false);
   }
 
-  // Check for SORTABLE option and ignore it
+  // SORTABLE keeps the raw values of the attribute with its index
   if (itr.DistanceEnd() > 0) {
     auto next_arg = itr.Get();
     if (next_arg.ok()) {
       absl::string_view order_str = vmsdk::ToStringView(next_arg.value());
       if (absl::EqualsIgnoreCase(order_str, "SORTABLE")) {
+        attribute_proto->set_sortable(true);
         itr.Next();
       }
     }
@@ -0,0 +1,250 @@
+/*
+ * Copyright Valkey Contributors.
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ */
+
+#include "src/commands/ft_cursor.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/log/check.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "src/acl.h"
+#include "src/attribute_data_type.h"
+#include "src/commands/commands.h"
+#include "src/schema_manager.h"
+#include "vmsdk/src/command_parser.h"
+#include "vmsdk/src/status/status_macros.h"
+#include "vmsdk/src/type_conversions.h"
+#include "vmsdk/src/utils.h"
+#include "vmsdk/src/valkey_module_api/valkey_module.h"
+
+namespace valkey_search {
+
+constexpr absl::string_view kCountParam{"COUNT"};
+constexpr absl::string_view kDelParam{"DEL"};
+constexpr absl::string_view kReadParam{"READ"};
+
+namespace aggregate {
+
+Cursor::Cursor(std::string index_name, uint32_t db_num, ReplyFormat format,
+               std::unique_ptr<RecordSet> records,
+               std::deque<indexes::Neighbor> neighbors, size_t count,
+               absl::Duration max_idle)
+    : index_name_(std::move(index_name)),
+      db_num_(db_num),
+      format_(std::move(format)),
+      records_(std::move(records)),
+      neighbors_(std::move(neighbors)),
+      count_(count),
+      max_idle_(max_idle) {
+  // The parameters which made the records are going away.
+  records_->agg_params_ = nullptr;
+  memory_ = records_->arena_.GetBytes();
+  for (const auto &record : *records_) {
+    memory_ += RecordMemory(*record);
+  }
+  for (const auto &neighbor : neighbors_) {
+    memory_ += NeighborMemory(neighbor);
+  }
+}
+
+RecordSet Cursor::Take(size_t count) {
+  RecordSet chunk(nullptr);
+  while (!records_->empty() && chunk.size() < count) {
+    chunk.push_back(records_->pop_front());
+  }
+  return chunk;
+}
+
+size_t Cursor::RecordMemory(const Record &record) {
+  // Short strings are within the Value, views are counted where they live and
+  // longer ones are owned by it.
+  auto string_bytes = [](const expr::Value &value) -> size_t {
+    if (!value.IsString() || value.IsStringView()) {
+      return 0;
+    }
+    auto size = value.GetStringView().size();
+    return size > expr::Value::kInlineCapacity ? size : 0;
+  };
+  size_t bytes =
+      sizeof(Record) + record.fields_.capacity() * sizeof(expr::Value);
+  for (const auto &value : record.fields_) {
+    bytes += string_bytes(value);
+  }
+  for (const auto &[name, value] : record.extra_fields_) {
+    bytes += sizeof(name) + name.size() + sizeof(value) + string_bytes(value);
+  }
+  return bytes;
+}
+
+size_t Cursor::NeighborMemory(const indexes::Neighbor &neighbor) {
+  // The cursor keeps the interned key alive, even once the index drops it.
+  size_t bytes = sizeof(indexes::Neighbor) + neighbor.external_id->Str().size();
+  if (neighbor.attribute_contents.has_value()) {
+    for (const auto &[name, value] : *neighbor.attribute_contents) {
+      bytes += sizeof(RecordsMap::value_type) +
+               vmsdk::ToStringView(value.GetIdentifier()).size() +
+               vmsdk::ToStringView(value.value.get()).size();
+    }
+  }
+  return bytes;
+}
+
+absl::Status CursorMemoryError() {
+  return absl::ResourceExhaustedError(
+      "Too much memory held by cursors, read or delete some");
+}
+
+CursorStore &CursorStore::Instance() {
+  static CursorStore *store = new CursorStore();
+  return *store;
+}
+
+absl::StatusOr<uint64_t> CursorStore::Add(std::unique_ptr<Cursor> cursor,
+                                          size_t max_memory, absl::Time now) {
+  ExpireIdle(now);
+  if (GetMemory() + cursor->GetMemory() > max_memory) {
+    return CursorMemoryError();
+  }
+  uint64_t id;
+  do {
+    id = absl::Uniform<uint64_t>(gen_);
+  } while (id == 0 || cursors_.contains(id));
+  memory_ += cursor->GetMemory();
+  cursors_.emplace(id, Entry{std::move(cursor), now});
+  return id;
+}
+
+Cursor *CursorStore::Find(uint32_t db_num, absl::string_view index_name,
+                          uint64_t id, absl::Time now) {
+  ExpireIdle(now);
+  auto itr = cursors_.find(id);
+  if (itr == cursors_.end() || itr->second.cursor_->GetDbNum() != db_num ||
+      itr->second.cursor_->GetIndexName() != index_name) {
+    return nullptr;
+  }
+  itr->second.last_used_ = now;
+  return itr->second.cursor_.get();
+}
+
+bool CursorStore::Erase(uint32_t db_num, absl::string_view index_name,
+                        uint64_t id) {
+  auto itr = cursors_.find(id);
+  if (itr == cursors_.end() || itr->second.cursor_->GetDbNum() != db_num ||
+      itr->second.cursor_->GetIndexName() != index_name) {
+    return false;
+  }
+  Drop(itr);
+  return true;
+}
+
+void CursorStore::ExpireIdle(absl::Time now) {
+  for (auto itr = cursors_.begin(); itr != cursors_.end();) {
+    auto current = itr++;
+    if (now - current->second.last_used_ >
+        current->second.cursor_->GetMaxIdle()) {
+      Drop(current);
+    }
+  }
+}
+
+void CursorStore::Drop(absl::flat_hash_map<uint64_t, Entry>::iterator itr) {
+  memory_ -= itr->second.cursor_->GetMemory();
+  cursors_.erase(itr);
+}
+
+void ReplyFromCursor(ValkeyModuleCtx *ctx, uint64_t id, Cursor &cursor,
+                     size_t count) {
+  auto chunk = cursor.Take(count);
+  ValkeyModule_ReplyWithArray(ctx, 2);
+  ReplyWithRecords(ctx, cursor.GetReplyFormat(), chunk);
+  if (cursor.Exhausted()) {
+    ValkeyModule_ReplyWithLongLong(ctx, 0);
+    CHECK(CursorStore::Instance().Erase(cursor.GetDbNum(),
+                                        cursor.GetIndexName(), id));
+  } else {
+    ValkeyModule_ReplyWithLongLong(ctx, static_cast<long long>(id));
+  }
+}
+
+}  // namespace aggregate
+
+//
+// FT.CURSOR READ <index> <cursor id> [COUNT <count>]
+// FT.CURSOR DEL <index> <cursor id>
+//
+absl::Status FTCursorCmd(ValkeyModuleCtx *ctx, ValkeyModuleString **argv,
+                         int argc) {
+  if (argc < 4) {
+    ValkeyModule_ReplyWithError(ctx,
+                                vmsdk::WrongArity(kCursorCommand).c_str());
+    return absl::OkStatus();
+  }
+  vmsdk::ArgsIterator itr{argv + 1, argc - 1};
+  VMSDK_ASSIGN_OR_RETURN(auto subcommand, itr.PopNext());
+  std::string index_name;
+  VMSDK_RETURN_IF_ERROR(vmsdk::ParseParamValue(itr, index_name));
+  uint64_t id;
+  VMSDK_RETURN_IF_ERROR(vmsdk::ParseParamValue(itr, id));
+  uint32_t db_num = ValkeyModule_GetSelectedDb(ctx);
+  VMSDK_ASSIGN_OR_RETURN(
+      auto index_schema,
+      SchemaManager::Instance().GetIndexSchema(db_num, index_name));
+  VMSDK_RETURN_IF_ERROR(AclPrefixCheck(ctx, acl::KeyAccess::kRead,
+                                       index_schema->GetKeyPrefixes()));
+
+  auto &store = aggregate::CursorStore::Instance();
+  auto not_found = [&]() {
+    return absl::NotFoundError(absl::StrCat("Cursor not found, id: ", id));
+  };
+  if (absl::EqualsIgnoreCase(vmsdk::ToStringView(subcommand), kReadParam)) {
+    auto cursor = store.Find(db_num, index_name, id, absl::Now());
+    if (cursor == nullptr) {
+      return not_found();
+    }
+    uint32_t count = cursor->GetCount();
+    if (itr.PopIfNextIgnoreCase(kCountParam)) {
+      VMSDK_RETURN_IF_ERROR(vmsdk::ParseParamValue(itr, count));
+      if (count == 0) {
+        return absl::InvalidArgumentError("COUNT must be positive");
+      }
+    }
+    if (itr.HasNext()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unexpected parameter at position ", (itr.Position() + 1), ":",
+          vmsdk::ToStringView(itr.Get().value())));
+    }
+    aggregate::ReplyFromCursor(ctx, id, *cursor, count);
+    return absl::OkStatus();
+  }
+  if (absl::EqualsIgnoreCase(vmsdk::ToStringView(subcommand), kDelParam)) {
+    if (itr.HasNext()) {
+      ValkeyModule_ReplyWithError(ctx,
+                                  vmsdk::WrongArity(kCursorCommand).c_str());
+      return absl::OkStatus();
+    }
+    if (!store.Erase(db_num, index_name, id)) {
+      return not_found();
+    }
+    ValkeyModule_ReplyWithSimpleString(ctx, "OK");
+    return absl::OkStatus();
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown subcommand: ", vmsdk::ToStringView(subcommand)));
+}
+
+}  // namespace valkey_search
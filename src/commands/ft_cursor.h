@@ -0,0 +1,141 @@
+/*
+ * Copyright Valkey Contributors.
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ */
+
+#ifndef VALKEYSEARCH_SRC_COMMANDS_FT_CURSOR_H
+#define VALKEYSEARCH_SRC_COMMANDS_FT_CURSOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "src/commands/ft_aggregate_exec.h"
+#include "src/commands/ft_aggregate_parser.h"
+#include "src/index_schema.pb.h"
+#include "src/indexes/vector_base.h"
+#include "vmsdk/src/valkey_module_api/valkey_module.h"
+
+namespace valkey_search {
+namespace aggregate {
+
+//
+// What's needed to write records to the client, once the parameters of the
+// command which made them are gone.
+//
+struct ReplyFormat {
+  data_model::AttributeDataType data_type_;
+  std::vector<AggregateParameters::AttributeRecordInfo> record_info_by_index_;
+  int dialect_;
+};
+
+// Replies with the records, emptying the set.
+void ReplyWithRecords(ValkeyModuleCtx* ctx, const ReplyFormat& format,
+                      RecordSet& records);
+
+//
+// The records of a FT.AGGREGATE WITHCURSOR which weren't returned yet. The
+// cursor also holds the neighbors, whose contents the records may reference.
+//
+class Cursor {
+ public:
+  Cursor(std::string index_name, uint32_t db_num, ReplyFormat format,
+         std::unique_ptr<RecordSet> records,
+         std::deque<indexes::Neighbor> neighbors, size_t count,
+         absl::Duration max_idle);
+
+  const std::string& GetIndexName() const { return index_name_; }
+  uint32_t GetDbNum() const { return db_num_; }
+  const ReplyFormat& GetReplyFormat() const { return format_; }
+  // The number of records per read, unless the read asks otherwise.
+  size_t GetCount() const { return count_; }
+  absl::Duration GetMaxIdle() const { return max_idle_; }
+  bool Exhausted() const { return records_->empty(); }
+  // The approximate number of bytes held by the records, the neighbors and
+  // the arena. Taking records doesn't change it, as the neighbors and the
+  // arena are only freed with the whole cursor.
+  size_t GetMemory() const { return memory_; }
+
+  // Takes up to count records off the front. Their strings may live in the
+  // cursor, which must outlive them.
+  RecordSet Take(size_t count);
+
+  // The bytes of the record besides the strings it references, which live in
+  // the neighbors or the arena.
+  static size_t RecordMemory(const Record& record);
+  // The bytes of the neighbor, counting its key and fetched contents.
+  static size_t NeighborMemory(const indexes::Neighbor& neighbor);
+
+ private:
+  std::string index_name_;
+  uint32_t db_num_;
+  ReplyFormat format_;
+  std::unique_ptr<RecordSet> records_;
+  std::deque<indexes::Neighbor> neighbors_;
+  size_t count_;
+  absl::Duration max_idle_;
+  size_t memory_{0};
+};
+
+//
+// The open cursors, by id. Cursors which weren't read for their max idle time
+// are dropped by the server cron, or before the store is next used. Only used
+// on the main thread, except for GetMemory.
+//
+class CursorStore {
+ public:
+  static CursorStore& Instance();
+
+  // Stores the cursor and returns its id: random, so that clients can't guess
+  // each other's cursors, and never 0. Fails if the cursors would then hold
+  // more than max_memory bytes.
+  absl::StatusOr<uint64_t> Add(std::unique_ptr<Cursor> cursor,
+                               size_t max_memory, absl::Time now);
+  // The cursor with the id, if it's on the index and still open. Finding a
+  // cursor restarts its idle time.
+  Cursor* Find(uint32_t db_num, absl::string_view index_name, uint64_t id,
+               absl::Time now);
+  // Returns false if there's no such cursor on the index.
+  bool Erase(uint32_t db_num, absl::string_view index_name, uint64_t id);
+  void ExpireIdle(absl::Time now);
+
+  size_t Size() const { return cursors_.size(); }
+  // The bytes held by the cursors. Readable from any thread, so that the
+  // records of a new cursor can be bounded while they are made.
+  size_t GetMemory() const { return memory_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Entry {
+    std::unique_ptr<Cursor> cursor_;
+    absl::Time last_used_;
+  };
+  void Drop(absl::flat_hash_map<uint64_t, Entry>::iterator itr);
+
+  absl::flat_hash_map<uint64_t, Entry> cursors_;
+  absl::BitGen gen_;
+  std::atomic<size_t> memory_{0};
+};
+
+// The error of a cursor which would take the cursors over their max memory.
+absl::Status CursorMemoryError();
+
+// Replies with up to count records of the cursor and the id to read on from,
+// or 0 once nothing is left, when the cursor is dropped from the store.
+void ReplyFromCursor(ValkeyModuleCtx* ctx, uint64_t id, Cursor& cursor,
+                     size_t count);
+
+}  // namespace aggregate
+}  // namespace valkey_search
+
+#endif  // VALKEYSEARCH_SRC_COMMANDS_FT_CURSOR_H
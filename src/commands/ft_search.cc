@@ -27,6 +27,7 @@
 #include "src/query/response_generator.h"
 #include "src/query/search.h"
 #include "vmsdk/src/managed_pointers.h"
+#include "vmsdk/src/status/status_macros.h"
 #include "vmsdk/src/type_conversions.h"
 #include "vmsdk/src/valkey_module_api/valkey_module.h"
 
@@ -39,7 +40,8 @@ void ReplyAvailNeighbors(ValkeyModuleCtx *ctx,
                          const std::deque<indexes::Neighbor> &neighbors,
                          const query::SearchParameters &parameters) {
   if (parameters.IsNonVectorQuery()) {
-    ValkeyModule_ReplyWithLongLong(ctx, neighbors.size());
+    ValkeyModule_ReplyWithLongLong(
+        ctx, parameters.total_count.value_or(neighbors.size()));
   } else {
     ValkeyModule_ReplyWithLongLong(
         ctx, std::min(neighbors.size(), static_cast<size_t>(parameters.k)));
@@ -183,7 +185,7 @@ void SearchCommand::SendReply(ValkeyModuleCtx *ctx,
        (limit.first_index >= static_cast<uint64_t>(k))) ||
       limit.number == 0) {
     ValkeyModule_ReplyWithArray(ctx, 1);
-    ValkeyModule_ReplyWithLongLong(ctx, neighbors.size());
+    ValkeyModule_ReplyWithLongLong(ctx, total_count.value_or(neighbors.size()));
     return;
   }
   if (no_content) {
@@ -209,6 +211,26 @@ void SearchCommand::SendReply(ValkeyModuleCtx *ctx,
   SerializeNeighbors(ctx, neighbors, *this);
 }
 
+bool SearchCommand::OffloadsReply() const {
+  return options::GetContentFetchBatchSize().GetValue() > 0 && !no_content &&
+         limit.number != 0 &&
+         (IsNonVectorQuery() || limit.first_index < static_cast<uint64_t>(k));
+}
+
+absl::Status SearchCommand::FetchReplyContent(
+    ValkeyModuleCtx *ctx, std::deque<indexes::Neighbor> &neighbors) {
+  if (IsNonVectorQuery()) {
+    query::ProcessNonVectorNeighborsForReply(
+        ctx, index_schema->GetAttributeDataType(), neighbors, *this);
+    return absl::OkStatus();
+  }
+  VMSDK_ASSIGN_OR_RETURN(auto identifier,
+                         index_schema->GetIdentifier(attribute_alias));
+  query::ProcessNeighborsForReply(ctx, index_schema->GetAttributeDataType(),
+                                  neighbors, *this, identifier);
+  return absl::OkStatus();
+}
+
 absl::Status FTSearchCmd(ValkeyModuleCtx *ctx, ValkeyModuleString **argv,
                          int argc) {
   return QueryCommand::Execute(ctx, argv, argc,
@@ -469,6 +469,9 @@ absl::Status SearchCommand::ParseCommand(vmsdk::ArgsIterator &itr) {
   VMSDK_RETURN_IF_ERROR(PreParseQueryString(*this));
   VMSDK_RETURN_IF_ERROR(PostParseQueryString(*this));
   VMSDK_RETURN_IF_ERROR(VerifyQueryString(*this));
+  // FT.SEARCH does not sort non-vector results, the reply is the leading
+  // matches in index order.
+  limit_non_vector_neighbors = true;
   return absl::OkStatus();
 }
 
@@ -36,6 +36,11 @@ struct SearchCommand : public QueryCommand {
   absl::Status ParseCommand(vmsdk::ArgsIterator &itr) override;
   void SendReply(ValkeyModuleCtx *ctx,
                  std::deque<indexes::Neighbor> &neighbors) override;
+  // With a content fetch batch size, the content is fetched off the main
+  // thread, leaving SendReply to only write it.
+  bool OffloadsReply() const override;
+  absl::Status FetchReplyContent(
+      ValkeyModuleCtx *ctx, std::deque<indexes::Neighbor> &neighbors) override;
 };
 
 }  // namespace valkey_search
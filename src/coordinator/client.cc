@@ -181,6 +181,42 @@ void ClientImpl::SearchIndexPartition(
       });
 }
 
+void ClientImpl::AggregateIndexPartition(
+    std::unique_ptr<AggregateIndexPartitionRequest> request,
+    AggregateIndexPartitionCallback done) {
+  struct AggregateIndexPartitionArgs {
+    ::grpc::ClientContext context;
+    std::unique_ptr<AggregateIndexPartitionRequest> request;
+    AggregateIndexPartitionResponse response;
+    AggregateIndexPartitionCallback callback;
+  };
+  auto args = std::make_unique<AggregateIndexPartitionArgs>();
+  args->context.set_deadline(absl::ToChronoTime(
+      absl::Now() + absl::Seconds(query_connection_timeout->GetValue())));
+  args->callback = std::move(done);
+  args->request = std::move(request);
+  auto args_raw = args.release();
+  Metrics::GetStats().coordinator_bytes_out.fetch_add(
+      args_raw->request->ByteSizeLong(), std::memory_order_relaxed);
+  stub_->async()->AggregateIndexPartition(
+      &args_raw->context, args_raw->request.get(), &args_raw->response,
+      // std::function is not move-only.
+      [args_raw](grpc::Status s) mutable {
+        GRPCSuspensionGuard guard(GRPCSuspender::Instance());
+        auto args = std::unique_ptr<AggregateIndexPartitionArgs>(args_raw);
+        args->callback(s, args->response);
+        if (s.ok()) {
+          Metrics::GetStats()
+              .coordinator_client_aggregate_index_partition_success_cnt++;
+          Metrics::GetStats().coordinator_bytes_in.fetch_add(
+              args->response.ByteSizeLong(), std::memory_order_relaxed);
+        } else {
+          Metrics::GetStats()
+              .coordinator_client_aggregate_index_partition_failure_cnt++;
+        }
+      });
+}
+
 void ClientImpl::InfoIndexPartition(
     std::unique_ptr<InfoIndexPartitionRequest> request,
     InfoIndexPartitionCallback done, int timeout_ms) {
@@ -24,6 +24,8 @@ using GetGlobalMetadataCallback =
     absl::AnyInvocable<void(grpc::Status, GetGlobalMetadataResponse&)>;
 using SearchIndexPartitionCallback =
     absl::AnyInvocable<void(grpc::Status, SearchIndexPartitionResponse&)>;
+using AggregateIndexPartitionCallback =
+    absl::AnyInvocable<void(grpc::Status, AggregateIndexPartitionResponse&)>;
 using InfoIndexPartitionCallback =
     absl::AnyInvocable<void(grpc::Status, InfoIndexPartitionResponse&)>;
 
@@ -34,6 +36,9 @@ class Client {
   virtual void SearchIndexPartition(
       std::unique_ptr<SearchIndexPartitionRequest> request,
       SearchIndexPartitionCallback done) = 0;
+  virtual void AggregateIndexPartition(
+      std::unique_ptr<AggregateIndexPartitionRequest> request,
+      AggregateIndexPartitionCallback done) = 0;
   virtual void InfoIndexPartition(
       std::unique_ptr<InfoIndexPartitionRequest> request,
       InfoIndexPartitionCallback done, int timeout_ms = 5000) = 0;
@@ -55,6 +60,9 @@ class ClientImpl : public Client {
   void SearchIndexPartition(
       std::unique_ptr<SearchIndexPartitionRequest> request,
       SearchIndexPartitionCallback done) override;
+  void AggregateIndexPartition(
+      std::unique_ptr<AggregateIndexPartitionRequest> request,
+      AggregateIndexPartitionCallback done) override;
   void InfoIndexPartition(std::unique_ptr<InfoIndexPartitionRequest> request,
                           InfoIndexPartitionCallback done,
                           int timeout_ms = 5000) override;
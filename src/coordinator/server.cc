@@ -260,6 +260,68 @@ grpc::ServerUnaryReactor* Service::SearchIndexPartition(
   return reactor;
 }
 
+AggregateIndexPartitionHandler Service::aggregate_index_partition_handler_ =
+    nullptr;
+
+void RecordAggregateMetrics(bool failure) {
+  if (failure) {
+    Metrics::GetStats()
+        .coordinator_server_aggregate_index_partition_failure_cnt++;
+  } else {
+    Metrics::GetStats()
+        .coordinator_server_aggregate_index_partition_success_cnt++;
+  }
+}
+
+grpc::ServerUnaryReactor* Service::AggregateIndexPartition(
+    grpc::CallbackServerContext* context,
+    const AggregateIndexPartitionRequest* request,
+    AggregateIndexPartitionResponse* response) {
+  GRPCSuspensionGuard guard(GRPCSuspender::Instance());
+  grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+  auto finish = [reactor](const grpc::Status& status) {
+    reactor->Finish(status);
+    RecordAggregateMetrics(!status.ok());
+  };
+  if (aggregate_index_partition_handler_ == nullptr) {
+    finish({grpc::StatusCode::UNIMPLEMENTED,
+            "FT.AGGREGATE is not available on this node"});
+    return reactor;
+  }
+  auto schema = SchemaManager::Instance().GetIndexSchema(
+      request->db_num(), request->index_schema_name());
+  if (!schema.ok()) {
+    finish(ToGrpcStatus(schema.status()));
+    return reactor;
+  }
+  // perform index consistency check (index fingerprint/version), required
+  auto index_consistency_status = PerformIndexConsistencyCheck(
+      request->index_fingerprint_version(), *schema);
+  if (!index_consistency_status.ok()) {
+    finish(index_consistency_status);
+    return reactor;
+  }
+  // perform slot consistency check if in CONSISTENT mode only
+  if (request->enable_consistency()) {
+    auto slot_consistency_status =
+        PerformSlotConsistencyCheck(request->slot_fingerprint());
+    if (!slot_consistency_status.ok()) {
+      finish(slot_consistency_status);
+      return reactor;
+    }
+  }
+  auto status = aggregate_index_partition_handler_(
+      context, *request, response, [finish](absl::Status status) {
+        finish(ToGrpcStatus(status));
+      });
+  if (!status.ok()) {
+    VMSDK_LOG(WARNING, detached_ctx_.get())
+        << "Failed to enqueue aggregate request: " << status.message();
+    finish(ToGrpcStatus(status));
+  }
+  return reactor;
+}
+
 std::pair<grpc::Status, coordinator::InfoIndexPartitionResponse>
 Service::GenerateInfoResponse(
     const coordinator::InfoIndexPartitionRequest& request) {
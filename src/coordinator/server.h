@@ -12,6 +12,8 @@
 #include <memory>
 #include <utility>
 
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
 #include "grpcpp/server.h"
 #include "grpcpp/server_context.h"
 #include "grpcpp/support/server_callback.h"
@@ -25,6 +27,15 @@
 
 namespace valkey_search::coordinator {
 
+// Runs an AggregateIndexPartition request over the local index and calls
+// `done` once the response is filled in, unless it fails to start. The
+// aggregation pipeline belongs to FT.AGGREGATE, which registers the handler.
+using AggregateIndexPartitionHandler = absl::Status (*)(
+    grpc::CallbackServerContext* context,
+    const AggregateIndexPartitionRequest& request,
+    AggregateIndexPartitionResponse* response,
+    absl::AnyInvocable<void(absl::Status)> done);
+
 class Service final : public Coordinator::CallbackService {
  public:
   Service(vmsdk::UniqueValkeyDetachedThreadSafeContext detached_ctx,
@@ -49,11 +60,21 @@ class Service final : public Coordinator::CallbackService {
       const SearchIndexPartitionRequest* request,
       SearchIndexPartitionResponse* response) override;
 
+  grpc::ServerUnaryReactor* AggregateIndexPartition(
+      grpc::CallbackServerContext* context,
+      const AggregateIndexPartitionRequest* request,
+      AggregateIndexPartitionResponse* response) override;
+
   grpc::ServerUnaryReactor* InfoIndexPartition(
       grpc::CallbackServerContext* context,
       const InfoIndexPartitionRequest* request,
       InfoIndexPartitionResponse* response) override;
 
+  static void SetAggregateIndexPartitionHandler(
+      AggregateIndexPartitionHandler handler) {
+    aggregate_index_partition_handler_ = handler;
+  }
+
  private:
   static grpc::Status PerformSlotConsistencyCheck(
       uint64_t expected_slot_fingerprint);
@@ -72,6 +93,8 @@ class Service final : public Coordinator::CallbackService {
       SearchIndexPartitionResponse* response, grpc::ServerUnaryReactor* reactor,
       std::unique_ptr<vmsdk::StopWatch> latency_sample);
 
+  static AggregateIndexPartitionHandler aggregate_index_partition_handler_;
+
   vmsdk::UniqueValkeyDetachedThreadSafeContext detached_ctx_;
   vmsdk::ThreadPool* reader_thread_pool_;
 };
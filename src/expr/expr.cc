@@ -10,8 +10,13 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <sstream>
+#include <type_traits>
 #include <utility>
 
+#include "absl/base/casts.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/strings/str_cat.h"
 #include "src/utils/scanner.h"
 #include "vmsdk/src/status/status_macros.h"
@@ -25,50 +30,160 @@ namespace expr {
 
 using ExprPtr = std::unique_ptr<Expression>;
 
-struct Constant : Expression {
+void Expression::AttributeReference::GetValues(
+    EvalContext& ctx, absl::Span<const Record* const> records,
+    Column& values) const {
+  values.Reset(records.size());
+  for (size_t row = 0; row < records.size(); ++row) {
+    values.Set(row, GetValue(ctx, *records[row]));
+  }
+}
+
+void Expression::EvaluateBatch(EvalContext& ctx,
+                               absl::Span<const Record* const> records,
+                               Column& result) const {
+  result.Reset(records.size());
+  for (size_t row = 0; row < records.size(); ++row) {
+    result.Set(row, Evaluate(ctx, *records[row]));
+  }
+}
+
+// Fills a column with a single value. Strings are referenced rather than
+// copied into every row, the expression outlives the evaluation.
+static void FillColumn(const Value& value, size_t size, Column& result) {
+  if (value.IsBool()) {
+    result.Reset(size, Column::Kind::kBool);
+  } else if (value.IsString()) {
+    result.Reset(size, Column::Kind::kBoxed);
+    Value view(value.GetStringView());
+    for (size_t row = 0; row < size; ++row) {
+      result.Set(row, view);
+    }
+    return;
+  } else {
+    result.Reset(size);
+  }
+  for (size_t row = 0; row < size; ++row) {
+    result.Set(row, value);
+  }
+}
+
+//
+// The nodes of a compiled expression, with the hooks the optimizer uses to
+// walk and rewrite the tree.
+//
+struct Node : Expression {
+  // Calls f on each operand, which f may replace.
+  virtual void ForEachOperand(absl::FunctionRef<void(ExprPtr&)> f) {}
+  // The value of a node which doesn't depend on the record, else nullptr.
+  virtual const Value* ConstantValue() const { return nullptr; }
+  // Appends the node's part of the Key.
+  virtual void AppendKey(std::string& key) const = 0;
+};
+
+static Node& AsNode(const ExprPtr& e) { return static_cast<Node&>(*e); }
+
+std::string Expression::Key() const {
+  std::string key;
+  static_cast<const Node*>(this)->AppendKey(key);
+  return key;
+}
+
+// An exact and self delimiting rendering of a value, for keys.
+static void AppendValueKey(const Value& value, std::string& key) {
+  if (value.IsNil()) {
+    key += "N;";
+  } else if (value.IsBool()) {
+    key += value.GetBool() ? "B1;" : "B0;";
+  } else if (value.IsDouble()) {
+    absl::StrAppend(&key, "D", absl::bit_cast<uint64_t>(value.GetDouble()),
+                    ";");
+  } else {
+    auto s = value.GetStringView();
+    absl::StrAppend(&key, "S", s.size(), ":", s);
+  }
+}
+
+struct Constant : Node {
   Constant(std::string constant) : constant_(std::move(constant)) {}
   Constant(double constant) : constant_(constant) {}
+  // A folded value. It owns its string, the operands it came from are gone.
+  explicit Constant(const Value& value)
+      : constant_(value.IsString() ? Value::MakeString(value.GetStringView())
+                                   : value) {}
   Value Evaluate(EvalContext& ctx, const Record& record) const override {
     return constant_;
   }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    FillColumn(constant_, records.size(), result);
+  }
   void Dump(std::ostream& os) const override {
     os << "Constant(" << constant_ << ")";
   }
+  const Value* ConstantValue() const override { return &constant_; }
+  void AppendKey(std::string& key) const override {
+    AppendValueKey(constant_, key);
+  }
 
  private:
   Value constant_;
 };
 
-struct Parameter : Expression {
+struct Parameter : Node {
   Parameter(std::string&& name, Value&& value)
       : name_(std::move(name)), value_(std::move(value)) {}
   Value Evaluate(EvalContext& ctx, const Record& record) const override {
     return value_;
   }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    FillColumn(value_, records.size(), result);
+  }
   void Dump(std::ostream& os) const override {
     os << "$" << name_ << "(" << value_ << ")";
   }
+  const Value* ConstantValue() const override { return &value_; }
+  void AppendKey(std::string& key) const override {
+    AppendValueKey(value_, key);
+  }
 
  private:
   std::string name_;
   Value value_;
 };
 
-struct AttributeValue : Expression {
+struct AttributeValue : Node {
+  // The key, when given, is that of the expression whose value the attribute
+  // holds.
   AttributeValue(std::string identifier,
-                 std::unique_ptr<AttributeReference> ref)
-      : identifier_(std::move(identifier)), ref_(std::move(ref)) {}
+                 std::unique_ptr<AttributeReference> ref, std::string key = "")
+      : identifier_(std::move(identifier)),
+        ref_(std::move(ref)),
+        key_(std::move(key)) {}
   Value Evaluate(EvalContext& ctx, const Record& record) const override {
     return ref_->GetValue(ctx, record);
   }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    ref_->GetValues(ctx, records, result);
+  }
   void Dump(std::ostream& os) const override { os << '@' << identifier_; }
+  void AppendKey(std::string& key) const override {
+    if (key_.empty()) {
+      absl::StrAppend(&key, "@", identifier_.size(), ":", identifier_);
+    } else {
+      key += key_;
+    }
+  }
 
  private:
   std::string identifier_;
   std::unique_ptr<AttributeReference> ref_;
+  std::string key_;
 };
 
-struct Not : Expression {
+struct Not : Node {
   Not(ExprPtr&& p) : expr_(std::move(p)) {}
   Value Evaluate(EvalContext& ctx, const Record& record) const override {
     auto Primary = expr_->Evaluate(ctx, record).AsBool();
@@ -78,26 +193,60 @@ struct Not : Expression {
       return Value{};
     }
   }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    Column operand;
+    expr_->EvaluateBatch(ctx, records, operand);
+    // Value::AsBool never fails, so neither does the negation.
+    result.Reset(records.size(), Column::Kind::kBool);
+    for (size_t row = 0; row < records.size(); ++row) {
+      result.Set(row, Value(!operand.IsTrue(row)));
+    }
+  }
   void Dump(std::ostream& os) const override {
     os << '!';
     expr_->Dump(os);
   }
+  void ForEachOperand(absl::FunctionRef<void(ExprPtr&)> f) override {
+    f(expr_);
+  }
+  void AppendKey(std::string& key) const override {
+    key += '!';
+    AsNode(expr_).AppendKey(key);
+  }
 
  private:
   ExprPtr expr_;
 };
 
-struct FunctionCall : Expression {
+struct FunctionTableEntry;
+
+struct FunctionCall : Node {
   using Func = Value (*)(EvalContext& ctx, const Record& record,
                          const absl::InlinedVector<ExprPtr, 4>& params);
-  static absl::StatusOr<Func> LookUpAndValidate(
+  using ColumnFunc = void (*)(EvalContext& ctx,
+                              absl::Span<const Record* const> records,
+                              const absl::InlinedVector<ExprPtr, 4>& params,
+                              Column& result);
+  static absl::StatusOr<const FunctionTableEntry*> LookUpAndValidate(
       const std::string& name, const absl::InlinedVector<ExprPtr, 4>& params);
-  FunctionCall(std::string name, Func func,
+  FunctionCall(std::string name, Func func, ColumnFunc column_func,
                absl::InlinedVector<ExprPtr, 4> params)
-      : name_(std::move(name)), func_(func), params_(std::move(params)) {}
+      : name_(std::move(name)),
+        func_(func),
+        column_func_(column_func),
+        params_(std::move(params)) {}
   Value Evaluate(EvalContext& ctx, const Record& record) const override {
     return (*func_)(ctx, record, params_);
   }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    if (column_func_) {
+      (*column_func_)(ctx, records, params_, result);
+    } else {
+      Expression::EvaluateBatch(ctx, records, result);
+    }
+  }
   void Dump(std::ostream& os) const override {
     os << name_ << '(';
     for (auto& p : params_) {
@@ -108,43 +257,118 @@ struct FunctionCall : Expression {
     }
     os << ')';
   }
+  void ForEachOperand(absl::FunctionRef<void(ExprPtr&)> f) override {
+    for (auto& p : params_) {
+      f(p);
+    }
+  }
+  void AppendKey(std::string& key) const override {
+    key += name_;
+    key += '(';
+    for (auto& p : params_) {
+      AsNode(p).AppendKey(key);
+      key += ',';
+    }
+    key += ')';
+  }
 
  private:
   std::string name_;
   Func func_;
+  ColumnFunc column_func_;
   absl::InlinedVector<ExprPtr, 4> params_;
 };
 
-template <Value (*func1)(const Value& o)>
+// Calls a function of the values, passing the arena to those computing
+// strings.
+template <auto func, typename... Values>
+Value Call(Expression::EvalContext& ctx, const Values&... values) {
+  if constexpr (std::is_invocable_v<decltype(func), const Values&...,
+                                    Arena*>) {
+    return (*func)(values..., ctx.arena_);
+  } else {
+    return (*func)(values...);
+  }
+}
+
+template <auto func1>
 Value MonadicFunctionProxy(
     Expression::EvalContext& ctx, const Expression::Record& record,
     const absl::InlinedVector<expr::ExprPtr, 4>& params) {
   CHECK(params.size() == 1);
-  return (*func1)(params[0]->Evaluate(ctx, record));
+  return Call<func1>(ctx, params[0]->Evaluate(ctx, record));
 };
 
-template <Value (*func2)(const Value& l, const Value& r)>
+template <auto func2>
 Value DyadicFunctionProxy(Expression::EvalContext& ctx,
                           const Expression::Record& record,
                           const absl::InlinedVector<expr::ExprPtr, 4>& params) {
   CHECK(params.size() == 2);
-  return (*func2)(params[0]->Evaluate(ctx, record),
-                  params[1]->Evaluate(ctx, record));
+  return Call<func2>(ctx, params[0]->Evaluate(ctx, record),
+                     params[1]->Evaluate(ctx, record));
 };
 
-template <Value (*func3)(const Value& l, const Value& m, const Value& r)>
+template <auto func3>
 Value TriadicFunctionProxy(
     Expression::EvalContext& ctx, const Expression::Record& record,
     const absl::InlinedVector<expr::ExprPtr, 4>& params) {
   CHECK(params.size() == 3);
-  return (*func3)(params[0]->Evaluate(ctx, record),
-                  params[1]->Evaluate(ctx, record),
-                  params[2]->Evaluate(ctx, record));
+  return Call<func3>(ctx, params[0]->Evaluate(ctx, record),
+                     params[1]->Evaluate(ctx, record),
+                     params[2]->Evaluate(ctx, record));
 };
 
-using Func = Value (*)(Expression::EvalContext& ctx,
-                       const Expression::Record& record,
-                       const absl::InlinedVector<ExprPtr, 4>& params);
+//
+// The column versions evaluate the parameters a batch at a time, then apply
+// the function row by row.
+//
+template <auto func1>
+void MonadicColumnProxy(Expression::EvalContext& ctx,
+                        absl::Span<const Expression::Record* const> records,
+                        const absl::InlinedVector<expr::ExprPtr, 4>& params,
+                        Column& result) {
+  CHECK(params.size() == 1);
+  Column operand;
+  params[0]->EvaluateBatch(ctx, records, operand);
+  result.Reset(records.size());
+  for (size_t row = 0; row < records.size(); ++row) {
+    result.Set(row, Call<func1>(ctx, operand.Get(row)));
+  }
+}
+
+template <auto func2>
+void DyadicColumnProxy(Expression::EvalContext& ctx,
+                       absl::Span<const Expression::Record* const> records,
+                       const absl::InlinedVector<expr::ExprPtr, 4>& params,
+                       Column& result) {
+  CHECK(params.size() == 2);
+  Column l, r;
+  params[0]->EvaluateBatch(ctx, records, l);
+  params[1]->EvaluateBatch(ctx, records, r);
+  result.Reset(records.size());
+  for (size_t row = 0; row < records.size(); ++row) {
+    result.Set(row, Call<func2>(ctx, l.Get(row), r.Get(row)));
+  }
+}
+
+template <auto func3>
+void TriadicColumnProxy(Expression::EvalContext& ctx,
+                        absl::Span<const Expression::Record* const> records,
+                        const absl::InlinedVector<expr::ExprPtr, 4>& params,
+                        Column& result) {
+  CHECK(params.size() == 3);
+  Column l, m, r;
+  params[0]->EvaluateBatch(ctx, records, l);
+  params[1]->EvaluateBatch(ctx, records, m);
+  params[2]->EvaluateBatch(ctx, records, r);
+  result.Reset(records.size());
+  for (size_t row = 0; row < records.size(); ++row) {
+    result.Set(row, Call<func3>(ctx, l.Get(row), m.Get(row), r.Get(row)));
+  }
+}
+
+using Func = FunctionCall::Func;
+using ColumnFunc = FunctionCall::ColumnFunc;
 
 Value FuncExists(const Value& o) { return Value(!o.IsNil()); }
 
@@ -155,7 +379,7 @@ Value ProxyConcat(Expression::EvalContext& ctx,
   for (auto& p : params) {
     values.emplace_back(p->Evaluate(ctx, record));
   }
-  return FuncConcat(values);
+  return FuncConcat(values, ctx.arena_);
 }
 
 Value ProxyTimefmt(Expression::EvalContext& ctx,
@@ -166,7 +390,7 @@ Value ProxyTimefmt(Expression::EvalContext& ctx,
   if (params.size() > 1) {
     fmt = params[1]->Evaluate(ctx, record);
   }
-  return FuncTimefmt(params[0]->Evaluate(ctx, record), fmt);
+  return FuncTimefmt(params[0]->Evaluate(ctx, record), fmt, ctx.arena_);
 }
 
 Value ProxyParsetime(Expression::EvalContext& ctx,
@@ -184,42 +408,89 @@ struct FunctionTableEntry {
   size_t min_argc;
   size_t max_argc;
   Func function;
+  ColumnFunc column_function{nullptr};
+  // The function only uses its operands as numbers.
+  bool numeric{false};
 };
 
 static std::map<std::string, FunctionTableEntry> function_table{
-    {"exists", {1, 1, &MonadicFunctionProxy<FuncExists>}},
-
-    {"abs", {1, 1, &MonadicFunctionProxy<FuncAbs>}},
-    {"ceil", {1, 1, &MonadicFunctionProxy<FuncCeil>}},
-    {"exp", {1, 1, &MonadicFunctionProxy<FuncExp>}},
-    {"floor", {1, 1, &MonadicFunctionProxy<FuncFloor>}},
-    {"log", {1, 1, &MonadicFunctionProxy<FuncLog>}},
-    {"log2", {1, 1, &MonadicFunctionProxy<FuncLog2>}},
-    {"sqrt", {1, 1, &MonadicFunctionProxy<FuncSqrt>}},
-
-    {"startswith", {2, 2, &DyadicFunctionProxy<FuncStartswith>}},
-    {"lower", {1, 1, &MonadicFunctionProxy<FuncLower>}},
-    {"upper", {1, 1, &MonadicFunctionProxy<FuncUpper>}},
-    {"strlen", {1, 1, &MonadicFunctionProxy<FuncStrlen>}},
-    {"substr", {3, 3, &TriadicFunctionProxy<FuncSubstr>}},
-    {"contains", {2, 2, &DyadicFunctionProxy<FuncContains>}},
+    {"exists",
+     {1, 1, &MonadicFunctionProxy<FuncExists>,
+      &MonadicColumnProxy<FuncExists>}},
+
+    {"abs",
+     {1, 1, &MonadicFunctionProxy<FuncAbs>, &MonadicColumnProxy<FuncAbs>,
+      true}},
+    {"ceil",
+     {1, 1, &MonadicFunctionProxy<FuncCeil>, &MonadicColumnProxy<FuncCeil>,
+      true}},
+    {"exp",
+     {1, 1, &MonadicFunctionProxy<FuncExp>, &MonadicColumnProxy<FuncExp>,
+      true}},
+    {"floor",
+     {1, 1, &MonadicFunctionProxy<FuncFloor>, &MonadicColumnProxy<FuncFloor>,
+      true}},
+    {"log",
+     {1, 1, &MonadicFunctionProxy<FuncLog>, &MonadicColumnProxy<FuncLog>,
+      true}},
+    {"log2",
+     {1, 1, &MonadicFunctionProxy<FuncLog2>, &MonadicColumnProxy<FuncLog2>,
+      true}},
+    {"sqrt",
+     {1, 1, &MonadicFunctionProxy<FuncSqrt>, &MonadicColumnProxy<FuncSqrt>,
+      true}},
+
+    {"startswith",
+     {2, 2, &DyadicFunctionProxy<FuncStartswith>,
+      &DyadicColumnProxy<FuncStartswith>}},
+    {"lower",
+     {1, 1, &MonadicFunctionProxy<FuncLower>, &MonadicColumnProxy<FuncLower>}},
+    {"upper",
+     {1, 1, &MonadicFunctionProxy<FuncUpper>, &MonadicColumnProxy<FuncUpper>}},
+    {"strlen",
+     {1, 1, &MonadicFunctionProxy<FuncStrlen>,
+      &MonadicColumnProxy<FuncStrlen>}},
+    {"substr",
+     {3, 3, &TriadicFunctionProxy<FuncSubstr>,
+      &TriadicColumnProxy<FuncSubstr>}},
+    {"contains",
+     {2, 2, &DyadicFunctionProxy<FuncContains>,
+      &DyadicColumnProxy<FuncContains>}},
     {"concat", {0, 50, &ProxyConcat}},
 
-    {"dayofweek", {1, 1, &MonadicFunctionProxy<FuncDayofweek>}},
-    {"dayofmonth", {1, 1, &MonadicFunctionProxy<FuncDayofmonth>}},
-    {"dayofyear", {1, 1, &MonadicFunctionProxy<FuncDayofyear>}},
-    {"monthofyear", {1, 1, &MonadicFunctionProxy<FuncMonthofyear>}},
-    {"year", {1, 1, &MonadicFunctionProxy<FuncYear>}},
-    {"minute", {1, 1, &MonadicFunctionProxy<FuncMinute>}},
-    {"hour", {1, 1, &MonadicFunctionProxy<FuncHour>}},
-    {"day", {1, 1, &MonadicFunctionProxy<FuncDay>}},
-    {"month", {1, 1, &MonadicFunctionProxy<FuncMonth>}},
+    {"dayofweek",
+     {1, 1, &MonadicFunctionProxy<FuncDayofweek>,
+      &MonadicColumnProxy<FuncDayofweek>, true}},
+    {"dayofmonth",
+     {1, 1, &MonadicFunctionProxy<FuncDayofmonth>,
+      &MonadicColumnProxy<FuncDayofmonth>, true}},
+    {"dayofyear",
+     {1, 1, &MonadicFunctionProxy<FuncDayofyear>,
+      &MonadicColumnProxy<FuncDayofyear>, true}},
+    {"monthofyear",
+     {1, 1, &MonadicFunctionProxy<FuncMonthofyear>,
+      &MonadicColumnProxy<FuncMonthofyear>, true}},
+    {"year",
+     {1, 1, &MonadicFunctionProxy<FuncYear>, &MonadicColumnProxy<FuncYear>,
+      true}},
+    {"minute",
+     {1, 1, &MonadicFunctionProxy<FuncMinute>,
+      &MonadicColumnProxy<FuncMinute>, true}},
+    {"hour",
+     {1, 1, &MonadicFunctionProxy<FuncHour>, &MonadicColumnProxy<FuncHour>,
+      true}},
+    {"day",
+     {1, 1, &MonadicFunctionProxy<FuncDay>, &MonadicColumnProxy<FuncDay>,
+      true}},
+    {"month",
+     {1, 1, &MonadicFunctionProxy<FuncMonth>, &MonadicColumnProxy<FuncMonth>,
+      true}},
 
     {"timefmt", {1, 2, &ProxyTimefmt}},
     {"parsetime", {1, 2, &ProxyParsetime}},
 };
 
-absl::StatusOr<Func> FunctionCall::LookUpAndValidate(
+absl::StatusOr<const FunctionTableEntry*> FunctionCall::LookUpAndValidate(
     const std::string& name, const absl::InlinedVector<ExprPtr, 4>& params) {
   auto it = function_table.find(name);
   if (it == function_table.end()) {
@@ -235,7 +506,7 @@ absl::StatusOr<Func> FunctionCall::LookUpAndValidate(
         "Function ", name, " expects no more than ", it->second.max_argc,
         " arguments, but ", params.size(), " were found."));
   }
-  return it->second.function;
+  return &it->second;
 }
 
 //
@@ -249,7 +520,7 @@ absl::StatusOr<Func> FunctionCall::LookUpAndValidate(
 //    LorOps    ||
 //
 
-struct Dyadic : Expression {
+struct Dyadic : Node {
   using ValueFunc = Value (*)(const Value&, const Value&);
   Dyadic(ExprPtr lexpr, ExprPtr rexpr, ValueFunc func, absl::string_view name)
       : lexpr_(std::move(lexpr)),
@@ -261,6 +532,19 @@ struct Dyadic : Expression {
     auto rvalue = rexpr_->Evaluate(ctx, record);
     return (*func_)(lvalue, rvalue);
   }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    Column lvalues, rvalues;
+    lexpr_->EvaluateBatch(ctx, records, lvalues);
+    rexpr_->EvaluateBatch(ctx, records, rvalues);
+    if (ColumnDyadic(func_, lvalues, rvalues, result)) {
+      return;
+    }
+    result.Reset(records.size());
+    for (size_t row = 0; row < records.size(); ++row) {
+      result.Set(row, (*func_)(lvalues.Get(row), rvalues.Get(row)));
+    }
+  }
   void Dump(std::ostream& os) const override {
     os << '(';
     lexpr_->Dump(os);
@@ -268,6 +552,21 @@ struct Dyadic : Expression {
     rexpr_->Dump(os);
     os << ')';
   }
+  void ForEachOperand(absl::FunctionRef<void(ExprPtr&)> f) override {
+    f(lexpr_);
+    f(rexpr_);
+  }
+  void AppendKey(std::string& key) const override {
+    key += '(';
+    AsNode(lexpr_).AppendKey(key);
+    absl::StrAppend(&key, name_);
+    AsNode(rexpr_).AppendKey(key);
+    key += ')';
+  }
+  bool IsArithmetic() const {
+    return func_ == &FuncAdd || func_ == &FuncSub || func_ == &FuncMul ||
+           func_ == &FuncDiv || func_ == &FuncPower;
+  }
 
  private:
   ExprPtr lexpr_;
@@ -276,6 +575,227 @@ struct Dyadic : Expression {
   absl::string_view name_;
 };
 
+//
+// Converts an attribute used only as a number, once per record, rather than
+// in every function using it. Yields nil where Value::AsDouble fails, which
+// those functions treat the same way. Numeric columns are unboxed.
+//
+struct ToNumber : Node {
+  ToNumber(ExprPtr&& p) : expr_(std::move(p)) {}
+  Value Evaluate(EvalContext& ctx, const Record& record) const override {
+    auto value = expr_->Evaluate(ctx, record);
+    if (value.IsDouble()) {
+      return value;
+    }
+    auto number = value.AsDouble();
+    return number ? Value(*number) : Value{};
+  }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    Column operand;
+    expr_->EvaluateBatch(ctx, records, operand);
+    if (operand.GetKind() == Column::Kind::kNumber) {
+      result = std::move(operand);
+      return;
+    }
+    result.Reset(records.size());
+    for (size_t row = 0; row < records.size(); ++row) {
+      if (auto number = operand.Get(row).AsDouble()) {
+        result.Set(row, Value(*number));
+      }
+    }
+  }
+  void Dump(std::ostream& os) const override {
+    os << "number(";
+    expr_->Dump(os);
+    os << ')';
+  }
+  void ForEachOperand(absl::FunctionRef<void(ExprPtr&)> f) override {
+    f(expr_);
+  }
+  void AppendKey(std::string& key) const override {
+    key += "number(";
+    AsNode(expr_).AppendKey(key);
+    key += ')';
+  }
+
+ private:
+  ExprPtr expr_;
+};
+
+//
+// A use of a subexpression occurring more than once, whose value the
+// enclosing Shared node has put in a slot of the context.
+//
+struct SharedValue : Node {
+  SharedValue(size_t slot, std::string key)
+      : slot_(slot), key_(std::move(key)) {}
+  Value Evaluate(EvalContext& ctx, const Record& record) const override {
+    return ctx.shared_values_[slot_];
+  }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    result = ctx.shared_columns_[slot_];
+  }
+  void Dump(std::ostream& os) const override { os << '#' << slot_; }
+  void AppendKey(std::string& key) const override { key += key_; }
+
+ private:
+  size_t slot_;
+  std::string key_;  // Of the subexpression
+};
+
+//
+// The root of an expression with shared subexpressions. Each is evaluated
+// into its slot before the expression, inner ones first.
+//
+struct Shared : Node {
+  Shared(std::vector<ExprPtr> shared, ExprPtr expr)
+      : shared_(std::move(shared)), expr_(std::move(expr)) {}
+  Value Evaluate(EvalContext& ctx, const Record& record) const override {
+    if (ctx.shared_values_.size() < shared_.size()) {
+      ctx.shared_values_.resize(shared_.size());
+    }
+    for (size_t slot = 0; slot < shared_.size(); ++slot) {
+      ctx.shared_values_[slot] = shared_[slot]->Evaluate(ctx, record);
+    }
+    return expr_->Evaluate(ctx, record);
+  }
+  void EvaluateBatch(EvalContext& ctx, absl::Span<const Record* const> records,
+                     Column& result) const override {
+    if (ctx.shared_columns_.size() < shared_.size()) {
+      ctx.shared_columns_.resize(shared_.size());
+    }
+    for (size_t slot = 0; slot < shared_.size(); ++slot) {
+      shared_[slot]->EvaluateBatch(ctx, records, ctx.shared_columns_[slot]);
+    }
+    expr_->EvaluateBatch(ctx, records, result);
+  }
+  void Dump(std::ostream& os) const override {
+    os << "let(";
+    for (size_t slot = 0; slot < shared_.size(); ++slot) {
+      if (slot != 0) {
+        os << ',';
+      }
+      os << '#' << slot << '=';
+      shared_[slot]->Dump(os);
+    }
+    os << ") in ";
+    expr_->Dump(os);
+  }
+  void ForEachOperand(absl::FunctionRef<void(ExprPtr&)> f) override {
+    for (auto& e : shared_) {
+      f(e);
+    }
+    f(expr_);
+  }
+  void AppendKey(std::string& key) const override {
+    AsNode(expr_).AppendKey(key);
+  }
+
+ private:
+  std::vector<ExprPtr> shared_;
+  ExprPtr expr_;
+};
+
+//
+// The optimizations done as the expression is compiled.
+//
+struct Optimizer {
+  static bool HasOperands(const ExprPtr& e) {
+    bool result = false;
+    AsNode(e).ForEachOperand([&](ExprPtr&) { result = true; });
+    return result;
+  }
+
+  // Replaces a node whose operands are all constant by its value.
+  static ExprPtr Fold(ExprPtr e) {
+    bool constant = true;
+    AsNode(e).ForEachOperand([&](ExprPtr& operand) {
+      constant = constant && AsNode(operand).ConstantValue();
+    });
+    if (!constant) {
+      return e;
+    }
+    Expression::EvalContext ctx;
+    Expression::Record record;
+    auto value = e->Evaluate(ctx, record);
+    DBG << "Folded " << e << " to " << value << "\n";
+    return std::make_unique<Constant>(value);
+  }
+
+  // Prepares an operand which is only used as a number.
+  static void Numeric(ExprPtr& e) {
+    if (auto value = AsNode(e).ConstantValue()) {
+      if (!value->IsDouble()) {
+        auto number = value->AsDouble();
+        e = std::make_unique<Constant>(number ? Value(*number) : Value{});
+      }
+    } else if (dynamic_cast<AttributeValue*>(e.get())) {
+      e = std::make_unique<ToNumber>(std::move(e));
+    }
+  }
+
+  // Replaces subexpressions whose values are already in the record.
+  static void Reuse(Expression::CompileContext& ctx, ExprPtr& e) {
+    if (!HasOperands(e)) {
+      return;
+    }
+    auto key = e->Key();
+    if (auto ref = ctx.FindComputed(key)) {
+      std::ostringstream name;
+      ref->Dump(name);
+      DBG << "Reusing @" << name.str() << " for " << e << "\n";
+      e = std::make_unique<AttributeValue>(name.str(), std::move(ref),
+                                           std::move(key));
+      return;
+    }
+    AsNode(e).ForEachOperand([&](ExprPtr& operand) { Reuse(ctx, operand); });
+  }
+
+  // Counts the subexpressions with operands, not those within a repeat.
+  absl::flat_hash_map<std::string, size_t> counts_;
+  // The slot of each shared subexpression.
+  absl::flat_hash_map<std::string, size_t> slots_;
+  std::vector<ExprPtr> shared_;
+
+  void Count(ExprPtr& e) {
+    if (HasOperands(e) && ++counts_[e->Key()] == 1) {
+      AsNode(e).ForEachOperand([&](ExprPtr& operand) { Count(operand); });
+    }
+  }
+
+  void Share(ExprPtr& e) {
+    if (!HasOperands(e)) {
+      return;
+    }
+    auto key = e->Key();
+    if (auto itr = slots_.find(key); itr != slots_.end()) {
+      e = std::make_unique<SharedValue>(itr->second, std::move(key));
+      return;
+    }
+    AsNode(e).ForEachOperand([&](ExprPtr& operand) { Share(operand); });
+    if (counts_[key] > 1) {
+      size_t slot = shared_.size();
+      slots_[key] = slot;
+      shared_.emplace_back(std::move(e));
+      e = std::make_unique<SharedValue>(slot, std::move(key));
+    }
+  }
+
+  // Evaluates the subexpressions occurring more than once only once.
+  static ExprPtr EliminateCommon(ExprPtr e) {
+    Optimizer optimizer;
+    optimizer.Count(e);
+    optimizer.Share(e);
+    if (optimizer.shared_.empty()) {
+      return e;
+    }
+    return std::make_unique<Shared>(std::move(optimizer.shared_),
+                                    std::move(e));
+  }
+};
+
 bool IsIdentifierChar(int c) {
   return c != EOF && (std::isalnum(c) || c == '_');
 }
@@ -315,8 +835,12 @@ struct Compiler {
           } else {
             DBG << "Dyadic: " << lvalue << ' ' << op.first << ' ' << rvalue
                 << " Remaining: '" << s_.GetUnscanned() << "'\n";
-            lvalue = std::make_unique<Dyadic>(
+            auto dyadic = std::make_unique<Dyadic>(
                 std::move(lvalue), std::move(rvalue), op.second, op.first);
+            if (dyadic->IsArithmetic()) {
+              dyadic->ForEachOperand(&Optimizer::Numeric);
+            }
+            lvalue = Optimizer::Fold(std::move(dyadic));
             s = s_;
             found = true;
             break;
@@ -345,7 +869,10 @@ struct Compiler {
   absl::StatusOr<ExprPtr> Invert(CompileContext& ctx) {
     CHECK(s_.PopByte('!'));
     VMSDK_ASSIGN_OR_RETURN(auto expr, Primary(ctx));
-    return std::make_unique<Not>(std::move(expr));
+    if (!expr) {
+      return absl::InvalidArgumentError("Invalid or missing expression");
+    }
+    return Optimizer::Fold(std::make_unique<Not>(std::move(expr)));
   }
 
   absl::StatusOr<ExprPtr> Primary(CompileContext& ctx) {
@@ -422,11 +949,17 @@ struct Compiler {
           << s_.GetUnscanned() << "\n";
       s_.SkipWhiteSpace();
       if (s_.PopByte(')')) {
-        VMSDK_ASSIGN_OR_RETURN(auto func,
+        VMSDK_ASSIGN_OR_RETURN(auto entry,
                                FunctionCall::LookUpAndValidate(name, params));
         DBG << "After function call: '" << s_.GetUnscanned() << "'\n";
-        return std::make_unique<FunctionCall>(std::move(name), *func,
-                                              std::move(params));
+        if (entry->numeric) {
+          for (auto& param : params) {
+            Optimizer::Numeric(param);
+          }
+        }
+        return Optimizer::Fold(std::make_unique<FunctionCall>(
+            std::move(name), entry->function, entry->column_function,
+            std::move(params)));
       } else if (!params.empty() && !s_.PopByte(',')) {
         DBG << "func_call found comma\n";
         return absl::NotFoundError(
@@ -517,8 +1050,11 @@ struct Compiler {
     if (s_.SkipWhiteSpacePeekByte() != EOF) {
       return absl::InvalidArgumentError(absl::StrCat(
           "Extra characters at or near position ", s_.GetPosition()));
-    } else {
+    } else if (!result) {
       return result;
+    } else {
+      Optimizer::Reuse(ctx, result);
+      return Optimizer::EliminateCommon(std::move(result));
     }
   }
 };
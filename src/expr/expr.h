@@ -9,6 +9,7 @@
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "src/expr/value.h"
 
 namespace valkey_search {
@@ -30,7 +31,14 @@ class Expression {
   // Callers extend EvalContext with information to aid run-time
   // AttributeReference::getValue
   //
-  class EvalContext {};  // A per-evaluation context
+  class EvalContext {  // A per-evaluation context
+   public:
+    // Holds the computed strings, when set. See Value::MakeString.
+    Arena* arena_{nullptr};
+    // The values of the subexpressions an expression shares, by slot.
+    std::vector<Value> shared_values_;
+    std::vector<Column> shared_columns_;
+  };
   //
   // Callers extend this class with the actual values of the Attributes for this
   // evaluation.
@@ -43,6 +51,10 @@ class Expression {
    public:
     virtual ~AttributeReference() = default;
     virtual Value GetValue(EvalContext& ctx, const Record& record) const = 0;
+    // The values of the attribute for a batch of records.
+    virtual void GetValues(EvalContext& ctx,
+                           absl::Span<const Record* const> records,
+                           Column& values) const;
     virtual void Dump(std::ostream& os) const = 0;
     friend std::ostream& operator<<(std::ostream& os,
                                     const AttributeReference* p) {
@@ -60,14 +72,43 @@ class Expression {
     virtual absl::StatusOr<std::unique_ptr<AttributeReference>> MakeReference(
         const absl::string_view s, bool create) = 0;
     virtual absl::StatusOr<Value> GetParam(const absl::string_view s) const = 0;
+    //
+    // Returns a reference to an attribute already holding the value of the
+    // expression with the given Key, or nullptr. Lets an expression reuse
+    // what an earlier one stored in the record.
+    //
+    virtual std::unique_ptr<AttributeReference> FindComputed(
+        absl::string_view key) {
+      return nullptr;
+    }
   };
 
+  //
   // The two basic operations for Expression(s).
+  //
+  // Compilation optimizes the expression: constant and parameter operands are
+  // folded, attributes used as numbers are converted once, and subexpressions
+  // occurring more than once are evaluated once per record. Dump shows the
+  // optimized plan.
+  //
   static absl::StatusOr<std::unique_ptr<Expression>> Compile(
       CompileContext& ctx, absl::string_view s);
   virtual Value Evaluate(EvalContext& ctx, const Record& record) const = 0;
   virtual void Dump(std::ostream& os) const = 0;
 
+  // Identifies what the expression computes: expressions with equal keys
+  // produce the same values. Unlike the Dump output, it is exact.
+  std::string Key() const;
+
+  //
+  // Evaluates the expression for a batch of records into a column, one row
+  // per record. Produces the same values as Evaluate, but numeric and
+  // boolean subexpressions are computed a column at a time.
+  //
+  virtual void EvaluateBatch(EvalContext& ctx,
+                             absl::Span<const Record* const> records,
+                             Column& result) const;
+
   friend std::ostream& operator<<(std::ostream& os, const Expression& e) {
     e.Dump(os);
     return os;
@@ -6,7 +6,9 @@
 
 #include "src/expr/value.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
@@ -30,17 +32,70 @@ static bool IsNan(const double& d) {
   return ((v & kExponentMask) == kExponentMask) && ((v & kMantissaMask) != 0);
 }
 
+absl::string_view Arena::Store(absl::string_view s) {
+  if (s.empty()) {
+    return {};
+  }
+  char* data;
+  if (s.size() > kBlockSize / 4) {
+    // Large strings get a block of their own, keeping the current one.
+    blocks_.emplace_back(new char[s.size()]);
+    bytes_ += s.size();
+    data = blocks_.back().get();
+  } else {
+    if (s.size() > available_) {
+      blocks_.emplace_back(new char[kBlockSize]);
+      bytes_ += kBlockSize;
+      next_ = blocks_.back().get();
+      available_ = kBlockSize;
+    }
+    data = next_;
+    next_ += s.size();
+    available_ -= s.size();
+  }
+  std::memcpy(data, s.data(), s.size());
+  return {data, s.size()};
+}
+
 Value::Value(double d) { value_ = d; }
 
+Value Value::MakeString(absl::string_view s, Arena* arena) {
+  Value result;
+  if (s.size() <= kInlineCapacity) {
+    InlineString inline_string;
+    inline_string.size_ = s.size();
+    std::memcpy(inline_string.data_, s.data(), s.size());
+    inline_string.data_[s.size()] = '\0';
+    result.value_ = inline_string;
+  } else if (arena) {
+    result.value_ = arena->Store(s);
+  } else {
+    result.value_ = std::string(s);
+  }
+  return result;
+}
+
+std::optional<absl::string_view> Value::TryStringView() const {
+  if (auto result = std::get_if<absl::string_view>(&value_)) {
+    return *result;
+  } else if (auto result = std::get_if<InlineString>(&value_)) {
+    return absl::string_view(result->data_, result->size_);
+  } else if (auto result = std::get_if<std::string>(&value_)) {
+    return *result;
+  }
+  return std::nullopt;
+}
+
 bool Value::IsNil() const { return std::get_if<Nil>(&value_); }
 
 bool Value::IsBool() const { return std::get_if<bool>(&value_); }
 
 bool Value::IsDouble() const { return std::get_if<double>(&value_); }
 
-bool Value::IsString() const {
-  return std::get_if<absl::string_view>(&value_) ||
-         std::get_if<std::string>(&value_);
+bool Value::IsString() const { return TryStringView().has_value(); }
+
+bool Value::IsStringView() const {
+  return std::get_if<absl::string_view>(&value_);
 }
 
 Value::Nil Value::GetNil() const { return std::get<Nil>(value_); }
@@ -50,11 +105,9 @@ bool Value::GetBool() const { return std::get<bool>(value_); }
 double Value::GetDouble() const { return std::get<double>(value_); }
 
 absl::string_view Value::GetStringView() const {
-  if (auto result = std::get_if<std::string>(&value_)) {
-    return *result;
-  } else {
-    return std::get<absl::string_view>(value_);
-  }
+  auto result = TryStringView();
+  CHECK(result);
+  return *result;
 }
 
 std::optional<Value::Nil> Value::AsNil() const {
@@ -105,9 +158,7 @@ std::optional<double> Value::AsDouble() const {
     return *result;
   } else if (auto result = std::get_if<double>(&value_)) {
     return *result;
-  } else if (auto result = std::get_if<std::string>(&value_)) {
-    sv = *result;
-  } else if (auto result = std::get_if<absl::string_view>(&value_)) {
+  } else if (auto result = TryStringView()) {
     sv = *result;
   } else {
     return std::nullopt;
@@ -137,9 +188,7 @@ absl::string_view Value::AsStringView() const {
       storage_ = FormatDouble(*result);
     }
     return *storage_;
-  } else if (auto result = std::get_if<absl::string_view>(&value_)) {
-    return *result;
-  } else if (auto result = std::get_if<std::string>(&value_)) {
+  } else if (auto result = TryStringView()) {
     return *result;
   } else {
     CHECK(false);
@@ -151,10 +200,8 @@ std::string Value::AsString() const {
     return *result ? "1" : "0";
   } else if (auto result = std::get_if<double>(&value_)) {
     return FormatDouble(*result);
-  } else if (auto result = std::get_if<absl::string_view>(&value_)) {
+  } else if (auto result = TryStringView()) {
     return std::string(*result);
-  } else if (auto result = std::get_if<std::string>(&value_)) {
-    return *result;
   } else {
     CHECK(false);
   }
@@ -246,6 +293,186 @@ Ordering Compare(const Value& l, const Value& r) {
   return CompareStrings(l.AsStringView(), r.AsStringView());
 }
 
+void Column::Reset(size_t size, Kind kind) {
+  kind_ = kind;
+  size_ = size;
+  if (kind == Kind::kBoxed) {
+    numbers_.clear();
+    present_.clear();
+    values_.assign(size, Value());
+  } else {
+    values_.clear();
+    numbers_.resize(size);
+    present_.assign(size, 0);
+  }
+}
+
+void Column::Box() {
+  values_.clear();
+  values_.reserve(size_);
+  for (size_t row = 0; row < size_; ++row) {
+    values_.emplace_back(Get(row));
+  }
+  numbers_.clear();
+  present_.clear();
+  kind_ = Kind::kBoxed;
+}
+
+void Column::Set(size_t row, const Value& value) {
+  if (kind_ != Kind::kBoxed) {
+    if (value.IsNil()) {
+      present_[row] = 0;
+      return;
+    }
+    if (kind_ == Kind::kNumber && value.IsDouble()) {
+      numbers_[row] = value.GetDouble();
+      present_[row] = 1;
+      return;
+    }
+    if (kind_ == Kind::kBool && value.IsBool()) {
+      numbers_[row] = value.GetBool();
+      present_[row] = 1;
+      return;
+    }
+    Box();
+  }
+  values_[row] = value;
+}
+
+Value Column::Get(size_t row) const {
+  switch (kind_) {
+    case Kind::kNumber:
+      return present_[row] ? Value(numbers_[row]) : Value();
+    case Kind::kBool:
+      return present_[row] ? Value(numbers_[row] != 0.0) : Value();
+    case Kind::kBoxed:
+      return values_[row];
+  }
+  CHECK(false);
+}
+
+// Same as Value::AsBool, which treats nil as false and NaN as true.
+static bool IsTrueNumber(uint8_t present, double number) {
+  return present && (IsNan(number) || !(number == 0.0));
+}
+
+bool Column::IsTrue(size_t row) const {
+  if (kind_ == Kind::kBoxed) {
+    return values_[row].IsTrue();
+  }
+  return IsTrueNumber(present_[row], numbers_[row]);
+}
+
+template <typename Op>
+static void ColumnArithmetic(const Column& l, const Column& r, Column& result,
+                             Op op) {
+  size_t size = l.Size();
+  result.Reset(size, Column::Kind::kNumber);
+  const double* lnumbers = l.Numbers();
+  const double* rnumbers = r.Numbers();
+  const uint8_t* lpresent = l.Present();
+  const uint8_t* rpresent = r.Present();
+  double* numbers = result.MutableNumbers();
+  uint8_t* present = result.MutablePresent();
+  for (size_t row = 0; row < size; ++row) {
+    numbers[row] = op(lnumbers[row], rnumbers[row]);
+    present[row] = lpresent[row] & rpresent[row];
+  }
+}
+
+template <typename Op>
+static void ColumnCompare(const Column& l, const Column& r, Column& result,
+                          Op op) {
+  size_t size = l.Size();
+  result.Reset(size, Column::Kind::kBool);
+  const double* lnumbers = l.Numbers();
+  const double* rnumbers = r.Numbers();
+  const uint8_t* lpresent = l.Present();
+  const uint8_t* rpresent = r.Present();
+  double* numbers = result.MutableNumbers();
+  uint8_t* present = result.MutablePresent();
+  for (size_t row = 0; row < size; ++row) {
+    // Mirrors Compare(), nil equals only nil.
+    Ordering ordering;
+    if (lpresent[row] && rpresent[row]) {
+      ordering = CompareDoubles(lnumbers[row], rnumbers[row]);
+    } else if (lpresent[row] || rpresent[row]) {
+      ordering = Ordering::kUNORDERED;
+    } else {
+      ordering = Ordering::kEQUAL;
+    }
+    numbers[row] = op(ordering);
+    present[row] = 1;
+  }
+}
+
+template <typename Op>
+static void ColumnLogical(const Column& l, const Column& r, Column& result,
+                          Op op) {
+  size_t size = l.Size();
+  result.Reset(size, Column::Kind::kBool);
+  const double* lnumbers = l.Numbers();
+  const double* rnumbers = r.Numbers();
+  const uint8_t* lpresent = l.Present();
+  const uint8_t* rpresent = r.Present();
+  double* numbers = result.MutableNumbers();
+  uint8_t* present = result.MutablePresent();
+  for (size_t row = 0; row < size; ++row) {
+    numbers[row] = op(IsTrueNumber(lpresent[row], lnumbers[row]),
+                      IsTrueNumber(rpresent[row], rnumbers[row]));
+    present[row] = 1;
+  }
+}
+
+bool ColumnDyadic(Value (*func)(const Value& l, const Value& r),
+                  const Column& l, const Column& r, Column& result) {
+  if (l.IsBoxed() || r.IsBoxed()) {
+    return false;
+  }
+  CHECK_EQ(l.Size(), r.Size());
+  if (func == &FuncAdd) {
+    ColumnArithmetic(l, r, result, [](double a, double b) { return a + b; });
+  } else if (func == &FuncSub) {
+    ColumnArithmetic(l, r, result, [](double a, double b) { return a - b; });
+  } else if (func == &FuncMul) {
+    ColumnArithmetic(l, r, result, [](double a, double b) { return a * b; });
+  } else if (func == &FuncDiv) {
+    ColumnArithmetic(l, r, result, [](double a, double b) {
+      return b == 0 ? std::nan("") : a / b;
+    });
+  } else if (func == &FuncPower) {
+    ColumnArithmetic(l, r, result,
+                     [](double a, double b) { return std::pow(a, b); });
+  } else if (func == &FuncLt) {
+    ColumnCompare(l, r, result,
+                  [](Ordering o) { return o == Ordering::kLESS; });
+  } else if (func == &FuncLe) {
+    ColumnCompare(l, r, result,
+                  [](Ordering o) { return o != Ordering::kGREATER; });
+  } else if (func == &FuncEq) {
+    ColumnCompare(l, r, result, [](Ordering o) {
+      return o == Ordering::kEQUAL || o == Ordering::kUNORDERED;
+    });
+  } else if (func == &FuncNe) {
+    ColumnCompare(l, r, result, [](Ordering o) {
+      return o == Ordering::kLESS || o == Ordering::kGREATER;
+    });
+  } else if (func == &FuncGt) {
+    ColumnCompare(l, r, result,
+                  [](Ordering o) { return o == Ordering::kGREATER; });
+  } else if (func == &FuncGe) {
+    ColumnCompare(l, r, result,
+                  [](Ordering o) { return o != Ordering::kLESS; });
+  } else if (func == &FuncLor) {
+    ColumnLogical(l, r, result, [](bool a, bool b) { return a || b; });
+  } else if (func == &FuncLand) {
+    ColumnLogical(l, r, result, [](bool a, bool b) { return a && b; });
+  } else {
+    return false;
+  }
+  return true;
+}
+
 Value FuncAdd(const Value& l, const Value& r) {
   auto lv = l.AsDouble();
   auto rv = r.AsDouble();
@@ -426,7 +653,17 @@ Value FuncContains(const Value& l, const Value& r) {
   }
 }
 
-Value FuncSubstr(const Value& l, const Value& m, const Value& r) {
+// A part of a string. Values holding a string_view reference storage which
+// outlives them, so the part can reference it too.
+static Value Substring(const Value& l, absl::string_view part, Arena* arena) {
+  if (l.IsStringView()) {
+    return Value(part);
+  }
+  return Value::MakeString(part, arena);
+}
+
+Value FuncSubstr(const Value& l, const Value& m, const Value& r,
+                 Arena* arena) {
   auto ls = l.AsStringView();
   auto offset_p = m.AsInteger();
   auto length_p = r.AsInteger();
@@ -436,13 +673,13 @@ Value FuncSubstr(const Value& l, const Value& m, const Value& r) {
       return Value("");
     } else {
       if (*length_p >= 0) {
-        return Value(std::string(ls.substr(offset, *length_p)));
+        return Substring(l, ls.substr(offset, *length_p), arena);
       } else {
         int64_t len = (ls.size() - offset) + *length_p;
         if (len < 0) {
           return Value("");
         } else {
-          return Value(std::string(ls.substr(offset, len)));
+          return Substring(l, ls.substr(offset, len), arena);
         }
       }
     }
@@ -451,9 +688,17 @@ Value FuncSubstr(const Value& l, const Value& m, const Value& r) {
   }
 }
 
-Value FuncLower(const Value& o) {
+// The string functions build their result in a per thread buffer which keeps
+// its capacity, the result is then copied to wherever the Value keeps it.
+static std::string& ScratchString() {
+  thread_local std::string scratch;
+  scratch.clear();
+  return scratch;
+}
+
+Value FuncLower(const Value& o, Arena* arena) {
   auto os = o.AsStringView();
-  std::string result;
+  std::string& result = ScratchString();
   result.reserve(os.size());
   utils::Scanner in(os);
   for (auto utf8 = in.NextUtf8(); utf8 != utils::Scanner::kEOF;
@@ -463,12 +708,12 @@ Value FuncLower(const Value& o) {
     }
     utils::Scanner::PushBackUtf8(result, utf8);
   }
-  return Value(std::move(result));
+  return Value::MakeString(result, arena);
 }
 
-Value FuncUpper(const Value& o) {
+Value FuncUpper(const Value& o, Arena* arena) {
   auto os = o.AsStringView();
-  std::string result;
+  std::string& result = ScratchString();
   result.reserve(os.size());
   utils::Scanner in(os);
   for (auto utf8 = in.NextUtf8(); utf8 != utils::Scanner::kEOF;
@@ -478,15 +723,15 @@ Value FuncUpper(const Value& o) {
     }
     utils::Scanner::PushBackUtf8(result, utf8);
   }
-  return Value(std::move(result));
+  return Value::MakeString(result, arena);
 }
 
-Value FuncConcat(const absl::InlinedVector<Value, 4>& values) {
-  std::string result;
+Value FuncConcat(const absl::InlinedVector<Value, 4>& values, Arena* arena) {
+  std::string& result = ScratchString();
   for (auto& v : values) {
     result.append(v.AsStringView());
   }
-  return Value(std::move(result));
+  return Value::MakeString(result, arena);
 }
 
 #define TIME_FUNCTION(funcname, field, adjustment)        \
@@ -507,7 +752,7 @@ TIME_FUNCTION(FuncDayofyear, tm_yday, 0)
 TIME_FUNCTION(FuncMonthofyear, tm_mon, 0)
 TIME_FUNCTION(FuncYear, tm_year, 1900)
 
-Value FuncTimefmt(const Value& ts, const Value& fmt) {
+Value FuncTimefmt(const Value& ts, const Value& fmt, Arena* arena) {
   auto timestampd = ts.AsDouble();
   if (!timestampd) {
     return Value(Value::Nil("timefmt: timestamp was not a number"));
@@ -516,7 +761,7 @@ Value FuncTimefmt(const Value& ts, const Value& fmt) {
   time_t timestamp = (time_t)*timestampd;
   ::gmtime_r(&timestamp, &tm);
 
-  std::string result;
+  std::string& result = ScratchString();
   result.resize(100);
   size_t result_bytes = 0;
   while ((result_bytes = strftime(result.data(), result.size(),
@@ -524,7 +769,7 @@ Value FuncTimefmt(const Value& ts, const Value& fmt) {
     result.resize(result.size() * 2);
   }
   result.resize(result_bytes);
-  return Value(std::move(result));
+  return Value::MakeString(result, arena);
 }
 
 Value FuncParsetime(const Value& str, const Value& fmt) {
@@ -7,9 +7,12 @@
 #ifndef VALKEYSEARCH_EXPR_VALUE_H
 #define VALKEYSEARCH_EXPR_VALUE_H
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <variant>
+#include <vector>
 
 #include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
@@ -17,6 +20,25 @@
 namespace valkey_search {
 namespace expr {
 
+//
+// Holds the bytes of the strings computed while evaluating the expressions of
+// a query, so that each of them doesn't need its own heap allocation. Values
+// referencing the arena must not outlive it. Not thread safe.
+//
+class Arena {
+ public:
+  absl::string_view Store(absl::string_view s);
+  size_t GetBytes() const { return bytes_; }
+
+ private:
+  static constexpr size_t kBlockSize = 16 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char* next_{nullptr};
+  size_t available_{0};
+  size_t bytes_{0};
+};
+
 class Value {
  public:
   class Nil {
@@ -38,11 +60,19 @@ class Value {
   explicit Value(const char* s) : value_(absl::string_view(s)) {}
   explicit Value(std::string&& s) : value_(std::move(s)) {}
 
+  // Strings up to this size are stored within the Value.
+  static constexpr size_t kInlineCapacity = 30;
+  // A computed string. Short strings are stored inline, longer ones in the
+  // arena when there is one and in an owned std::string otherwise.
+  static Value MakeString(absl::string_view s, Arena* arena = nullptr);
+
   // test for type of Value
   bool IsNil() const;
   bool IsBool() const;
   bool IsDouble() const;
   bool IsString() const;
+  // A string referencing storage which the Value doesn't own.
+  bool IsStringView() const;
 
   // When you already know the type, will assert if you're wrong
   Nil GetNil() const;
@@ -72,14 +102,21 @@ class Value {
     } else if (v.IsDouble()) {
       return H::combine(std::move(h), *v.AsDouble());
     } else {
-      return H::combine(std::move(h), v.AsString());
+      return H::combine(std::move(h), v.AsStringView());
     }
   }
 
  private:
+  struct InlineString {
+    uint8_t size_;
+    char data_[kInlineCapacity + 1];  // 0 terminated, like std::string
+  };
+  std::optional<absl::string_view> TryStringView() const;
+
   mutable std::optional<std::string> storage_;
 
-  std::variant<Nil, bool, double, absl::string_view, std::string> value_;
+  std::variant<Nil, bool, double, absl::string_view, std::string, InlineString>
+      value_;
 };
 
 enum Ordering { kLESS, kEQUAL, kGREATER, kUNORDERED };
@@ -132,6 +169,50 @@ static inline bool operator>=(const Value& l, const Value& r) {
   return res != Ordering::kLESS;
 }
 
+//
+// A column of Values, typically the values of one expression over a batch of
+// records. Numbers and booleans are held unboxed in a flat array next to a
+// map of the rows which aren't nil, so that arithmetic and comparisons over
+// them run as tight loops. Setting any other kind of Value boxes the column.
+//
+class Column {
+ public:
+  enum class Kind { kNumber, kBool, kBoxed };
+
+  // Resizes the column to `size` nil rows of the given kind.
+  void Reset(size_t size, Kind kind = Kind::kNumber);
+  void Set(size_t row, const Value& value);
+  Value Get(size_t row) const;
+  bool IsTrue(size_t row) const;
+
+  size_t Size() const { return size_; }
+  Kind GetKind() const { return kind_; }
+  bool IsBoxed() const { return kind_ == Kind::kBoxed; }
+
+  // Unboxed access, only for kNumber and kBool columns. Booleans are 0 or 1.
+  const double* Numbers() const { return numbers_.data(); }
+  const uint8_t* Present() const { return present_.data(); }
+  double* MutableNumbers() { return numbers_.data(); }
+  uint8_t* MutablePresent() { return present_.data(); }
+
+ private:
+  void Box();
+
+  Kind kind_{Kind::kNumber};
+  size_t size_{0};
+  std::vector<double> numbers_;
+  std::vector<uint8_t> present_;
+  std::vector<Value> values_;
+};
+
+//
+// Applies one of the dyadic functions below to every row of two unboxed
+// columns of the same size. Returns false, leaving the result alone, for
+// boxed columns and for functions without a column implementation.
+//
+bool ColumnDyadic(Value (*func)(const Value& l, const Value& r),
+                  const Column& l, const Column& r, Column& result);
+
 // Dyadic Numerical Functions
 Value FuncAdd(const Value& l, const Value& r);
 Value FuncSub(const Value& l, const Value& r);
@@ -160,15 +241,20 @@ Value FuncLog2(const Value& o);
 Value FuncFloor(const Value& o);
 Value FuncSqrt(const Value& o);
 
-Value FuncLower(const Value& o);
-Value FuncUpper(const Value& o);
+//
+// The functions computing strings store them in the arena, if given.
+//
+Value FuncLower(const Value& o, Arena* arena = nullptr);
+Value FuncUpper(const Value& o, Arena* arena = nullptr);
 Value FuncStrlen(const Value& o);
 Value FuncContains(const Value& l, const Value& r);
 Value FuncStartswith(const Value& l, const Value& r);
-Value FuncSubstr(const Value& l, const Value& m, const Value& r);
-Value FuncConcat(const absl::InlinedVector<Value, 4>& values);
+Value FuncSubstr(const Value& l, const Value& m, const Value& r,
+                 Arena* arena = nullptr);
+Value FuncConcat(const absl::InlinedVector<Value, 4>& values,
+                 Arena* arena = nullptr);
 
-Value FuncTimefmt(const Value& t, const Value& fmt);
+Value FuncTimefmt(const Value& t, const Value& fmt, Arena* arena = nullptr);
 Value FuncParsetime(const Value& t, const Value& fmt);
 Value FuncDay(const Value& t);
 Value FuncHour(const Value& t);
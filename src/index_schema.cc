@@ -21,6 +21,9 @@
 
 #include "absl/base/optimization.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/hash/hash.h"
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -53,6 +56,7 @@
 #include "vmsdk/src/info.h"
 #include "vmsdk/src/log.h"
 #include "vmsdk/src/managed_pointers.h"
+#include "vmsdk/src/memory_tracker.h"
 #include "vmsdk/src/status/status_macros.h"
 #include "vmsdk/src/thread_pool.h"
 #include "vmsdk/src/time_sliced_mrmw_mutex.h"
@@ -220,8 +224,9 @@ absl::StatusOr<std::shared_ptr<IndexSchema>> IndexSchema::Create(
       VMSDK_ASSIGN_OR_RETURN(
           std::shared_ptr<indexes::IndexBase> index,
           IndexFactory(ctx, res.get(), attribute, std::nullopt));
-      VMSDK_RETURN_IF_ERROR(
-          res->AddIndex(attribute.alias(), attribute.identifier(), index));
+      VMSDK_RETURN_IF_ERROR(res->AddIndex(
+          attribute.alias(), attribute.identifier(), index,
+          attribute.sortable()));
     }
   }
   return res;
@@ -276,6 +281,29 @@ absl::Status IndexSchema::Init(ValkeyModuleCtx *ctx) {
   return absl::OkStatus();
 }
 
+MemoryPool IndexSchema::content_hashes_memory_pool_{0};
+
+int64_t IndexSchema::GetContentHashesMemoryUsage() {
+  return content_hashes_memory_pool_.GetUsage();
+}
+
+IndexSchema::ContentHashMap::~ContentHashMap() {
+  IsolatedMemoryScope scope{content_hashes_memory_pool_};
+  InternedStringMap<ContentHashes>().swap(*this);
+}
+
+MemoryPool IndexSchema::mutation_sequences_memory_pool_{0};
+
+int64_t IndexSchema::GetMutationSequencesMemoryUsage() {
+  return mutation_sequences_memory_pool_.GetUsage();
+}
+
+IndexSchema::MutationSequences::~MutationSequences() {
+  IsolatedMemoryScope scope{mutation_sequences_memory_pool_};
+  InternedStringMap<uint64_t>().swap(by_key);
+  std::deque<std::pair<InternedStringPtr, uint64_t>>().swap(in_order);
+}
+
 IndexSchema::~IndexSchema() {
   VMSDK_LOG(NOTICE, detached_ctx_.get())
       << "Index schema " << name_ << " dropped from DB " << db_num_;
@@ -298,6 +326,12 @@ absl::StatusOr<std::shared_ptr<indexes::IndexBase>> IndexSchema::GetIndex(
   return itr->second.GetIndex();
 }
 
+const StoredField *IndexSchema::GetStoredField(
+    absl::string_view attribute_alias) const {
+  auto itr = attributes_.find(attribute_alias);
+  return itr == attributes_.end() ? nullptr : itr->second.GetStoredField();
+}
+
 absl::StatusOr<std::string> IndexSchema::GetIdentifier(
     absl::string_view attribute_alias) const {
   auto itr = attributes_.find(std::string{attribute_alias});
@@ -330,10 +364,12 @@ absl::StatusOr<vmsdk::UniqueValkeyString> IndexSchema::DefaultReplyScoreAs(
 
 absl::Status IndexSchema::AddIndex(absl::string_view attribute_alias,
                                    absl::string_view identifier,
-                                   std::shared_ptr<indexes::IndexBase> index) {
-  auto [_, res] =
-      attributes_.insert({std::string(attribute_alias),
-                          Attribute{attribute_alias, identifier, index}});
+                                   std::shared_ptr<indexes::IndexBase> index,
+                                   bool sortable) {
+  auto [_, res] = attributes_.insert(
+      {std::string(attribute_alias),
+       Attribute{attribute_alias, identifier, index, attributes_.size(),
+                 sortable}});
   if (!res) {
     return absl::AlreadyExistsError(
         absl::StrCat("Index field `", attribute_alias, "` already exists"));
@@ -399,6 +435,31 @@ bool AddAttributeData(IndexSchema::MutatedAttributes &mutated_attributes,
   return true;
 }
 
+namespace {
+
+// Keeps the raw value of a SORTABLE attribute while its index holds the key's
+// value, and drops it when the index rejects the value.
+void UpdateStoredField(StoredField *stored_field, const InternedStringPtr &key,
+                       const absl::StatusOr<bool> &res,
+                       absl::string_view value) {
+  if (!stored_field) {
+    return;
+  }
+  if (res.ok() && res.value()) {
+    stored_field->Set(key, value);
+  } else {
+    stored_field->Erase(key);
+  }
+}
+
+// Never 0, which stands for no content.
+uint64_t ContentHash(ValkeyModuleString *record) {
+  uint64_t hash = absl::HashOf(vmsdk::ToStringView(record));
+  return hash == 0 ? 1 : hash;
+}
+
+}  // namespace
+
 void IndexSchema::ProcessKeyspaceNotification(ValkeyModuleCtx *ctx,
                                               ValkeyModuleString *key,
                                               bool from_backfill) {
@@ -415,6 +476,19 @@ void IndexSchema::ProcessKeyspaceNotification(ValkeyModuleCtx *ctx,
   MutatedAttributes mutated_attributes;
   bool added = false;
   auto interned_key = StringInternStore::Intern(key_cstr);
+  auto &content_hashes = content_hashes_.Get();
+  bool skip_unchanged = options::GetSkipUnchangedAttributes().GetValue();
+  ContentHashes *key_hashes = nullptr;
+  {
+    IsolatedMemoryScope scope{content_hashes_memory_pool_};
+    if (!key_obj || !skip_unchanged) {
+      content_hashes.erase(interned_key);
+    } else {
+      auto [itr, _] = content_hashes.try_emplace(interned_key);
+      key_hashes = &itr->second;
+      key_hashes->resize(attributes_.size());
+    }
+  }
   for (const auto &attribute_itr : attributes_) {
     auto &attribute = attribute_itr.second;
     if (!key_obj) {
@@ -433,6 +507,18 @@ void IndexSchema::ProcessKeyspaceNotification(ValkeyModuleCtx *ctx,
         !InTrackedMutationRecords(interned_key, attribute.GetIdentifier())) {
       continue;
     }
+    if (key_hashes) {
+      // The index already has this content if it tracks the key and the last
+      // content sent to it hashes the same.
+      uint64_t &last_hash = (*key_hashes)[attribute.GetPosition()];
+      uint64_t hash = record ? ContentHash(record.get()) : 0;
+      if (hash != 0 && hash == last_hash &&
+          attribute.GetIndex()->IsTracked(interned_key)) {
+        ++Metrics::GetStats().ingest_field_unchanged;
+        continue;
+      }
+      last_hash = hash;
+    }
     if (!is_module_owned) {
       // A record which are owned by the module were not modified and are
       // already tracked in the vector registry.
@@ -443,6 +529,10 @@ void IndexSchema::ProcessKeyspaceNotification(ValkeyModuleCtx *ctx,
       added = true;
     }
   }
+  if (key_hashes && std::all_of(key_hashes->begin(), key_hashes->end(),
+                                [](uint64_t hash) { return hash == 0; })) {
+    content_hashes.erase(interned_key);
+  }
   if (added) {
     switch (attribute_data_type_->ToProto()) {
       case data_model::ATTRIBUTE_DATA_TYPE_HASH:
@@ -477,22 +567,188 @@ void IndexSchema::SyncProcessMutation(ValkeyModuleCtx *ctx,
                                       MutatedAttributes &mutated_attributes,
                                       const InternedStringPtr &key) {
   vmsdk::WriterMutexLock lock(&time_sliced_mutex_);
+  ApplyMutation(ctx, mutated_attributes, key);
+  absl::MutexLock records_lock(&mutated_records_mutex_);
+  NoteAppliedMutation(key);
+}
+
+bool IsVectorIndex(std::shared_ptr<indexes::IndexBase> index) {
+  return index->GetIndexerType() == indexes::IndexerType::kVector ||
+         index->GetIndexerType() == indexes::IndexerType::kHNSW ||
+         index->GetIndexerType() == indexes::IndexerType::kFlat;
+}
+
+void IndexSchema::ApplyMutation(ValkeyModuleCtx *ctx,
+                                MutatedAttributes &mutated_attributes,
+                                const InternedStringPtr &key) {
+  bool was_tracked = IsTrackedByAnyIndex(key);
+  RecordChanges changes;
   for (auto &attribute_data_itr : mutated_attributes) {
     const auto itr = attributes_.find(attribute_data_itr.first);
     if (itr == attributes_.end()) {
       continue;
     }
-    ProcessAttributeMutation(ctx, itr->second, key,
-                             std::move(attribute_data_itr.second.data),
-                             attribute_data_itr.second.deletion_type);
+    changes.Add(ProcessAttributeMutation(
+        ctx, itr->second, key, std::move(attribute_data_itr.second.data),
+        attribute_data_itr.second.deletion_type));
   }
+  UpdateDocumentCount(key, was_tracked, changes);
 }
 
-void IndexSchema::ProcessAttributeMutation(
+namespace {
+
+//
+// Jobs run by the thread which made them, along with whichever pool threads
+// join in. The maker never waits for a job which no thread has started, so a
+// pool thread can make them without risking a deadlock on its own pool.
+//
+class SharedJobs {
+ public:
+  SharedJobs(size_t count, absl::AnyInvocable<void(size_t)> run)
+      : count_(count), run_(std::move(run)) {}
+
+  bool Started() const {
+    absl::MutexLock lock(&mutex_);
+    return next_ == count_;
+  }
+  // Runs jobs until every one has been started.
+  void Run() {
+    while (true) {
+      size_t job;
+      {
+        absl::MutexLock lock(&mutex_);
+        if (next_ == count_) {
+          return;
+        }
+        job = next_++;
+        ++running_;
+      }
+      run_(job);
+      absl::MutexLock lock(&mutex_);
+      --running_;
+    }
+  }
+  // Waits for the started jobs to finish.
+  void Wait() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](SharedJobs *jobs) ABSL_EXCLUSIVE_LOCKS_REQUIRED(jobs->mutex_) {
+          return jobs->next_ == jobs->count_ && jobs->running_ == 0;
+        },
+        this));
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  const size_t count_;
+  size_t next_ ABSL_GUARDED_BY(mutex_){0};
+  size_t running_ ABSL_GUARDED_BY(mutex_){0};
+  absl::AnyInvocable<void(size_t)> run_;
+};
+
+}  // namespace
+
+void IndexSchema::ApplyMutations(ValkeyModuleCtx *ctx,
+                                 std::vector<KeyMutation> &mutations,
+                                 vmsdk::ThreadPool::Priority priority) {
+  // The mutations of each attribute, in key order.
+  struct AttributeJob {
+    const Attribute *attribute;
+    // The key's position in the mutations, and its attribute data.
+    std::vector<std::pair<size_t, DocumentMutation::AttributeData *>>
+        mutations;
+  };
+  std::vector<AttributeJob> jobs;
+  absl::flat_hash_map<absl::string_view, size_t> job_by_identifier;
+  bool any_vector = false;
+  absl::InlinedVector<bool, 32> was_tracked;
+  was_tracked.reserve(mutations.size());
+  for (size_t i = 0; i < mutations.size(); ++i) {
+    auto &[key, mutated_attributes] = mutations[i];
+    was_tracked.push_back(IsTrackedByAnyIndex(key));
+    for (auto &[identifier, attribute_data] : mutated_attributes) {
+      const auto itr = attributes_.find(identifier);
+      if (itr == attributes_.end()) {
+        continue;
+      }
+      auto [job, inserted] =
+          job_by_identifier.try_emplace(identifier, jobs.size());
+      if (inserted) {
+        jobs.push_back(AttributeJob{.attribute = &itr->second});
+        any_vector |= IsVectorIndex(itr->second.GetIndex());
+      }
+      jobs[job->second].mutations.emplace_back(i, &attribute_data);
+    }
+  }
+  // Each job keeps the changes to its own index, so that the jobs don't share
+  // anything they write.
+  std::vector<std::vector<RecordChange>> job_changes(jobs.size());
+  auto run = [&](size_t job) {
+    auto &changes = job_changes[job];
+    changes.reserve(jobs[job].mutations.size());
+    for (auto [i, attribute_data] : jobs[job].mutations) {
+      changes.push_back(ProcessAttributeMutation(
+          ctx, *jobs[job].attribute, mutations[i].first,
+          std::move(attribute_data->data), attribute_data->deletion_type));
+    }
+  };
+  // Vector inserts dominate, so they're worth spreading over the writer
+  // threads, an attribute per thread. The helpers take the writer lock
+  // themselves, as the time slice may end before they get to run.
+  size_t helpers =
+      mutations_thread_pool_
+          ? std::min(jobs.size(), mutations_thread_pool_->Size()) - 1
+          : 0;
+  if (jobs.size() < 2 || !any_vector || helpers == 0) {
+    for (size_t job = 0; job < jobs.size(); ++job) {
+      run(job);
+    }
+  } else {
+    auto shared_jobs = std::make_shared<SharedJobs>(jobs.size(), run);
+    for (size_t i = 0; i < helpers; ++i) {
+      mutations_thread_pool_->Schedule(
+          [shared_jobs, weak_index_schema = GetWeakPtr()]() {
+            auto index_schema = weak_index_schema.lock();
+            if (!index_schema || shared_jobs->Started()) {
+              return;
+            }
+            vmsdk::WriterMutexLock lock(&index_schema->time_sliced_mutex_);
+            shared_jobs->Run();
+          },
+          priority);
+    }
+    shared_jobs->Run();
+    shared_jobs->Wait();
+  }
+  absl::InlinedVector<RecordChanges, 32> changes(mutations.size());
+  for (size_t job = 0; job < jobs.size(); ++job) {
+    for (size_t j = 0; j < jobs[job].mutations.size(); ++j) {
+      changes[jobs[job].mutations[j].first].Add(job_changes[job][j]);
+    }
+  }
+  for (size_t i = 0; i < mutations.size(); ++i) {
+    UpdateDocumentCount(mutations[i].first, was_tracked[i], changes[i]);
+  }
+}
+
+void IndexSchema::UpdateDocumentCount(const InternedStringPtr &key,
+                                      bool was_tracked,
+                                      const RecordChanges &changes) {
+  // Count the key in once it's added to an index, and out once nothing is
+  // tracking it anymore.
+  if (changes.added && !was_tracked) {
+    ++stats_.document_cnt;
+  } else if (changes.removed && !IsTrackedByAnyIndex(key)) {
+    --stats_.document_cnt;
+  }
+}
+
+IndexSchema::RecordChange IndexSchema::ProcessAttributeMutation(
     ValkeyModuleCtx *ctx, const Attribute &attribute,
     const InternedStringPtr &key, vmsdk::UniqueValkeyString data,
     indexes::DeletionType deletion_type) {
   auto index = attribute.GetIndex();
+  auto stored_field = attribute.GetStoredField();
   if (data) {
     DCHECK(deletion_type == indexes::DeletionType::kNone);
     auto data_view = vmsdk::ToStringView(data.get());
@@ -502,20 +758,15 @@ void IndexSchema::ProcessAttributeMutation(
       if (res.ok() && res.value()) {
         ++Metrics::GetStats().time_slice_upserts;
       }
-      return;
+      UpdateStoredField(stored_field, key, res, data_view);
+      return RecordChange::kNone;
     }
-    bool was_tracked = IsTrackedByAnyIndex(key);
     auto res = index->AddRecord(key, data_view);
     TrackResults(ctx, res, "Add", stats_.subscription_add);
+    UpdateStoredField(stored_field, key, res, data_view);
 
     if (res.ok() && res.value()) {
       ++Metrics::GetStats().time_slice_upserts;
-      // Increment the hash key count if it wasn't tracked and we successfully
-      // added it to the index.
-      if (!was_tracked) {
-        ++stats_.document_cnt;
-      }
-
       // Track field type counters
       switch (index->GetIndexerType()) {
         case indexes::IndexerType::kVector:
@@ -533,19 +784,21 @@ void IndexSchema::ProcessAttributeMutation(
           // Shouldn't happen
           break;
       }
+      return RecordChange::kAdded;
     }
-    return;
+    return RecordChange::kNone;
   }
 
   auto res = index->RemoveRecord(key, deletion_type);
   TrackResults(ctx, res, "Remove", stats_.subscription_remove);
+  if (stored_field) {
+    stored_field->Erase(key);
+  }
   if (res.ok() && res.value()) {
     ++Metrics::GetStats().time_slice_deletes;
-    // Reduce the hash key count if nothing is tracking the key anymore.
-    if (!IsTrackedByAnyIndex(key)) {
-      --stats_.document_cnt;
-    }
+    return RecordChange::kRemoved;
   }
+  return RecordChange::kNone;
 }
 
 std::unique_ptr<vmsdk::StopWatch> CreateQueueDelayCapturer() {
@@ -616,24 +869,125 @@ void IndexSchema::ScheduleMutation(bool from_backfill,
       ++stats_.backfill_inqueue_tasks;
     }
   }
+  if (ABSL_PREDICT_FALSE(blocking_counter)) {
+    // The multi/exec flush already holds the writer lock and waits for every
+    // key, so it gains nothing from batching.
+    mutations_thread_pool_->Schedule(
+        [from_backfill, weak_index_schema = GetWeakPtr(),
+         ctx = detached_ctx_.get(),
+         delay_capturer = CreateQueueDelayCapturer(), key_str = key,
+         blocking_counter]() mutable {
+          PAUSEPOINT("block_mutation_queue");
+          auto index_schema = weak_index_schema.lock();
+          if (ABSL_PREDICT_TRUE(index_schema)) {
+            index_schema->ProcessSingleMutationAsync(
+                ctx, from_backfill, key_str, delay_capturer.get());
+          }
+          blocking_counter->DecrementCount();
+        },
+        priority);
+    return;
+  }
+  bool schedule_task = false;
+  {
+    absl::MutexLock lock(&mutated_records_mutex_);
+    auto &pending = pending_mutations_[static_cast<size_t>(priority)];
+    pending.keys.push_back(PendingMutation{
+        .key = key,
+        .from_backfill = from_backfill,
+        .delay_capturer = CreateQueueDelayCapturer(),
+    });
+    // Another task is needed unless the waiting ones will take every key, or
+    // every writer thread is already draining this queue.
+    if (pending.waiting_tasks < pending.keys.size() &&
+        pending.tasks < mutations_thread_pool_->Size()) {
+      ++pending.waiting_tasks;
+      ++pending.tasks;
+      schedule_task = true;
+    }
+  }
+  if (schedule_task) {
+    ScheduleMutationBatch(priority);
+  }
+}
+
+void IndexSchema::ScheduleMutationBatch(vmsdk::ThreadPool::Priority priority) {
   mutations_thread_pool_->Schedule(
-      [from_backfill, weak_index_schema = GetWeakPtr(),
-       ctx = detached_ctx_.get(), delay_capturer = CreateQueueDelayCapturer(),
-       key_str = std::move(key), blocking_counter]() mutable {
+      [weak_index_schema = GetWeakPtr(), ctx = detached_ctx_.get(),
+       priority]() {
         PAUSEPOINT("block_mutation_queue");
         auto index_schema = weak_index_schema.lock();
         if (ABSL_PREDICT_FALSE(!index_schema)) {
           return;
         }
-        index_schema->ProcessSingleMutationAsync(ctx, from_backfill, key_str,
-                                                 delay_capturer.get());
-        if (ABSL_PREDICT_FALSE(blocking_counter)) {
-          blocking_counter->DecrementCount();
-        }
+        index_schema->ProcessMutationBatch(ctx, priority);
       },
       priority);
 }
 
+void IndexSchema::ProcessMutationBatch(ValkeyModuleCtx *ctx,
+                                       vmsdk::ThreadPool::Priority priority) {
+  std::vector<PendingMutation> batch;
+  {
+    absl::MutexLock lock(&mutated_records_mutex_);
+    auto &pending = pending_mutations_[static_cast<size_t>(priority)];
+    --pending.waiting_tasks;
+    // An even share of the queue among the tasks, so a deep queue is drained
+    // in large batches while a shallow one keeps every writer thread busy.
+    size_t max_batch_size = options::GetMaxMutationBatchSize().GetValue();
+    size_t batch_size = std::clamp<size_t>(
+        (pending.keys.size() + pending.tasks - 1) / pending.tasks, 1,
+        max_batch_size);
+    batch_size = std::min(batch_size, pending.keys.size());
+    batch.reserve(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+      batch.push_back(std::move(pending.keys.front()));
+      pending.keys.pop_front();
+    }
+  }
+  if (!batch.empty()) {
+    Metrics::GetStats().ingest_last_batch_size = batch.size();
+    Metrics::GetStats().ingest_total_batches++;
+    Metrics::GetStats().ingest_total_batched_keys += batch.size();
+    std::vector<InternedStringPtr> keys;
+    keys.reserve(batch.size());
+    for (const auto &mutation : batch) {
+      keys.push_back(mutation.key);
+    }
+    vmsdk::WriterMutexLock lock(&time_sliced_mutex_);
+    ConsumeTrackedMutations(ctx, std::move(keys), priority);
+  }
+  {
+    absl::MutexLock lock(&stats_.mutex_);
+    for (const auto &mutation : batch) {
+      --stats_.mutation_queue_size_;
+      if (ABSL_PREDICT_FALSE(mutation.from_backfill)) {
+        --stats_.backfill_inqueue_tasks;
+      }
+      if (ABSL_PREDICT_FALSE(mutation.delay_capturer)) {
+        stats_.mutations_queue_delay_ = mutation.delay_capturer->Duration();
+      }
+    }
+  }
+  // Keys which arrived while every writer thread was busy are left for the
+  // running tasks, each of which goes back through the pool for its next
+  // batch, so that higher priority work isn't held up.
+  bool schedule_task = false;
+  {
+    absl::MutexLock lock(&mutated_records_mutex_);
+    auto &pending = pending_mutations_[static_cast<size_t>(priority)];
+    if (pending.waiting_tasks < pending.keys.size()) {
+      ++pending.waiting_tasks;
+      schedule_task = true;
+    } else {
+      --pending.tasks;
+    }
+  }
+  if (schedule_task) {
+    ScheduleMutationBatch(priority);
+  }
+}
+
 bool ShouldBlockClient(ValkeyModuleCtx *ctx, bool inside_multi_exec,
                        bool from_backfill) {
   return !inside_multi_exec && !from_backfill && vmsdk::IsRealUserClient(ctx);
@@ -673,15 +1027,10 @@ void IndexSchema::ProcessSingleMutationAsync(ValkeyModuleCtx *ctx,
                                              bool from_backfill,
                                              const InternedStringPtr &key,
                                              vmsdk::StopWatch *delay_capturer) {
-  bool first_time = true;
-  do {
-    auto mutation_record = ConsumeTrackedMutatedAttribute(key, first_time);
-    first_time = false;
-    if (!mutation_record.has_value()) {
-      break;
-    }
-    SyncProcessMutation(ctx, mutation_record.value(), key);
-  } while (true);
+  {
+    vmsdk::WriterMutexLock lock(&time_sliced_mutex_);
+    ConsumeTrackedMutations(ctx, {key}, vmsdk::ThreadPool::Priority::kMax);
+  }
   absl::MutexLock lock(&stats_.mutex_);
   --stats_.mutation_queue_size_;
   if (ABSL_PREDICT_FALSE(from_backfill)) {
@@ -692,6 +1041,31 @@ void IndexSchema::ProcessSingleMutationAsync(ValkeyModuleCtx *ctx,
   }
 }
 
+void IndexSchema::ConsumeTrackedMutations(
+    ValkeyModuleCtx *ctx, std::vector<InternedStringPtr> keys,
+    vmsdk::ThreadPool::Priority priority) {
+  // Mutations which arrive while the keys are applied are consumed in further
+  // rounds, until a round finds none and drops the keys from the tracking.
+  bool first_time = true;
+  std::vector<KeyMutation> mutations;
+  while (!keys.empty()) {
+    mutations.clear();
+    for (auto &key : keys) {
+      auto mutation_record = ConsumeTrackedMutatedAttribute(key, first_time);
+      if (mutation_record.has_value()) {
+        mutations.emplace_back(std::move(key),
+                               std::move(mutation_record.value()));
+      }
+    }
+    first_time = false;
+    ApplyMutations(ctx, mutations, priority);
+    keys.clear();
+    for (auto &mutation : mutations) {
+      keys.push_back(std::move(mutation.first));
+    }
+  }
+}
+
 void IndexSchema::BackfillScanCallback(ValkeyModuleCtx *ctx,
                                        ValkeyModuleString *keyname,
                                        ValkeyModuleKey *key, void *privdata) {
@@ -857,12 +1231,6 @@ void IndexSchema::RespondWithInfo(ValkeyModuleCtx *ctx) const {
   ValkeyModule_ReplyWithSimpleString(ctx, GetStateForInfo().data());
 }
 
-bool IsVectorIndex(std::shared_ptr<indexes::IndexBase> index) {
-  return index->GetIndexerType() == indexes::IndexerType::kVector ||
-         index->GetIndexerType() == indexes::IndexerType::kHNSW ||
-         index->GetIndexerType() == indexes::IndexerType::kFlat;
-}
-
 std::unique_ptr<data_model::IndexSchema> IndexSchema::ToProto() const {
   auto index_schema_proto = std::make_unique<data_model::IndexSchema>();
   index_schema_proto->set_name(this->name_);
@@ -1213,7 +1581,8 @@ absl::StatusOr<std::shared_ptr<IndexSchema>> IndexSchema::LoadFromRDB(
               IndexFactory(ctx, index_schema.get(), attribute,
                            supplemental_iter.IterateChunks()));
           VMSDK_RETURN_IF_ERROR(index_schema->AddIndex(
-              attribute.alias(), attribute.identifier(), index));
+              attribute.alias(), attribute.identifier(), index,
+              attribute.sortable()));
           break;
         }
         case data_model::SupplementalContentType::
@@ -1343,7 +1712,7 @@ void IndexSchema::OnLoadingEnded(ValkeyModuleCtx *ctx) {
                          << " stale entries for {Index: " << name_ << "}";
 
   for (auto &[key, attributes] : deletion_attributes) {
-    auto interned_key = std::make_shared<InternedString>(key);
+    auto interned_key = InternedString::MakeUninterned(key);
     ProcessMutation(ctx, attributes, interned_key, true);
   }
   VMSDK_LOG(NOTICE, ctx) << "Scanned index schema " << name_
@@ -1455,6 +1824,7 @@ IndexSchema::ConsumeTrackedMutatedAttribute(const InternedStringPtr &key,
   // Delete this tracked document if no additional mutations were tracked
   if (!itr->second.attributes.has_value()) {
     tracked_mutated_records_.erase(itr);
+    NoteAppliedMutation(key);
     return std::nullopt;
   }
   // Track entry is now first consumed
@@ -1463,6 +1833,40 @@ IndexSchema::ConsumeTrackedMutatedAttribute(const InternedStringPtr &key,
   return mutated_attributes;
 }
 
+void IndexSchema::NoteAppliedMutation(const InternedStringPtr &key) {
+  IsolatedMemoryScope scope{mutation_sequences_memory_pool_};
+  auto &sequences = mutation_sequences_;
+  sequences.by_key.insert_or_assign(key, ++mutation_sequence_);
+  sequences.in_order.emplace_back(key, mutation_sequence_);
+  if (sequences.in_order.size() <= kMaxMutationSequences) {
+    return;
+  }
+  // Only searches which began before the evicted mutation lose track of it.
+  const auto &[oldest_key, oldest_sequence] = sequences.in_order.front();
+  auto itr = sequences.by_key.find(oldest_key);
+  if (itr != sequences.by_key.end() && itr->second == oldest_sequence) {
+    sequences.by_key.erase(itr);
+    mutation_sequence_floor_ = oldest_sequence;
+  }
+  sequences.in_order.pop_front();
+}
+
+uint64_t IndexSchema::GetMutationSequence() const {
+  absl::MutexLock lock(&mutated_records_mutex_);
+  return mutation_sequence_;
+}
+
+bool IndexSchema::MutatedSince(const InternedStringPtr &key,
+                               uint64_t sequence) const {
+  absl::MutexLock lock(&mutated_records_mutex_);
+  if (sequence < mutation_sequence_floor_ ||
+      tracked_mutated_records_.contains(key)) {
+    return true;
+  }
+  auto itr = mutation_sequences_.by_key.find(key);
+  return itr != mutation_sequences_.by_key.end() && itr->second > sequence;
+}
+
 size_t IndexSchema::GetMutatedRecordsSize() const {
   absl::MutexLock lock(&mutated_records_mutex_);
   return tracked_mutated_records_.size();
@@ -8,17 +8,21 @@
 #ifndef VALKEYSEARCH_SRC_INDEX_SCHEMA_H_
 #define VALKEYSEARCH_SRC_INDEX_SCHEMA_H_
 
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
@@ -36,6 +40,7 @@
 #include "src/utils/string_interning.h"
 #include "vmsdk/src/blocked_client.h"
 #include "vmsdk/src/managed_pointers.h"
+#include "vmsdk/src/memory_tracker.h"
 #include "vmsdk/src/thread_pool.h"
 #include "vmsdk/src/time_sliced_mrmw_mutex.h"
 #include "vmsdk/src/utils.h"
@@ -101,7 +106,10 @@ class IndexSchema : public KeyspaceEventSubscription,
       absl::string_view attribute_alias) const;
   absl::Status AddIndex(absl::string_view attribute_alias,
                         absl::string_view identifier,
-                        std::shared_ptr<indexes::IndexBase> index);
+                        std::shared_ptr<indexes::IndexBase> index,
+                        bool sortable = false);
+  // The raw values of a SORTABLE attribute, null for other attributes.
+  const StoredField *GetStoredField(absl::string_view attribute_alias) const;
 
   void RespondWithInfo(ValkeyModuleCtx *ctx) const;
 
@@ -180,6 +188,18 @@ class IndexSchema : public KeyspaceEventSubscription,
   vmsdk::TimeSlicedMRMWMutex &GetTimeSlicedMutex() {
     return time_sliced_mutex_;
   }
+  // The sequence number of the last mutation applied to the indexes. A search
+  // notes it while it holds the reader lock.
+  uint64_t GetMutationSequence() const;
+  // Whether the key may differ from what the indexes held at the sequence: it
+  // has mutations which aren't applied yet, or were applied since.
+  bool MutatedSince(const InternedStringPtr &key, uint64_t sequence) const;
+  // Whether any attribute's index holds the key. Requires the reader lock.
+  bool IsTrackedByAnyIndex(const InternedStringPtr &key) const;
+  // The memory held by the content hashes of all the index schemas.
+  static int64_t GetContentHashesMemoryUsage();
+  // The memory held by the mutation sequences of all the index schemas.
+  static int64_t GetMutationSequencesMemoryUsage();
   void MarkAsDestructing();
   void ProcessMultiQueue();
   void SubscribeToVectorExternalizer(absl::string_view attribute_identifier,
@@ -211,8 +231,48 @@ class IndexSchema : public KeyspaceEventSubscription,
   vmsdk::ThreadPool *mutations_thread_pool_{nullptr};
   InternedStringMap<DocumentMutation> tracked_mutated_records_
       ABSL_GUARDED_BY(mutated_records_mutex_);
+  //
+  // Keys scheduled for the writer threads, by priority. Rather than a task per
+  // key, each writer task drains a batch of keys and applies them under a
+  // single writer lock. The batches share the queue among the writer tasks.
+  //
+  struct PendingMutation {
+    InternedStringPtr key;
+    bool from_backfill;
+    std::unique_ptr<vmsdk::StopWatch> delay_capturer;
+  };
+  struct PendingMutations {
+    std::deque<PendingMutation> keys;
+    // The writer tasks which haven't taken their batch yet, and all of them.
+    size_t waiting_tasks{0};
+    size_t tasks{0};
+  };
+  std::array<PendingMutations, 3> pending_mutations_
+      ABSL_GUARDED_BY(mutated_records_mutex_);
   bool is_destructing_ ABSL_GUARDED_BY(mutated_records_mutex_){false};
   mutable absl::Mutex mutated_records_mutex_;
+  //
+  // The sequence number of the last applied mutation of each key, for replies
+  // to tell which results may no longer match the filter. Bounded by evicting
+  // the oldest mutations and raising the floor to theirs, below which every
+  // key counts as mutated. Their memory is charged to
+  // mutation_sequences_memory_pool_, while the keys they pin stay charged to
+  // the string intern store.
+  //
+  static constexpr size_t kMaxMutationSequences{1 << 16};
+  struct MutationSequences {
+    InternedStringMap<uint64_t> by_key;
+    // The applied mutations, oldest first. An entry is stale once its key is
+    // mutated again.
+    std::deque<std::pair<InternedStringPtr, uint64_t>> in_order;
+    ~MutationSequences();
+  };
+  void NoteAppliedMutation(const InternedStringPtr &key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutated_records_mutex_);
+  uint64_t mutation_sequence_ ABSL_GUARDED_BY(mutated_records_mutex_){0};
+  uint64_t mutation_sequence_floor_ ABSL_GUARDED_BY(mutated_records_mutex_){0};
+  static MemoryPool mutation_sequences_memory_pool_;
+  MutationSequences mutation_sequences_ ABSL_GUARDED_BY(mutated_records_mutex_);
 
   struct BackfillJob {
     BackfillJob() = delete;
@@ -231,6 +291,19 @@ class IndexSchema : public KeyspaceEventSubscription,
   };
 
   vmsdk::MainThreadAccessGuard<std::optional<BackfillJob>> backfill_job_;
+  //
+  // A hash of the content last sent to each attribute's index, by attribute
+  // position, for the keys with any such content. Writes which leave an
+  // attribute as it was then skip it before it's copied or queued. Their
+  // memory is charged to content_hashes_memory_pool_, which is freed by
+  // ContentHashMap's destructor on whichever thread drops the schema.
+  //
+  using ContentHashes = absl::InlinedVector<uint64_t, 4>;
+  struct ContentHashMap : InternedStringMap<ContentHashes> {
+    ~ContentHashMap();
+  };
+  static MemoryPool content_hashes_memory_pool_;
+  vmsdk::MainThreadAccessGuard<ContentHashMap> content_hashes_;
   absl::flat_hash_map<std::string, indexes::VectorBase *>
       vector_externalizer_subscriptions_;
   void VectorExternalizer(const InternedStringPtr &key,
@@ -250,16 +323,45 @@ class IndexSchema : public KeyspaceEventSubscription,
                         vmsdk::ThreadPool::Priority priority,
                         absl::BlockingCounter *blocking_counter);
   void EnqueueMultiMutation(const InternedStringPtr &key);
+  void ScheduleMutationBatch(vmsdk::ThreadPool::Priority priority);
+  void ProcessMutationBatch(ValkeyModuleCtx *ctx,
+                            vmsdk::ThreadPool::Priority priority);
+  // Applies the tracked mutations of the keys, under the writer lock.
+  void ConsumeTrackedMutations(ValkeyModuleCtx *ctx,
+                               std::vector<InternedStringPtr> keys,
+                               vmsdk::ThreadPool::Priority priority);
+  using KeyMutation = std::pair<InternedStringPtr, MutatedAttributes>;
+  // Applies the mutations of the keys, under the writer lock. The attributes
+  // are independent indexes, so when a vector index is among several, each
+  // attribute's mutations are applied in key order by a thread of its own.
+  void ApplyMutations(ValkeyModuleCtx *ctx,
+                      std::vector<KeyMutation> &mutations,
+                      vmsdk::ThreadPool::Priority priority);
 
-  bool IsTrackedByAnyIndex(const InternedStringPtr &key) const;
   void SyncProcessMutation(ValkeyModuleCtx *ctx,
                            MutatedAttributes &mutated_attributes,
                            const InternedStringPtr &key);
-  void ProcessAttributeMutation(ValkeyModuleCtx *ctx,
-                                const Attribute &attribute,
-                                const InternedStringPtr &key,
-                                vmsdk::UniqueValkeyString data,
-                                indexes::DeletionType deletion_type);
+  void ApplyMutation(ValkeyModuleCtx *ctx,
+                     MutatedAttributes &mutated_attributes,
+                     const InternedStringPtr &key);
+  // What a mutation did to the records of an attribute's index.
+  enum class RecordChange { kNone, kAdded, kRemoved };
+  struct RecordChanges {
+    bool added{false};
+    bool removed{false};
+    void Add(RecordChange change) {
+      added |= change == RecordChange::kAdded;
+      removed |= change == RecordChange::kRemoved;
+    }
+  };
+  RecordChange ProcessAttributeMutation(ValkeyModuleCtx *ctx,
+                                        const Attribute &attribute,
+                                        const InternedStringPtr &key,
+                                        vmsdk::UniqueValkeyString data,
+                                        indexes::DeletionType deletion_type);
+  // Counts the key in or out of the documents after its mutation.
+  void UpdateDocumentCount(const InternedStringPtr &key, bool was_tracked,
+                           const RecordChanges &changes);
   static void BackfillScanCallback(ValkeyModuleCtx *ctx,
                                    ValkeyModuleString *keyname,
                                    ValkeyModuleKey *key, void *privdata);
@@ -292,6 +394,7 @@ class IndexSchema : public KeyspaceEventSubscription,
   FRIEND_TEST(IndexSchemaFriendTest, ConsistencyTest);
   FRIEND_TEST(IndexSchemaFriendTest, MutatedAttributes);
   FRIEND_TEST(IndexSchemaFriendTest, MutatedAttributesSanity);
+  FRIEND_TEST(IndexSchemaFriendTest, MutationSequenceEviction);
   FRIEND_TEST(ValkeySearchTest, Info);
   FRIEND_TEST(OnSwapDBCallbackTest, OnSwapDBCallback);
 };
@@ -8,11 +8,16 @@
 #ifndef VALKEYSEARCH_SRC_INDEXES_INDEX_BASE_H
 #define VALKEYSEARCH_SRC_INDEXES_INDEX_BASE_H
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/base/no_destructor.h"
+#include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
@@ -84,11 +89,115 @@ class EntriesFetcherIteratorBase {
   virtual ~EntriesFetcherIteratorBase() = default;
 };
 
+// The keys holding one indexed value, such as a tag or a number, in key order.
+// Unlike the addresses of the interned keys, the order is the same across runs,
+// so results which follow it are stable.
+using PostingList = absl::btree_set<InternedStringPtr, InternedStringPtrLess>;
+
+// Iterates, in key order, the distinct keys of a union of posting lists. The
+// lists are merged as they are walked and a key held by several of them is
+// returned once. SkipTo() seeks the lists rather than walking them, which lets
+// merge based joins, such as the leapfrog intersection of conjunctions, skip
+// ahead.
+class SortedEntriesIterator : public EntriesFetcherIteratorBase {
+ public:
+  // `owned_lists`, when given, keeps lists which no index holds alive.
+  explicit SortedEntriesIterator(
+      std::vector<const PostingList*> lists,
+      std::vector<std::unique_ptr<PostingList>> owned_lists = {})
+      : owned_lists_(std::move(owned_lists)) {
+    heads_.reserve(lists.size());
+    for (const auto* list : lists) {
+      if (!list->empty()) {
+        heads_.push_back(Head{list->begin(), list});
+      }
+    }
+    std::make_heap(heads_.begin(), heads_.end(), &Head::After);
+  }
+  bool Done() const override { return heads_.empty(); }
+  void Next() override {
+    // Moves every list off the current key.
+    const InternedString* current = heads_.front().pos->get();
+    do {
+      std::pop_heap(heads_.begin(), heads_.end(), &Head::After);
+      auto& head = heads_.back();
+      if (++head.pos == head.list->end()) {
+        heads_.pop_back();
+      } else {
+        std::push_heap(heads_.begin(), heads_.end(), &Head::After);
+      }
+    } while (!heads_.empty() && heads_.front().pos->get() == current);
+  }
+  const InternedStringPtr& operator*() const override {
+    return *heads_.front().pos;
+  }
+
+  // Advances to the first key which is not less than `key`.
+  void SkipTo(const InternedStringPtr& key) {
+    InternedStringPtrLess less;
+    while (!heads_.empty() && less(*heads_.front().pos, key)) {
+      std::pop_heap(heads_.begin(), heads_.end(), &Head::After);
+      auto& head = heads_.back();
+      head.pos = head.list->lower_bound(key);
+      if (head.pos == head.list->end()) {
+        heads_.pop_back();
+      } else {
+        std::push_heap(heads_.begin(), heads_.end(), &Head::After);
+      }
+    }
+  }
+
+ private:
+  struct Head {
+    PostingList::const_iterator pos;
+    const PostingList* list;
+    // Orders the heap so that its front holds the smallest key.
+    static bool After(const Head& lhs, const Head& rhs) {
+      return InternedStringPtrLess()(*rhs.pos, *lhs.pos);
+    }
+  };
+  std::vector<Head> heads_;
+  std::vector<std::unique_ptr<PostingList>> owned_lists_;
+};
+
 class EntriesFetcherBase {
  public:
   virtual size_t Size() const = 0;
+  // Whether Size() is the exact number of distinct keys Begin() yields rather
+  // than an upper bound.
+  virtual bool IsSizeExact() const { return false; }
+  // Whether Begin() may yield a key more than once.
+  virtual bool MayRepeatKeys() const { return false; }
   virtual ~EntriesFetcherBase() = default;
   virtual std::unique_ptr<EntriesFetcherIteratorBase> Begin() = 0;
+  // Appends the posting lists holding the fetched keys to `lists`, unless
+  // there are more than `max_lists` of them. Returns false, leaving `lists` as
+  // is, in that case or when the keys aren't held in posting lists.
+  virtual bool AppendPostingLists(
+      size_t max_lists, std::vector<const PostingList*>& lists) const {
+    return false;
+  }
+  // Returns the fetched keys in key order, by merging their posting lists or,
+  // when they have none, from a sorted copy of them.
+  std::unique_ptr<SortedEntriesIterator> SortedBegin() {
+    std::vector<const PostingList*> lists;
+    if (AppendPostingLists(std::numeric_limits<size_t>::max(), lists)) {
+      return std::make_unique<SortedEntriesIterator>(std::move(lists));
+    }
+    std::vector<std::unique_ptr<PostingList>> owned_lists;
+    owned_lists.push_back(CopyKeys());
+    lists.push_back(owned_lists.back().get());
+    return std::make_unique<SortedEntriesIterator>(std::move(lists),
+                                                   std::move(owned_lists));
+  }
+  // Copies the keys Begin() yields into a posting list.
+  std::unique_ptr<PostingList> CopyKeys() {
+    auto keys = std::make_unique<PostingList>();
+    for (auto itr = Begin(); !itr->Done(); itr->Next()) {
+      keys->insert(**itr);
+    }
+    return keys;
+  }
 };
 
 }  // namespace valkey_search::indexes
@@ -13,6 +13,8 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
@@ -167,7 +169,7 @@ std::unique_ptr<Numeric::EntriesFetcher> Numeric::Search(
 
 bool Numeric::EntriesFetcherIterator::NextKeys(
     const Numeric::EntriesRange& range, BTreeNumericIndex::ConstIterator& iter,
-    std::optional<InternedStringSet::const_iterator>& keys_iter) {
+    std::optional<PostingList::const_iterator>& keys_iter) {
   while (iter != range.second) {
     if (!keys_iter.has_value()) {
       keys_iter = iter->second.begin();
@@ -242,6 +244,11 @@ const InternedStringPtr& Numeric::EntriesFetcherIterator::operator*() const {
 
 size_t Numeric::EntriesFetcher::Size() const { return size_; }
 
+bool Numeric::EntriesFetcher::IsSizeExact() const {
+  // Only a single, non-negated range is counted exactly by the segment tree.
+  return !additional_entries_range_.has_value() && untracked_keys_ == nullptr;
+}
+
 std::unique_ptr<EntriesFetcherIteratorBase> Numeric::EntriesFetcher::Begin() {
   auto itr = std::make_unique<EntriesFetcherIterator>(
       entries_range_, additional_entries_range_, untracked_keys_);
@@ -249,6 +256,30 @@ std::unique_ptr<EntriesFetcherIteratorBase> Numeric::EntriesFetcher::Begin() {
   return itr;
 }
 
+bool Numeric::EntriesFetcher::AppendPostingLists(
+    size_t max_lists, std::vector<const PostingList*>& lists) const {
+  if (additional_entries_range_.has_value() || untracked_keys_) {
+    return false;
+  }
+  const size_t initial_size = lists.size();
+  for (auto it = entries_range_.first; it != entries_range_.second; ++it) {
+    if (lists.size() - initial_size == max_lists) {
+      lists.resize(initial_size);
+      return false;
+    }
+    lists.push_back(&it->second);
+  }
+  return true;
+}
+
+size_t Numeric::GetCount(double start, double end, bool start_inclusive,
+                         bool end_inclusive) const {
+  if (start > end || (start == end && !(start_inclusive && end_inclusive))) {
+    return 0;
+  }
+  return index_->GetCount(start, end, start_inclusive, end_inclusive);
+}
+
 size_t Numeric::GetTrackedKeyCount() const {
   absl::MutexLock lock(&index_mutex_);
   return tracked_keys_.size();
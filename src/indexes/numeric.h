@@ -13,6 +13,7 @@
 #include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/btree_map.h"
@@ -34,10 +35,11 @@
 namespace valkey_search::indexes {
 
 template <typename T, typename Hasher = absl::Hash<T>,
-          typename Equalizer = std::equal_to<T>>
+          typename Equalizer = std::equal_to<T>,
+          typename Set = absl::flat_hash_set<T, Hasher, Equalizer>>
 class BTreeNumeric {
  public:
-  using SetType = absl::flat_hash_set<T, Hasher, Equalizer>;
+  using SetType = Set;
   using ConstIterator =
       typename absl::btree_map<double, SetType>::const_iterator;
 
@@ -116,9 +118,15 @@ class Numeric : public IndexBase {
 
   const double* GetValue(const InternedStringPtr& key) const
       ABSL_NO_THREAD_SAFETY_ANALYSIS;
+  // Returns the number of tracked keys whose value lies within the range, as
+  // maintained by the segment tree.
+  size_t GetCount(double start, double end, bool start_inclusive,
+                  bool end_inclusive) const ABSL_NO_THREAD_SAFETY_ANALYSIS;
+  // The keys of a value are kept in a posting list, so that the keys of a
+  // range of values can be merged in order.
   using BTreeNumericIndex =
       BTreeNumeric<InternedStringPtr, InternedStringPtrHash,
-                   InternedStringPtrEqual>;
+                   InternedStringPtrEqual, PostingList>;
   using EntriesRange = std::pair<BTreeNumericIndex::ConstIterator,
                                  BTreeNumericIndex::ConstIterator>;
   class EntriesFetcherIterator : public EntriesFetcherIteratorBase {
@@ -135,14 +143,13 @@ class Numeric : public IndexBase {
     static bool NextKeys(
         const Numeric::EntriesRange& range,
         BTreeNumericIndex::ConstIterator& iter,
-        std::optional<InternedStringSet::const_iterator>& keys_iter);
+        std::optional<PostingList::const_iterator>& keys_iter);
     const EntriesRange& entries_range_;
     BTreeNumericIndex::ConstIterator entries_iter_;
-    std::optional<InternedStringSet::const_iterator> entry_keys_iter_;
+    std::optional<PostingList::const_iterator> entry_keys_iter_;
     const std::optional<EntriesRange>& additional_entries_range_;
     BTreeNumericIndex::ConstIterator additional_entries_iter_;
-    std::optional<InternedStringSet::const_iterator>
-        additional_entry_keys_iter_;
+    std::optional<PostingList::const_iterator> additional_entry_keys_iter_;
     const InternedStringSet* untracked_keys_;
     std::optional<InternedStringSet::const_iterator> untracked_keys_iter_;
   };
@@ -158,7 +165,11 @@ class Numeric : public IndexBase {
           additional_entries_range_(additional_entries_range),
           untracked_keys_(untracked_keys) {}
     size_t Size() const override;
+    bool IsSizeExact() const override;
     std::unique_ptr<EntriesFetcherIteratorBase> Begin() override;
+    bool AppendPostingLists(
+        size_t max_lists,
+        std::vector<const PostingList*>& lists) const override;
 
    private:
     EntriesRange entries_range_;
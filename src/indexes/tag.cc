@@ -215,24 +215,20 @@ const absl::flat_hash_set<absl::string_view>* Tag::GetValue(
 
 Tag::EntriesFetcherIterator::EntriesFetcherIterator(
     const PatriciaTreeIndex& tree,
-    absl::flat_hash_set<PatriciaNodeIndex*>& entries,
-    const InternedStringSet& untracked_keys, bool negate)
+    const absl::flat_hash_set<PatriciaNodeIndex*>& entries,
+    const InternedStringSet& untracked_keys)
     : tree_iter_(tree.RootIterator()),
       entries_(entries),
-      untracked_keys_(untracked_keys),
-      negate_(negate) {}
+      untracked_keys_(untracked_keys) {}
 
 bool Tag::EntriesFetcherIterator::Done() const {
-  if (negate_) {
-    return tree_iter_.Done() &&
-           (untracked_keys_.empty() ||
-            (untracked_keys_iter_.has_value() &&
-             untracked_keys_iter_.value() == untracked_keys_.end()));
-  }
-  return entries_.empty() && next_node_ == nullptr;
+  return tree_iter_.Done() &&
+         (untracked_keys_.empty() ||
+          (untracked_keys_iter_.has_value() &&
+           untracked_keys_iter_.value() == untracked_keys_.end()));
 }
 
-void Tag::EntriesFetcherIterator::NextNegate() {
+void Tag::EntriesFetcherIterator::Next() {
   if (next_node_) {
     ++next_iter_;
     if (next_iter_ != next_node_->value.value().end()) {
@@ -257,42 +253,18 @@ void Tag::EntriesFetcherIterator::NextNegate() {
   ++untracked_keys_iter_.value();
 }
 
-void Tag::EntriesFetcherIterator::Next() {
-  if (negate_) {
-    NextNegate();
-    return;
-  }
-  if (next_node_) {
-    ++next_iter_;
-    if (next_iter_ != next_node_->value.value().end()) {
-      return;
-    }
-  }
-  while (!entries_.empty()) {
-    auto itr = entries_.begin();
-    next_node_ = *itr;
-    entries_.erase(itr);
-    if (next_node_->value.has_value() && !next_node_->value.value().empty()) {
-      next_iter_ = next_node_->value.value().begin();
-      return;
-    }
-  }
-  next_node_ = nullptr;
-}
-
 const InternedStringPtr& Tag::EntriesFetcherIterator::operator*() const {
-  if (negate_ && tree_iter_.Done()) {
+  if (tree_iter_.Done()) {
     return *untracked_keys_iter_.value();
   }
   return *next_iter_;
 }
 
 // TODO: b/357027854 - Support Suffix/Infix Search
-std::unique_ptr<Tag::EntriesFetcher> Tag::Search(
-    const query::TagPredicate& predicate, bool negate) const {
-  absl::flat_hash_set<PatriciaNodeIndex*> entries;
+size_t Tag::CollectEntries(
+    const query::TagPredicate& predicate,
+    absl::flat_hash_set<PatriciaNodeIndex*>& entries) const {
   size_t size = 0;
-
   for (const auto& tag : predicate.GetTags()) {
     if (tag.back() == '*') {
       auto prefix_tag = tag.substr(0, tag.length() - 1);
@@ -316,6 +288,24 @@ std::unique_ptr<Tag::EntriesFetcher> Tag::Search(
       }
     }
   }
+  return size;
+}
+
+size_t Tag::EstimateMatches(const query::TagPredicate& predicate) const {
+  if (auto matches = predicate.GetEstimatedMatches(); matches.has_value()) {
+    return matches.value();
+  }
+  absl::flat_hash_set<PatriciaNodeIndex*> entries;
+  size_t size = CollectEntries(predicate, entries);
+  predicate.SetEstimatedMatches(size);
+  return size;
+}
+
+std::unique_ptr<Tag::EntriesFetcher> Tag::Search(
+    const query::TagPredicate& predicate, bool negate) const {
+  absl::flat_hash_set<PatriciaNodeIndex*> entries;
+  size_t size = CollectEntries(predicate, entries);
+  predicate.SetEstimatedMatches(size);
   if (negate) {
     size = tracked_tags_by_keys_.size() > size
                ? tracked_tags_by_keys_.size() - size
@@ -327,14 +317,47 @@ std::unique_ptr<Tag::EntriesFetcher> Tag::Search(
 }
 
 std::unique_ptr<EntriesFetcherIteratorBase> Tag::EntriesFetcher::Begin() {
+  if (!negate_) {
+    // The lists of the searched tags are merged, so that a key carrying
+    // several of them is yielded once.
+    return SortedBegin();
+  }
   auto itr = std::make_unique<EntriesFetcherIterator>(tree_, entries_,
-                                                      untracked_keys_, negate_);
+                                                      untracked_keys_);
   itr->Next();
   return itr;
 }
 
 size_t Tag::EntriesFetcher::Size() const { return size_; }
 
+bool Tag::EntriesFetcher::IsSizeExact() const {
+  // Keys carrying several of the searched tags are counted once per tag.
+  return !negate_ && entries_.size() <= 1;
+}
+
+bool Tag::EntriesFetcher::MayRepeatKeys() const { return negate_; }
+
+bool Tag::EntriesFetcher::AppendPostingLists(
+    size_t max_lists, std::vector<const PostingList*>& lists) const {
+  if (negate_) {
+    return false;
+  }
+  // A key carrying several of the searched tags is held by more than one list,
+  // SortedEntriesIterator returns it once.
+  const size_t initial_size = lists.size();
+  for (const auto* node : entries_) {
+    if (!node->value.has_value() || node->value.value().empty()) {
+      continue;
+    }
+    if (lists.size() - initial_size == max_lists) {
+      lists.resize(initial_size);
+      return false;
+    }
+    lists.push_back(&node->value.value());
+  }
+  return true;
+}
+
 size_t Tag::GetTrackedKeyCount() const {
   absl::MutexLock lock(&index_mutex_);
   return tracked_tags_by_keys_.size();
@@ -11,6 +11,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_set.h"
@@ -69,32 +70,35 @@ class Tag : public IndexBase {
   const absl::flat_hash_set<absl::string_view>* GetValue(
       const InternedStringPtr& key,
       bool& case_sensitive) const ABSL_NO_THREAD_SAFETY_ANALYSIS;
+  // The keys of a tag are kept in a posting list, so that the keys of several
+  // tags can be merged in order.
   using PatriciaTreeIndex =
       PatriciaTree<InternedStringPtr, InternedStringPtrHash,
-                   InternedStringPtrEqual>;
+                   InternedStringPtrEqual, PostingList>;
   using PatriciaNodeIndex =
       PatriciaNode<InternedStringPtr, InternedStringPtrHash,
-                   InternedStringPtrEqual>;
+                   InternedStringPtrEqual, PostingList>;
 
+  // Iterates the keys of a negated search: those of the tags which aren't
+  // searched, then the untracked keys. A key carrying several tags which
+  // aren't searched is yielded once per tag.
   class EntriesFetcherIterator : public EntriesFetcherIteratorBase {
    public:
-    EntriesFetcherIterator(const PatriciaTreeIndex& tree,
-                           absl::flat_hash_set<PatriciaNodeIndex*>& entries,
-                           const InternedStringSet& untracked_keys,
-                           bool negate);
+    EntriesFetcherIterator(
+        const PatriciaTreeIndex& tree,
+        const absl::flat_hash_set<PatriciaNodeIndex*>& entries,
+        const InternedStringSet& untracked_keys);
     bool Done() const override;
     void Next() override;
     const InternedStringPtr& operator*() const override;
 
    private:
     PatriciaTreeIndex::PrefixSubTreeIterator tree_iter_;
-    absl::flat_hash_set<PatriciaNodeIndex*>& entries_;
+    const absl::flat_hash_set<PatriciaNodeIndex*>& entries_;
     PatriciaNodeIndex* next_node_{nullptr};
-    InternedStringSet::const_iterator next_iter_;
+    PostingList::const_iterator next_iter_;
     const InternedStringSet& untracked_keys_;
-    bool negate_;
     std::optional<InternedStringSet::const_iterator> untracked_keys_iter_;
-    void NextNegate();
   };
 
   class EntriesFetcher : public EntriesFetcherBase {
@@ -108,7 +112,12 @@ class Tag : public IndexBase {
           negate_(negate),
           untracked_keys_(untracked_keys){};
     size_t Size() const override;
+    bool IsSizeExact() const override;
+    bool MayRepeatKeys() const override;
     std::unique_ptr<EntriesFetcherIteratorBase> Begin() override;
+    bool AppendPostingLists(
+        size_t max_lists,
+        std::vector<const PostingList*>& lists) const override;
 
    private:
     const PatriciaTreeIndex& tree_;
@@ -121,6 +130,11 @@ class Tag : public IndexBase {
   virtual std::unique_ptr<EntriesFetcher> Search(
       const query::TagPredicate& predicate,
       bool negate) const ABSL_NO_THREAD_SAFETY_ANALYSIS;
+  // Returns an upper bound of the keys matching the predicate: keys carrying
+  // several of the searched tags are counted once per tag. The count is kept
+  // on the predicate, which lives for one query.
+  size_t EstimateMatches(const query::TagPredicate& predicate) const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS;
   char GetSeparator() const { return separator_; }
   bool IsCaseSensitive() const { return case_sensitive_; }
   static absl::StatusOr<absl::flat_hash_set<absl::string_view>> ParseSearchTags(
@@ -129,6 +143,9 @@ class Tag : public IndexBase {
       absl::string_view data, char separator);
 
  private:
+  size_t CollectEntries(const query::TagPredicate& predicate,
+                        absl::flat_hash_set<PatriciaNodeIndex*>& entries) const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS;
   mutable absl::Mutex index_mutex_;
   struct TagInfo {
     InternedStringPtr raw_tag_string;
@@ -139,8 +139,8 @@ void VectorBase::Init(int dimensions,
   }
 }
 
-std::shared_ptr<InternedString> VectorBase::InternVector(
-    absl::string_view record, std::optional<float> &magnitude) {
+InternedStringPtr VectorBase::InternVector(absl::string_view record,
+                                           std::optional<float> &magnitude) {
   if (!IsValidSizeVector(record)) {
     return nullptr;
   }
@@ -476,8 +476,7 @@ VectorBase::ComputeDistanceFromRecord(const InternedStringPtr &key,
 
 bool VectorBase::AddPrefilteredKey(
     absl::string_view query, uint64_t count, const InternedStringPtr &key,
-    std::priority_queue<std::pair<float, hnswlib::labeltype>> &results,
-    absl::flat_hash_set<const char *> &top_keys) const {
+    std::priority_queue<std::pair<float, hnswlib::labeltype>> &results) const {
   auto result = ComputeDistanceFromRecord(key, query);
   if (!result.ok()) {
     return false;
@@ -487,9 +486,6 @@ bool VectorBase::AddPrefilteredKey(
     return true;
   }
   if (result.value().first < results.top().first) {
-    auto top = results.top();
-    auto vector_key = GetKeyDuringSearch(top.second);
-    top_keys.erase(vector_key.value()->Str().data());
     results.pop();
     results.emplace(result.value());
     return true;
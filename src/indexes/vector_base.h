@@ -79,6 +79,9 @@ struct Neighbor {
   }
 };
 
+// The free vector buffers each writer thread caches.
+constexpr size_t kVectorAllocatorMagazineSize = 64;
+
 const absl::NoDestructor<absl::flat_hash_map<
     absl::string_view, data_model::VectorIndex::AlgorithmCase>>
     kVectorAlgoByStr({
@@ -150,8 +153,7 @@ class VectorBase : public IndexBase, public hnswlib::VectorTracker {
       uint64_t internal_id) const ABSL_NO_THREAD_SAFETY_ANALYSIS;
   bool AddPrefilteredKey(
       absl::string_view query, uint64_t count, const InternedStringPtr& key,
-      std::priority_queue<std::pair<float, hnswlib::labeltype>>& results,
-      absl::flat_hash_set<const char*>& top_keys) const;
+      std::priority_queue<std::pair<float, hnswlib::labeltype>>& results) const;
   vmsdk::UniqueValkeyString NormalizeStringRecord(
       vmsdk::UniqueValkeyString record) const override;
   template <typename T>
@@ -161,8 +163,8 @@ class VectorBase : public IndexBase, public hnswlib::VectorTracker {
       ABSL_NO_THREAD_SAFETY_ANALYSIS;
   int GetVectorDataSize() const { return GetDataTypeSize() * dimensions_; }
   char* TrackVector(uint64_t internal_id, char* vector, size_t len) override;
-  std::shared_ptr<InternedString> InternVector(absl::string_view record,
-                                               std::optional<float>& magnitude);
+  InternedStringPtr InternVector(absl::string_view record,
+                                 std::optional<float>& magnitude);
 
  protected:
   VectorBase(IndexerType indexer_type, int dimensions,
@@ -174,8 +176,9 @@ class VectorBase : public IndexBase, public hnswlib::VectorTracker {
         attribute_data_type_(attribute_data_type)
 #ifndef SAN_BUILD
         ,
-        vector_allocator_(CREATE_UNIQUE_PTR(
-            FixedSizeAllocator, dimensions * sizeof(float) + 1, true))
+        vector_allocator_(CREATE_UNIQUE_PTR(FixedSizeAllocator,
+                                            dimensions * sizeof(float) + 1,
+                                            true, kVectorAllocatorMagazineSize))
 #endif  // !SAN_BUILD
   {
   }
@@ -34,6 +34,8 @@ class Metrics {
     uint64_t query_hybrid_requests_cnt{0};
     std::atomic<uint64_t> query_inline_filtering_requests_cnt{0};
     std::atomic<uint64_t> query_prefiltering_requests_cnt{0};
+    std::atomic<uint64_t> query_streamed_requests_cnt{0};
+    std::atomic<uint64_t> query_count_only_requests_cnt{0};
     std::atomic<uint64_t> hnsw_add_exceptions_cnt{0};
     std::atomic<uint64_t> hnsw_remove_exceptions_cnt{0};
     std::atomic<uint64_t> hnsw_modify_exceptions_cnt{0};
@@ -64,12 +66,20 @@ class Metrics {
         0};
     std::atomic<uint64_t> coordinator_server_search_index_partition_failure_cnt{
         0};
+    std::atomic<uint64_t>
+        coordinator_server_aggregate_index_partition_success_cnt{0};
+    std::atomic<uint64_t>
+        coordinator_server_aggregate_index_partition_failure_cnt{0};
     std::atomic<uint64_t> coordinator_client_get_global_metadata_success_cnt{0};
     std::atomic<uint64_t> coordinator_client_get_global_metadata_failure_cnt{0};
     std::atomic<uint64_t> coordinator_client_search_index_partition_success_cnt{
         0};
     std::atomic<uint64_t> coordinator_client_search_index_partition_failure_cnt{
         0};
+    std::atomic<uint64_t>
+        coordinator_client_aggregate_index_partition_success_cnt{0};
+    std::atomic<uint64_t>
+        coordinator_client_aggregate_index_partition_failure_cnt{0};
     std::atomic<uint64_t> coordinator_bytes_out{0};
     std::atomic<uint64_t> coordinator_bytes_in{0};
 
@@ -83,6 +93,8 @@ class Metrics {
     std::atomic<uint64_t> ingest_field_tag{0};
     std::atomic<uint64_t> ingest_last_batch_size{0};
     std::atomic<uint64_t> ingest_total_batches{0};
+    std::atomic<uint64_t> ingest_total_batched_keys{0};
+    std::atomic<uint64_t> ingest_field_unchanged{0};
     std::atomic<uint64_t> ingest_total_failures{0};
     vmsdk::LatencySampler
         coordinator_client_get_global_metadata_failure_latency{
@@ -8,6 +8,8 @@
 #include <memory>
 
 #include "src/commands/commands.h"
+#include "src/commands/ft_aggregate_partition.h"
+#include "src/coordinator/server.h"
 #include "src/keyspace_event_manager.h"
 #include "src/valkey_search.h"
 #include "src/version.h"
@@ -97,6 +99,14 @@ vmsdk::module::Options options = {
                 .cmd_func =
                     &vmsdk::CreateCommand<valkey_search::FTAggregateCmd>,
             },
+            {
+                .cmd_name = valkey_search::kCursorCommand,
+                .permissions = ACLPermissionFormatter(
+                    valkey_search::kSearchCmdPermissions),
+                .flags = {vmsdk::module::kReadOnlyFlag,
+                          vmsdk::module::kDenyOOMFlag},
+                .cmd_func = &vmsdk::CreateCommand<valkey_search::FTCursorCmd>,
+            },
         },
     .on_load =
         [](ValkeyModuleCtx *ctx, ValkeyModuleString **argv, int argc,
@@ -105,6 +115,9 @@ vmsdk::module::Options options = {
               std::make_unique<valkey_search::KeyspaceEventManager>());
           valkey_search::ValkeySearch::InitInstance(
               std::make_unique<valkey_search::ValkeySearch>());
+          valkey_search::coordinator::Service::
+              SetAggregateIndexPartitionHandler(
+                  &valkey_search::aggregate::AggregateIndexPartition);
 
           return valkey_search::ValkeySearch::Instance().OnLoad(ctx, argv,
                                                                 argc);
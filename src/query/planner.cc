@@ -7,6 +7,7 @@
 
 #include "src/query/planner.h"
 
+#include <algorithm>
 #include <cstddef>
 
 #include "absl/log/check.h"
@@ -39,4 +40,14 @@ bool UsePreFiltering(size_t estimated_num_of_keys,
   CHECK(false) << "Unsupported indexer type: "
                << (int)vector_index->GetIndexerType();
 }
+
+// Merging a clause's posting lists starts with a seek into each of them, which
+// costs about as much as the index lookup that verifying the clause takes for
+// each key of the most selective clause. A clause made of no more lists than
+// that key count thus never costs more to set up for the join than to verify.
+// After that, the join seeks over the keys that can't match instead of
+// visiting them.
+size_t MaxLeapfrogJoinPostingLists(size_t smallest_clause_entries) {
+  return std::max<size_t>(smallest_clause_entries, 1);
+}
 }  // namespace valkey_search::query
@@ -16,6 +16,12 @@ namespace valkey_search::query {
 // heuristics.
 bool UsePreFiltering(size_t estimated_num_of_keys,
                      indexes::VectorBase *vector_index);
+
+// Returns how many posting lists a conjunction clause may be merged from to
+// take part in the leapfrog join, given that the most selective clause
+// qualifies `smallest_clause_entries` keys. Clauses made of more lists are
+// verified against each joined key instead.
+size_t MaxLeapfrogJoinPostingLists(size_t smallest_clause_entries);
 }  // namespace valkey_search::query
 
 #endif  // VALKEYSEARCH_SRC_QUERY_PLANNER_H_
@@ -9,6 +9,7 @@
 #define VALKEYSEARCH_SRC_QUERY_PREDICATE_H_
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -119,6 +120,14 @@ class TagPredicate : public Predicate {
   }
   const std::string& GetTagString() const { return raw_tag_string_; }
   const absl::flat_hash_set<std::string>& GetTags() const { return tags_; }
+  // The number of keys of the index carrying the searched tags, as counted by
+  // the first search or estimate of the query, so the tag trie is walked once.
+  std::optional<size_t> GetEstimatedMatches() const {
+    return estimated_matches_;
+  }
+  void SetEstimatedMatches(size_t matches) const {
+    estimated_matches_ = matches;
+  }
 
  private:
   const indexes::Tag* index_;
@@ -126,6 +135,7 @@ class TagPredicate : public Predicate {
   std::string alias_;
   std::string raw_tag_string_;
   absl::flat_hash_set<std::string> tags_;
+  mutable std::optional<size_t> estimated_matches_;
 };
 enum class LogicalOperator { kAnd, kOr };
 // Composed Predicate (AND/OR)
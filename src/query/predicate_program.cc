@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#include "src/query/predicate_program.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "src/indexes/numeric.h"
+#include "src/indexes/tag.h"
+#include "src/query/predicate.h"
+#include "src/utils/string_interning.h"
+
+namespace valkey_search::query {
+
+namespace {
+
+// Relative evaluation costs of the clauses. A numeric clause is a single
+// lookup and comparison, a tag clause compares every tag of the key with
+// every searched tag.
+constexpr double kNumericCost = 1.0;
+constexpr double kTagCost = 2.0;
+
+double MatchRatio(size_t matches, size_t keys) {
+  if (keys == 0) {
+    return 0.0;
+  }
+  return std::min(1.0, static_cast<double>(matches) / keys);
+}
+
+}  // namespace
+
+// A node of the predicate tree with negations pushed down to the leaves and
+// nested chains of the same operator flattened.
+struct PredicateProgram::Term {
+  const Predicate* leaf{nullptr};
+  bool negate{false};
+  bool is_and{false};
+  std::vector<Term> operands;
+  double true_probability{0.0};
+  double cost{0.0};
+};
+
+PredicateProgram::Term PredicateProgram::Build(const Predicate& predicate,
+                                               bool negate) {
+  Term term;
+  switch (predicate.GetType()) {
+    case PredicateType::kNegate: {
+      auto negate_predicate = dynamic_cast<const NegatePredicate*>(&predicate);
+      return Build(*negate_predicate->GetPredicate(), !negate);
+    }
+    case PredicateType::kNumeric: {
+      auto numeric_predicate =
+          dynamic_cast<const NumericPredicate*>(&predicate);
+      auto index = numeric_predicate->GetIndex();
+      term.leaf = &predicate;
+      term.negate = negate;
+      term.cost = kNumericCost;
+      term.true_probability = MatchRatio(
+          index->GetCount(numeric_predicate->GetStart(),
+                          numeric_predicate->GetEnd(),
+                          numeric_predicate->IsStartInclusive(),
+                          numeric_predicate->IsEndInclusive()),
+          index->GetTrackedKeyCount() + index->GetUnTrackedKeyCount());
+      break;
+    }
+    case PredicateType::kTag: {
+      auto tag_predicate = dynamic_cast<const TagPredicate*>(&predicate);
+      auto index = tag_predicate->GetIndex();
+      term.leaf = &predicate;
+      term.negate = negate;
+      term.cost = kTagCost + tag_predicate->GetTags().size();
+      term.true_probability = MatchRatio(
+          index->EstimateMatches(*tag_predicate),
+          index->GetTrackedKeyCount() + index->GetUnTrackedKeyCount());
+      break;
+    }
+    case PredicateType::kComposedAnd:
+    case PredicateType::kComposedOr: {
+      auto composed_predicate =
+          dynamic_cast<const ComposedPredicate*>(&predicate);
+      // De Morgan: a negated AND is an OR of negated operands and vice versa.
+      term.is_and =
+          (predicate.GetType() == PredicateType::kComposedAnd) != negate;
+      for (auto operand : {composed_predicate->GetLhsPredicate(),
+                           composed_predicate->GetRhsPredicate()}) {
+        auto operand_term = Build(*operand, negate);
+        if (operand_term.leaf == nullptr &&
+            operand_term.is_and == term.is_and) {
+          for (auto& nested : operand_term.operands) {
+            term.operands.push_back(std::move(nested));
+          }
+        } else {
+          term.operands.push_back(std::move(operand_term));
+        }
+      }
+      // An AND chain is cheapest when operands likely to fail come first, an
+      // OR chain when operands likely to succeed do, both weighed by cost.
+      auto rank = [is_and = term.is_and](const Term& operand) {
+        double decisive = is_and ? 1.0 - operand.true_probability
+                                 : operand.true_probability;
+        return decisive > 0.0 ? operand.cost / decisive
+                              : std::numeric_limits<double>::infinity();
+      };
+      std::stable_sort(term.operands.begin(), term.operands.end(),
+                       [&rank](const Term& lhs, const Term& rhs) {
+                         return rank(lhs) < rank(rhs);
+                       });
+      double reach_probability = 1.0;
+      term.true_probability = term.is_and ? 1.0 : 0.0;
+      for (const auto& operand : term.operands) {
+        term.cost += reach_probability * operand.cost;
+        if (term.is_and) {
+          reach_probability *= operand.true_probability;
+          term.true_probability *= operand.true_probability;
+        } else {
+          reach_probability *= 1.0 - operand.true_probability;
+          term.true_probability =
+              1.0 - (1.0 - term.true_probability) *
+                        (1.0 - operand.true_probability);
+        }
+      }
+      return term;
+    }
+    default:
+      CHECK(false) << "Unsupported predicate type: "
+                   << static_cast<int>(predicate.GetType());
+  }
+  if (negate) {
+    term.true_probability = 1.0 - term.true_probability;
+  }
+  return term;
+}
+
+uint32_t PredicateProgram::Emit(const Term& term, uint32_t on_true,
+                                uint32_t on_false) {
+  if (term.leaf != nullptr) {
+    Instruction instruction;
+    if (term.leaf->GetType() == PredicateType::kNumeric) {
+      instruction.numeric_predicate =
+          dynamic_cast<const NumericPredicate*>(term.leaf);
+      instruction.numeric_index = instruction.numeric_predicate->GetIndex();
+    } else {
+      instruction.tag_predicate = dynamic_cast<const TagPredicate*>(term.leaf);
+      instruction.tag_index = instruction.tag_predicate->GetIndex();
+    }
+    instruction.on_true = term.negate ? on_false : on_true;
+    instruction.on_false = term.negate ? on_true : on_false;
+    instructions_.push_back(instruction);
+    return instructions_.size() - 1;
+  }
+  // Operands are emitted back to front so each one knows where to continue.
+  uint32_t next = term.is_and ? on_true : on_false;
+  for (auto it = term.operands.rbegin(); it != term.operands.rend(); ++it) {
+    next = term.is_and ? Emit(*it, next, on_false) : Emit(*it, on_true, next);
+  }
+  return next;
+}
+
+PredicateProgram::PredicateProgram(const Predicate& predicate) {
+  entry_ = Emit(Build(predicate, false), kAccept, kReject);
+}
+
+bool PredicateProgram::Evaluate(const InternedStringPtr& key) const {
+  uint32_t pc = entry_;
+  while (pc < kAccept) {
+    const auto& instruction = instructions_[pc];
+    bool result;
+    if (instruction.numeric_index != nullptr) {
+      result = instruction.numeric_predicate->Evaluate(
+          instruction.numeric_index->GetValue(key));
+    } else {
+      bool case_sensitive = true;
+      auto tags = instruction.tag_index->GetValue(key, case_sensitive);
+      result = instruction.tag_predicate->Evaluate(tags, case_sensitive);
+    }
+    pc = result ? instruction.on_true : instruction.on_false;
+  }
+  return pc == kAccept;
+}
+
+}  // namespace valkey_search::query
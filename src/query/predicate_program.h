@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#ifndef VALKEYSEARCH_SRC_QUERY_PREDICATE_PROGRAM_H_
+#define VALKEYSEARCH_SRC_QUERY_PREDICATE_PROGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "src/indexes/numeric.h"
+#include "src/indexes/tag.h"
+#include "src/query/predicate.h"
+#include "src/utils/string_interning.h"
+
+namespace valkey_search::query {
+
+// A predicate tree compiled into a flat program of index lookups. Every
+// instruction evaluates one numeric or tag clause against its pre-resolved
+// index and jumps to the next instruction according to the outcome, so
+// negations and AND/OR short-circuiting cost nothing at evaluation time.
+// Operands of AND/OR chains are ordered by their estimated selectivity and
+// cost, taken from the index statistics when the program is compiled.
+//
+// The program refers to the predicates and indexes of the tree it was compiled
+// from, which must outlive it. Compilation and evaluation must happen while
+// the indexes are not mutated, i.e. under the index schema's reader lock.
+class PredicateProgram {
+ public:
+  explicit PredicateProgram(const Predicate& predicate);
+
+  bool Evaluate(const InternedStringPtr& key) const;
+  size_t Size() const { return instructions_.size(); }
+
+ private:
+  struct Term;
+  struct Instruction {
+    const NumericPredicate* numeric_predicate{nullptr};
+    const indexes::Numeric* numeric_index{nullptr};
+    const TagPredicate* tag_predicate{nullptr};
+    const indexes::Tag* tag_index{nullptr};
+    uint32_t on_true;
+    uint32_t on_false;
+  };
+  static constexpr uint32_t kAccept = UINT32_MAX - 1;
+  static constexpr uint32_t kReject = UINT32_MAX;
+
+  static Term Build(const Predicate& predicate, bool negate);
+  uint32_t Emit(const Term& term, uint32_t on_true, uint32_t on_false);
+
+  std::vector<Instruction> instructions_;
+  uint32_t entry_{kReject};
+};
+
+}  // namespace valkey_search::query
+
+#endif  // VALKEYSEARCH_SRC_QUERY_PREDICATE_PROGRAM_H_
@@ -8,6 +8,7 @@
 #include "src/query/response_generator.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <deque>
 #include <optional>
 #include <string>
@@ -18,7 +19,10 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "src/attribute_data_type.h"
+#include "src/index_schema.h"
 #include "src/indexes/tag.h"
 #include "src/indexes/vector_base.h"
 #include "src/metrics.h"
@@ -27,7 +31,9 @@
 #include "vmsdk/src/managed_pointers.h"
 #include "vmsdk/src/module_config.h"
 #include "vmsdk/src/status/status_macros.h"
+#include "vmsdk/src/thread_pool.h"
 #include "vmsdk/src/type_conversions.h"
+#include "vmsdk/src/utils.h"
 #include "vmsdk/src/valkey_module_api/valkey_module.h"
 
 namespace valkey_search::options {
@@ -65,12 +71,29 @@ static auto max_search_result_fields_count =
                                             kMaxSearchResultFieldsCountConfig))
         .Build();
 
+/// Register the "--content-fetch-batch-size" flag. When set, query results
+/// fetch their content on a reader thread, which holds the GIL for up to this
+/// many keys at a time. The main thread then only writes the reply
+constexpr absl::string_view kContentFetchBatchSizeConfig{
+    "content-fetch-batch-size"};
+constexpr int kMaxContentFetchBatchSize{10000};
+static auto content_fetch_batch_size =
+    vmsdk::config::NumberBuilder(
+        kContentFetchBatchSizeConfig,  // name
+        0,                             // default (fetch on the main thread)
+        0,                             // min size
+        kMaxContentFetchBatchSize)     // max size
+        .Build();
+
 vmsdk::config::Number &GetMaxSearchResultRecordSize() {
   return dynamic_cast<vmsdk::config::Number &>(*max_search_result_record_size);
 }
 vmsdk::config::Number &GetMaxSearchResultFieldsCount() {
   return dynamic_cast<vmsdk::config::Number &>(*max_search_result_fields_count);
 }
+vmsdk::config::Number &GetContentFetchBatchSize() {
+  return dynamic_cast<vmsdk::config::Number &>(*content_fetch_batch_size);
+}
 
 }  // namespace valkey_search::options
 
@@ -124,12 +147,14 @@ bool VerifyFilter(const query::Predicate *predicate,
 absl::StatusOr<RecordsMap> GetContentNoReturnJson(
     ValkeyModuleCtx *ctx, const AttributeDataType &attribute_data_type,
     const query::SearchParameters &parameters, absl::string_view key,
-    const std::string &vector_identifier) {
+    const std::string &vector_identifier, bool verify_filter) {
   absl::flat_hash_set<absl::string_view> identifiers;
   identifiers.insert(kJsonRootElementQuery);
-  for (const auto &filter_identifier :
-       parameters.filter_parse_results.filter_identifiers) {
-    identifiers.insert(filter_identifier);
+  if (verify_filter) {
+    for (const auto &filter_identifier :
+         parameters.filter_parse_results.filter_identifiers) {
+      identifiers.insert(filter_identifier);
+    }
   }
   auto key_str = vmsdk::MakeUniqueValkeyString(key);
   auto key_obj = vmsdk::MakeUniqueValkeyOpenKey(
@@ -137,7 +162,7 @@ absl::StatusOr<RecordsMap> GetContentNoReturnJson(
   VMSDK_ASSIGN_OR_RETURN(auto content, attribute_data_type.FetchAllRecords(
                                            ctx, vector_identifier,
                                            key_obj.get(), key, identifiers));
-  if (parameters.filter_parse_results.filter_identifiers.empty()) {
+  if (!verify_filter) {
     return content;
   }
   if (!VerifyFilter(parameters.filter_parse_results.root_predicate.get(),
@@ -158,18 +183,18 @@ absl::StatusOr<RecordsMap> GetContentNoReturnJson(
 absl::StatusOr<RecordsMap> GetContent(
     ValkeyModuleCtx *ctx, const AttributeDataType &attribute_data_type,
     const query::SearchParameters &parameters, absl::string_view key,
-    const std::string &vector_identifier) {
+    const std::string &vector_identifier, bool verify_filter) {
   if (attribute_data_type.ToProto() ==
           data_model::AttributeDataType::ATTRIBUTE_DATA_TYPE_JSON &&
       parameters.return_attributes.empty()) {
     return GetContentNoReturnJson(ctx, attribute_data_type, parameters, key,
-                                  vector_identifier);
+                                  vector_identifier, verify_filter);
   }
   absl::flat_hash_set<absl::string_view> identifiers;
   for (const auto &return_attribute : parameters.return_attributes) {
     identifiers.insert(vmsdk::ToStringView(return_attribute.identifier.get()));
   }
-  if (!parameters.return_attributes.empty()) {
+  if (!parameters.return_attributes.empty() && verify_filter) {
     for (const auto &filter_identifier :
          parameters.filter_parse_results.filter_identifiers) {
       identifiers.insert(filter_identifier);
@@ -181,7 +206,7 @@ absl::StatusOr<RecordsMap> GetContent(
   VMSDK_ASSIGN_OR_RETURN(auto content, attribute_data_type.FetchAllRecords(
                                            ctx, vector_identifier,
                                            key_obj.get(), key, identifiers));
-  if (parameters.filter_parse_results.filter_identifiers.empty()) {
+  if (!verify_filter) {
     return content;
   }
   if (!VerifyFilter(parameters.filter_parse_results.root_predicate.get(),
@@ -207,6 +232,17 @@ absl::StatusOr<RecordsMap> GetContent(
   return return_content;
 }
 
+// Takes the GIL off the main thread. The main thread holds it while it
+// suspends the reader pool at fork, waiting on the running tasks, so rather
+// than block on it, a reader counts as suspended until the pool resumes.
+static void LockOffMainThread(ValkeyModuleCtx *ctx) {
+  while (ValkeyModule_ThreadSafeContextTryLock(ctx) != VALKEYMODULE_OK) {
+    if (!vmsdk::ThreadPool::YieldToSuspension()) {
+      absl::SleepFor(absl::Microseconds(50));
+    }
+  }
+}
+
 // Adds all local content for neighbors to the list of neighbors.
 // This function is meant to be used for non-vector queries.
 void ProcessNonVectorNeighborsForReply(
@@ -229,14 +265,34 @@ void ProcessNeighborsForReply(ValkeyModuleCtx *ctx,
       options::GetMaxSearchResultRecordSize().GetValue();
   const auto max_content_fields =
       options::GetMaxSearchResultFieldsCount().GetValue();
+  // Off the main thread, the GIL is released between batches so that the
+  // main thread is never held up for long.
+  const bool locks = !vmsdk::IsMainThread();
+  const size_t batch_size = std::max<size_t>(
+      1, options::GetContentFetchBatchSize().GetValue());
+  size_t fetched = 0;
   for (auto &neighbor : neighbors) {
     // neighbors which were added from remote nodes already have attribute
     // content
     if (neighbor.attribute_contents.has_value()) {
       continue;
     }
+    if (locks && fetched % batch_size == 0) {
+      if (fetched > 0) {
+        ValkeyModule_ThreadSafeContextUnlock(ctx);
+      }
+      LockOffMainThread(ctx);
+    }
+    ++fetched;
+    // The filter is only verified again for the keys which may have changed
+    // since the search.
+    bool verify_filter =
+        !parameters.filter_parse_results.filter_identifiers.empty() &&
+        (!parameters.mutation_sequence.has_value() ||
+         parameters.index_schema->MutatedSince(
+             neighbor.external_id, parameters.mutation_sequence.value()));
     auto content = GetContent(ctx, attribute_data_type, parameters,
-                              *neighbor.external_id, identifier);
+                              *neighbor.external_id, identifier, verify_filter);
     if (!content.ok()) {
       continue;
     }
@@ -272,6 +328,9 @@ void ProcessNeighborsForReply(ValkeyModuleCtx *ctx,
       neighbor.attribute_contents = std::move(content.value());
     }
   }
+  if (locks && fetched > 0) {
+    ValkeyModule_ThreadSafeContextUnlock(ctx);
+  }
   // Remove all entries that don't have content now.
   // TODO: incorporate a retry in case of removal.
   neighbors.erase(
@@ -28,6 +28,11 @@ vmsdk::config::Number &GetMaxSearchResultRecordSize();
 /// maximum number of fields in the content of the search response
 vmsdk::config::Number &GetMaxSearchResultFieldsCount();
 
+/// Return the configuration entry that allows the caller to control the number
+/// of keys whose content is fetched per GIL acquisition off the main thread.
+/// When 0, the content of query results is fetched on the main thread
+vmsdk::config::Number &GetContentFetchBatchSize();
+
 }  // namespace valkey_search::options
 namespace valkey_search::query {
 
@@ -36,6 +41,8 @@ namespace valkey_search::query {
 // Neighbor already contained in the attribute content map.
 // Neighbor without any attribute content.
 // Neighbor not comply to the pre-filter expression.
+// Off the main thread, ctx must be a thread safe context, and the keyspace is
+// read under the GIL in batches of content-fetch-batch-size keys.
 void ProcessNeighborsForReply(ValkeyModuleCtx *ctx,
                               const AttributeDataType &attribute_data_type,
                               std::deque<indexes::Neighbor> &neighbors,
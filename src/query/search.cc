@@ -7,8 +7,10 @@
 
 #include "src/query/search.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <deque>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <queue>
@@ -17,6 +19,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -32,6 +35,8 @@
 #include "src/metrics.h"
 #include "src/query/planner.h"
 #include "src/query/predicate.h"
+#include "src/query/predicate_program.h"
+#include "src/stored_field.h"
 #include "third_party/hnswlib/hnswlib.h"
 #include "vmsdk/src/latency_sampler.h"
 #include "vmsdk/src/log.h"
@@ -48,7 +53,7 @@ class InlineVectorFilter : public hnswlib::BaseFilterFunctor {
  public:
   InlineVectorFilter(query::Predicate *filter_predicate,
                      indexes::VectorBase *vector_index)
-      : filter_predicate_(filter_predicate), vector_index_(vector_index) {}
+      : filter_program_(*filter_predicate), vector_index_(vector_index) {}
   ~InlineVectorFilter() override = default;
 
   bool operator()(hnswlib::labeltype id) override {
@@ -56,12 +61,11 @@ class InlineVectorFilter : public hnswlib::BaseFilterFunctor {
     if (!key.ok()) {
       return false;
     }
-    indexes::PrefilterEvaluator evaluator;
-    return evaluator.Evaluate(*filter_predicate_, *key);
+    return filter_program_.Evaluate(*key);
   }
 
  private:
-  query::Predicate *filter_predicate_;
+  PredicateProgram filter_program_;
   indexes::VectorBase *vector_index_;
 };
 absl::StatusOr<std::deque<indexes::Neighbor>> PerformVectorSearch(
@@ -180,33 +184,201 @@ struct PrefilteredKey {
   float distance;
 };
 
+using PrefilteredKeyAppender =
+    absl::AnyInvocable<void(const InternedStringPtr &)>;
+
+struct ConjunctionClause {
+  const Predicate *predicate;
+  bool negate;
+  std::unique_ptr<indexes::EntriesFetcherBase> fetcher;
+};
+
+// Flattens `predicate` into the index clauses of a conjunction, pushing
+// negations down to the clauses. Returns false if the predicate contains a
+// disjunction.
+bool CollectConjunctionClauses(const Predicate *predicate, bool negate,
+                               std::vector<ConjunctionClause> &clauses) {
+  if (predicate->GetType() == PredicateType::kComposedAnd ||
+      predicate->GetType() == PredicateType::kComposedOr) {
+    if (EvaluateAsComposedPredicate(predicate, negate) !=
+        PredicateType::kComposedAnd) {
+      return false;
+    }
+    auto composed_predicate =
+        dynamic_cast<const ComposedPredicate *>(predicate);
+    return CollectConjunctionClauses(composed_predicate->GetLhsPredicate(),
+                                     negate, clauses) &&
+           CollectConjunctionClauses(composed_predicate->GetRhsPredicate(),
+                                     negate, clauses);
+  }
+  if (predicate->GetType() == PredicateType::kTag) {
+    auto tag_predicate = dynamic_cast<const TagPredicate *>(predicate);
+    clauses.push_back(ConjunctionClause{
+        predicate, negate,
+        tag_predicate->GetIndex()->Search(*tag_predicate, negate)});
+    return true;
+  }
+  if (predicate->GetType() == PredicateType::kNumeric) {
+    auto numeric_predicate = dynamic_cast<const NumericPredicate *>(predicate);
+    clauses.push_back(ConjunctionClause{
+        predicate, negate,
+        numeric_predicate->GetIndex()->Search(*numeric_predicate, negate)});
+    return true;
+  }
+  if (predicate->GetType() == PredicateType::kNegate) {
+    auto negate_predicate = dynamic_cast<const NegatePredicate *>(predicate);
+    return CollectConjunctionClauses(negate_predicate->GetPredicate(), !negate,
+                                     clauses);
+  }
+  return false;
+}
+
+void LeapfrogJoin(
+    std::vector<std::unique_ptr<indexes::SortedEntriesIterator>> &iterators,
+    absl::FunctionRef<bool(const InternedStringPtr &)> on_match) {
+  for (const auto &iterator : iterators) {
+    if (iterator->Done()) {
+      return;
+    }
+  }
+  InternedStringPtrLess less;
+  std::sort(iterators.begin(), iterators.end(),
+            [&less](const auto &lhs, const auto &rhs) {
+              return less(**lhs, **rhs);
+            });
+  // Iterators are visited round robin, the current one always holds the
+  // smallest key and its predecessor the largest.
+  const InternedStringPtr *max_key = &**iterators.back();
+  size_t current = 0;
+  while (true) {
+    auto &iterator = *iterators[current];
+    if (*iterator == *max_key) {
+      if (!on_match(*iterator)) {
+        return;
+      }
+      iterator.Next();
+    } else {
+      iterator.SkipTo(*max_key);
+    }
+    if (iterator.Done()) {
+      return;
+    }
+    max_key = &*iterator;
+    current = (current + 1) % iterators.size();
+  }
+}
+
+// Evaluates a conjunctive filter by intersecting the posting lists of its
+// clauses in key order, seeking over the keys which can't match, so the work
+// isn't a full predicate evaluation per candidate. Clauses made of too many
+// posting lists to join are verified for each joined key. Returns false,
+// without appending anything, when the most selective clause and at least one
+// other can't be joined.
+bool EvaluateConjunction(const SearchParameters &parameters,
+                         PrefilteredKeyAppender &appender) {
+  auto predicate = parameters.filter_parse_results.root_predicate.get();
+  if (predicate == nullptr ||
+      (predicate->GetType() != PredicateType::kComposedAnd &&
+       predicate->GetType() != PredicateType::kNegate)) {
+    return false;
+  }
+  std::vector<ConjunctionClause> clauses;
+  if (!CollectConjunctionClauses(predicate, false, clauses) ||
+      clauses.size() < 2) {
+    return false;
+  }
+  std::stable_sort(clauses.begin(), clauses.end(),
+                   [](const auto &lhs, const auto &rhs) {
+                     return lhs.fetcher->Size() < rhs.fetcher->Size();
+                   });
+  const size_t max_lists =
+      MaxLeapfrogJoinPostingLists(clauses.front().fetcher->Size());
+  std::vector<std::unique_ptr<indexes::SortedEntriesIterator>> iterators;
+  std::vector<const ConjunctionClause *> verified_clauses;
+  for (const auto &clause : clauses) {
+    std::vector<const indexes::PostingList *> lists;
+    if (clause.fetcher->AppendPostingLists(max_lists, lists)) {
+      iterators.push_back(
+          std::make_unique<indexes::SortedEntriesIterator>(std::move(lists)));
+    } else if (&clause == &clauses.front()) {
+      return false;
+    } else {
+      verified_clauses.push_back(&clause);
+    }
+  }
+  if (iterators.size() < 2) {
+    return false;
+  }
+  indexes::PrefilterEvaluator evaluator;
+  LeapfrogJoin(iterators, [&](const InternedStringPtr &key) {
+    bool matches = std::all_of(
+        verified_clauses.begin(), verified_clauses.end(),
+        [&evaluator, &key](const ConjunctionClause *clause) {
+          return evaluator.Evaluate(*clause->predicate, key) != clause->negate;
+        });
+    if (matches) {
+      appender(key);
+    }
+    return !parameters.cancellation_token->IsCancelled();
+  });
+  return true;
+}
+
+// Evaluates the keys of a single fetcher in index order, so that the results
+// are stable across runs. Only fetchers which may yield a key more than once,
+// negated tag searches, have their repeats skipped through a visited set.
+void EvaluateFetcherKeys(const SearchParameters &parameters,
+                         indexes::EntriesFetcherBase &fetcher,
+                         PrefilteredKeyAppender &appender) {
+  PredicateProgram program(*parameters.filter_parse_results.root_predicate);
+  const bool may_repeat = fetcher.MayRepeatKeys();
+  absl::flat_hash_set<const InternedString *> visited;
+  for (auto itr = fetcher.Begin(); !itr->Done(); itr->Next()) {
+    const auto &key = **itr;
+    if ((!may_repeat || visited.insert(key.get()).second) &&
+        program.Evaluate(key)) {
+      appender(key);
+    }
+    if (parameters.cancellation_token->IsCancelled()) {
+      return;
+    }
+  }
+}
+
+// Evaluates the distinct keys of all fetchers. A single fetcher is streamed in
+// index order. The posting lists of several fetchers (OR branches), which may
+// overlap, are merged in key order so that a key reachable through several of
+// them is evaluated once, without tracking visited keys in a hash set.
+// Fetchers whose keys aren't held in posting lists are copied into one.
 void EvaluatePrefilteredKeys(
     const SearchParameters &parameters,
     std::queue<std::unique_ptr<indexes::EntriesFetcherBase>> &entries_fetchers,
-    absl::AnyInvocable<bool(const InternedStringPtr &,
-                            absl::flat_hash_set<const char *> &)>
-        appender) {
-  absl::flat_hash_set<const char *> result_keys;
-  auto predicate = parameters.filter_parse_results.root_predicate.get();
-  indexes::PrefilterEvaluator evaluator;
+    PrefilteredKeyAppender appender) {
+  if (entries_fetchers.size() == 1) {
+    EvaluateFetcherKeys(parameters, *entries_fetchers.front(), appender);
+    entries_fetchers.pop();
+    return;
+  }
+  std::vector<const indexes::PostingList *> lists;
+  std::vector<std::unique_ptr<indexes::PostingList>> owned_lists;
   while (!entries_fetchers.empty()) {
-    auto fetcher = std::move(entries_fetchers.front());
+    auto &fetcher = *entries_fetchers.front();
+    if (!fetcher.AppendPostingLists(std::numeric_limits<size_t>::max(),
+                                    lists)) {
+      owned_lists.push_back(fetcher.CopyKeys());
+      lists.push_back(owned_lists.back().get());
+    }
     entries_fetchers.pop();
-    auto iterator = fetcher->Begin();
-    while (!iterator->Done()) {
-      const auto &key = **iterator;
-      // TODO: add a bloom filter to ensure distinct keys are evaluated
-      // only once.
-      if (!result_keys.contains(key->Str().data()) &&
-          evaluator.Evaluate(*predicate, key)) {
-        if (appender(key, result_keys)) {
-          result_keys.insert(key->Str().data());
-        }
-      }
-      iterator->Next();
-      if (parameters.cancellation_token->IsCancelled()) {
-        return;
-      }
+  }
+  PredicateProgram program(*parameters.filter_parse_results.root_predicate);
+  for (indexes::SortedEntriesIterator itr(std::move(lists),
+                                          std::move(owned_lists));
+       !itr.Done(); itr.Next()) {
+    if (program.Evaluate(*itr)) {
+      appender(*itr);
+    }
+    if (parameters.cancellation_token->IsCancelled()) {
+      return;
     }
   }
 }
@@ -217,13 +389,14 @@ CalcBestMatchingPrefilteredKeys(
     std::queue<std::unique_ptr<indexes::EntriesFetcherBase>> &entries_fetchers,
     indexes::VectorBase *vector_index) {
   std::priority_queue<std::pair<float, hnswlib::labeltype>> results;
-  auto results_appender =
-      [&results, &parameters, vector_index](
-          const InternedStringPtr &key,
-          absl::flat_hash_set<const char *> &top_keys) -> bool {
-    return vector_index->AddPrefilteredKey(parameters.query, parameters.k, key,
-                                           results, top_keys);
-  };
+  PrefilteredKeyAppender results_appender =
+      [&results, &parameters, vector_index](const InternedStringPtr &key) {
+        vector_index->AddPrefilteredKey(parameters.query, parameters.k, key,
+                                        results);
+      };
+  if (EvaluateConjunction(parameters, results_appender)) {
+    return results;
+  }
   EvaluatePrefilteredKeys(parameters, entries_fetchers,
                           std::move(results_appender));
   return results;
@@ -250,12 +423,14 @@ absl::StatusOr<std::deque<indexes::Neighbor>> MaybeAddIndexedContent(
   if (!results.ok()) {
     return results;
   }
-  if (parameters.no_content || parameters.return_attributes.empty()) {
+  if (parameters.no_content || parameters.reads_indexed_content ||
+      parameters.return_attributes.empty()) {
     return results;
   }
   struct AttributeInfo {
     const ReturnAttribute *attribute;
     indexes::IndexBase *index;
+    const StoredField *stored_field;
   };
   std::vector<AttributeInfo> attributes;
   for (auto &attribute : parameters.return_attributes) {
@@ -269,7 +444,10 @@ absl::StatusOr<std::deque<indexes::Neighbor>> MaybeAddIndexedContent(
     if (!index.ok()) {
       return results;
     }
-    attributes.push_back(AttributeInfo{&attribute, index.value().get()});
+    auto alias = vmsdk::ToStringView(attribute.attribute_alias.get());
+    attributes.push_back(
+        AttributeInfo{&attribute, index.value().get(),
+                      parameters.index_schema->GetStoredField(alias)});
   }
   for (auto &neighbor : *results) {
     if (neighbor.attribute_contents.has_value()) {
@@ -279,52 +457,60 @@ absl::StatusOr<std::deque<indexes::Neighbor>> MaybeAddIndexedContent(
     bool any_value_missing = false;
     for (auto &attribute_info : attributes) {
       vmsdk::UniqueValkeyString attribute_value = nullptr;
-      switch (attribute_info.index->GetIndexerType()) {
-        case indexes::IndexerType::kTag: {
-          auto tag_index = dynamic_cast<indexes::Tag *>(attribute_info.index);
-          auto tag_value_ptr = tag_index->GetRawValue(neighbor.external_id);
-          if (tag_value_ptr != nullptr) {
-            attribute_value = vmsdk::MakeUniqueValkeyString(*tag_value_ptr);
-          }
-          break;
+      // SORTABLE attributes return the value as written, numbers included.
+      if (attribute_info.stored_field != nullptr) {
+        auto value = attribute_info.stored_field->Get(neighbor.external_id);
+        if (value != nullptr) {
+          attribute_value = vmsdk::MakeUniqueValkeyString(*value);
         }
-        case indexes::IndexerType::kNumeric: {
-          auto numeric_index =
-              dynamic_cast<indexes::Numeric *>(attribute_info.index);
-          auto numeric = numeric_index->GetValue(neighbor.external_id);
-          if (numeric != nullptr) {
-            attribute_value =
-                vmsdk::MakeUniqueValkeyString(absl::StrCat(*numeric));
+      } else {
+        switch (attribute_info.index->GetIndexerType()) {
+          case indexes::IndexerType::kTag: {
+            auto tag_index = dynamic_cast<indexes::Tag *>(attribute_info.index);
+            auto tag_value_ptr = tag_index->GetRawValue(neighbor.external_id);
+            if (tag_value_ptr != nullptr) {
+              attribute_value = vmsdk::MakeUniqueValkeyString(*tag_value_ptr);
+            }
+            break;
           }
-          break;
-        }
-        case indexes::IndexerType::kVector:
-        case indexes::IndexerType::kHNSW:
-        case indexes::IndexerType::kFlat: {
-          auto vector_index =
-              dynamic_cast<indexes::VectorBase *>(attribute_info.index);
-          auto vector = vector_index->GetValue(neighbor.external_id);
-          if (vector.ok()) {
-            if (parameters.index_schema->GetAttributeDataType().ToProto() ==
-                data_model::AttributeDataType::ATTRIBUTE_DATA_TYPE_JSON) {
-              attribute_value = vmsdk::MakeUniqueValkeyString(
-                  StringFormatVector(vector.value()));
-            } else {
+          case indexes::IndexerType::kNumeric: {
+            auto numeric_index =
+                dynamic_cast<indexes::Numeric *>(attribute_info.index);
+            auto numeric = numeric_index->GetValue(neighbor.external_id);
+            if (numeric != nullptr) {
               attribute_value =
-                  vmsdk::UniqueValkeyString(ValkeyModule_CreateString(
-                      nullptr, vector->data(), vector->size()));
+                  vmsdk::MakeUniqueValkeyString(absl::StrCat(*numeric));
             }
-          } else {
-            VMSDK_LOG_EVERY_N_SEC(WARNING, nullptr, 1)
-                << "Failed to get vector value during fetching through index "
-                   "contents: "
-                << vector.status();
+            break;
           }
-          break;
+          case indexes::IndexerType::kVector:
+          case indexes::IndexerType::kHNSW:
+          case indexes::IndexerType::kFlat: {
+            auto vector_index =
+                dynamic_cast<indexes::VectorBase *>(attribute_info.index);
+            auto vector = vector_index->GetValue(neighbor.external_id);
+            if (vector.ok()) {
+              if (parameters.index_schema->GetAttributeDataType().ToProto() ==
+                  data_model::AttributeDataType::ATTRIBUTE_DATA_TYPE_JSON) {
+                attribute_value = vmsdk::MakeUniqueValkeyString(
+                    StringFormatVector(vector.value()));
+              } else {
+                attribute_value =
+                    vmsdk::UniqueValkeyString(ValkeyModule_CreateString(
+                        nullptr, vector->data(), vector->size()));
+              }
+            } else {
+              VMSDK_LOG_EVERY_N_SEC(WARNING, nullptr, 1)
+                  << "Failed to get vector value during fetching through index "
+                     "contents: "
+                  << vector.status();
+            }
+            break;
+          }
+          default:
+            CHECK(false) << "Unsupported indexer type: "
+                         << (int)attribute_info.index->GetIndexerType();
         }
-        default:
-          CHECK(false) << "Unsupported indexer type: "
-                       << (int)attribute_info.index->GetIndexerType();
       }
 
       if (attribute_value != nullptr) {
@@ -349,24 +535,141 @@ absl::StatusOr<std::deque<indexes::Neighbor>> MaybeAddIndexedContent(
   return results;
 }
 
+// Whether the filter is a single tag or numeric predicate. Only then is the
+// one fetcher EvaluateFilterAsPrimary returns made of exactly the matches: for
+// composed filters it may cover just one side of them.
+bool IsSingleLeafFilter(const Predicate *predicate) {
+  return predicate != nullptr &&
+         (predicate->GetType() == PredicateType::kTag ||
+          predicate->GetType() == PredicateType::kNumeric);
+}
+
+// Collects up to `max_neighbors` matches of a filter served by a single
+// fetcher whose size is exact, so the total count is known up front and the
+// enumeration can stop as soon as enough neighbors are collected.
+void StreamExactFetcher(const SearchParameters &parameters,
+                        indexes::EntriesFetcherBase &fetcher,
+                        size_t max_neighbors,
+                        std::deque<indexes::Neighbor> &neighbors) {
+  PredicateProgram program(*parameters.filter_parse_results.root_predicate);
+  for (auto itr = fetcher.Begin();
+       !itr->Done() && neighbors.size() < max_neighbors; itr->Next()) {
+    if (program.Evaluate(**itr)) {
+      neighbors.push_back(indexes::Neighbor{**itr, 0.0f});
+    }
+    if (parameters.cancellation_token->IsCancelled()) {
+      return;
+    }
+  }
+}
+
+// Answers the match count of a filter from index statistics alone. This is
+// exact when the filter is a single clause whose fetcher size is exact, or a
+// conjunction of clauses over one numeric attribute: the intersection of
+// their ranges, or the complement of a single negated range.
+std::optional<size_t> CountFromIndexStatistics(const Predicate *predicate) {
+  std::vector<ConjunctionClause> clauses;
+  if (!CollectConjunctionClauses(predicate, false, clauses)) {
+    return std::nullopt;
+  }
+  if (clauses.size() == 1 && clauses.front().fetcher->IsSizeExact()) {
+    return clauses.front().fetcher->Size();
+  }
+  const indexes::Numeric *numeric_index = nullptr;
+  for (const auto &clause : clauses) {
+    if (clause.predicate->GetType() != PredicateType::kNumeric) {
+      return std::nullopt;
+    }
+    auto index =
+        dynamic_cast<const NumericPredicate *>(clause.predicate)->GetIndex();
+    if (numeric_index != nullptr && numeric_index != index) {
+      return std::nullopt;
+    }
+    numeric_index = index;
+  }
+  if (clauses.size() == 1) {
+    // Tracked keys outside the range plus the keys without a numeric value.
+    auto numeric_predicate =
+        dynamic_cast<const NumericPredicate *>(clauses.front().predicate);
+    return numeric_index->GetTrackedKeyCount() -
+           numeric_index->GetCount(numeric_predicate->GetStart(),
+                                   numeric_predicate->GetEnd(),
+                                   numeric_predicate->IsStartInclusive(),
+                                   numeric_predicate->IsEndInclusive()) +
+           numeric_index->GetUnTrackedKeyCount();
+  }
+  double start = std::numeric_limits<double>::lowest();
+  double end = std::numeric_limits<double>::max();
+  bool start_inclusive = true;
+  bool end_inclusive = true;
+  for (const auto &clause : clauses) {
+    if (clause.negate) {
+      return std::nullopt;
+    }
+    auto numeric_predicate =
+        dynamic_cast<const NumericPredicate *>(clause.predicate);
+    if (numeric_predicate->GetStart() > start) {
+      start = numeric_predicate->GetStart();
+      start_inclusive = numeric_predicate->IsStartInclusive();
+    } else if (numeric_predicate->GetStart() == start) {
+      start_inclusive &= numeric_predicate->IsStartInclusive();
+    }
+    if (numeric_predicate->GetEnd() < end) {
+      end = numeric_predicate->GetEnd();
+      end_inclusive = numeric_predicate->IsEndInclusive();
+    } else if (numeric_predicate->GetEnd() == end) {
+      end_inclusive &= numeric_predicate->IsEndInclusive();
+    }
+  }
+  return numeric_index->GetCount(start, end, start_inclusive, end_inclusive);
+}
+
 absl::StatusOr<std::deque<indexes::Neighbor>> SearchNonVectorQuery(
     const SearchParameters &parameters) {
-  std::queue<std::unique_ptr<indexes::EntriesFetcherBase>> entries_fetchers;
-  size_t qualified_entries = EvaluateFilterAsPrimary(
-      parameters.filter_parse_results.root_predicate.get(), entries_fetchers,
-      false);
   std::deque<indexes::Neighbor> neighbors;
-  auto results_appender =
-      [&neighbors, &parameters](
-          const InternedStringPtr &key,
-          absl::flat_hash_set<const char *> &top_keys) -> bool {
-    neighbors.push_back(indexes::Neighbor{key, 0.0f});
-    return true;
-  };
+  if (parameters.IsNonVectorCountOnly()) {
+    auto count = CountFromIndexStatistics(
+        parameters.filter_parse_results.root_predicate.get());
+    if (count.has_value()) {
+      ++Metrics::GetStats().query_count_only_requests_cnt;
+      parameters.total_count = count;
+      return neighbors;
+    }
+  }
+  const size_t max_neighbors = parameters.MaxNonVectorNeighbors();
+  size_t total_count = 0;
+  PrefilteredKeyAppender results_appender =
+      [&neighbors, &total_count, max_neighbors](const InternedStringPtr &key) {
+        ++total_count;
+        if (neighbors.size() < max_neighbors) {
+          neighbors.push_back(indexes::Neighbor{key, 0.0f});
+        }
+      };
+  if (EvaluateConjunction(parameters, results_appender)) {
+    if (parameters.limit_non_vector_neighbors) {
+      parameters.total_count = total_count;
+    }
+    return neighbors;
+  }
 
+  std::queue<std::unique_ptr<indexes::EntriesFetcherBase>> entries_fetchers;
+  EvaluateFilterAsPrimary(parameters.filter_parse_results.root_predicate.get(),
+                          entries_fetchers, false);
+  if (parameters.limit_non_vector_neighbors &&
+      IsSingleLeafFilter(
+          parameters.filter_parse_results.root_predicate.get()) &&
+      entries_fetchers.size() == 1 && entries_fetchers.front()->IsSizeExact()) {
+    ++Metrics::GetStats().query_streamed_requests_cnt;
+    parameters.total_count = entries_fetchers.front()->Size();
+    StreamExactFetcher(parameters, *entries_fetchers.front(), max_neighbors,
+                       neighbors);
+    return neighbors;
+  }
   EvaluatePrefilteredKeys(parameters, entries_fetchers,
                           std::move(results_appender));
-
+  if (parameters.limit_non_vector_neighbors) {
+    parameters.total_count = total_count;
+  }
   return neighbors;
 }
 
@@ -385,6 +688,8 @@ absl::StatusOr<std::deque<indexes::Neighbor>> DoSearch(
   auto &time_sliced_mutex = parameters.index_schema->GetTimeSlicedMutex();
   vmsdk::ReaderMutexLock lock(&time_sliced_mutex);
   ++Metrics::GetStats().time_slice_queries;
+  parameters.mutation_sequence =
+      parameters.index_schema->GetMutationSequence();
   // Handle non vector queries first where attribute_alias is empty.
   if (parameters.IsNonVectorQuery()) {
     return SearchNonVectorQuery(parameters);
@@ -11,6 +11,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <queue>
@@ -87,6 +88,19 @@ struct SearchParameters {
   LimitParameter limit;
   uint64_t timeout_ms;
   bool no_content{false};
+  // Set by commands which read the indexed values of the return attributes
+  // themselves once the search is done, so the search doesn't render them.
+  bool reads_indexed_content{false};
+  // Set when the reply only serializes the first `limit.first_index +
+  // limit.number` matches of a non-vector query, so the search may stop
+  // collecting neighbors beyond them.
+  bool limit_non_vector_neighbors{false};
+  // The number of matches of a non-vector query searched with
+  // limit_non_vector_neighbors, which may exceed the neighbors returned.
+  mutable std::optional<size_t> total_count;
+  // The index schema's mutation sequence when the search read the indexes.
+  // Results whose keys weren't mutated since still match the filter.
+  mutable std::optional<uint64_t> mutation_sequence;
   FilterParseResults filter_parse_results;
   std::vector<ReturnAttribute> return_attributes;
   coordinator::IndexFingerprintVersion index_fingerprint_version;
@@ -118,6 +132,21 @@ struct SearchParameters {
     }
   } parse_vars;
   bool IsNonVectorQuery() const { return attribute_alias.empty(); }
+  // Whether the reply of a non-vector query only carries the match count.
+  bool IsNonVectorCountOnly() const {
+    return limit_non_vector_neighbors && limit.number == 0;
+  }
+  size_t MaxNonVectorNeighbors() const {
+    if (!limit_non_vector_neighbors) {
+      return std::numeric_limits<size_t>::max();
+    }
+    if (IsNonVectorCountOnly()) {
+      return 0;
+    }
+    return limit.number > std::numeric_limits<size_t>::max() - limit.first_index
+               ? std::numeric_limits<size_t>::max()
+               : limit.first_index + limit.number;
+  }
   bool IsVectorQuery() const { return !IsNonVectorQuery(); }
   SearchParameters(uint64_t timeout, grpc::CallbackServerContext* context,
                    uint32_t db_num)
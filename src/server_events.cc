@@ -9,6 +9,8 @@
 
 #include <cstdint>
 
+#include "absl/time/time.h"
+#include "src/commands/ft_cursor.h"
 #include "src/coordinator/metadata_manager.h"
 #include "src/schema_manager.h"
 #include "src/valkey_search.h"
@@ -44,6 +46,9 @@ void OnServerCronCallback(ValkeyModuleCtx *ctx, ValkeyModuleEvent eid,
                           uint64_t subevent, void *data) {
   ValkeySearch::Instance().OnServerCronCallback(ctx, eid, subevent, data);
   SchemaManager::Instance().OnServerCronCallback(ctx, eid, subevent, data);
+  // Idle cursors would otherwise hold their memory until the next cursor
+  // command.
+  aggregate::CursorStore::Instance().ExpireIdle(absl::Now());
   if (coordinator::MetadataManager::IsInitialized()) {
     coordinator::MetadataManager::Instance().OnServerCronCallback(
         ctx, eid, subevent, data);
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#include "src/stored_field.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "src/utils/string_interning.h"
+#include "vmsdk/src/memory_tracker.h"
+
+namespace valkey_search {
+
+MemoryPool StoredField::memory_pool_{0};
+
+int64_t StoredField::GetMemoryUsage() { return memory_pool_.GetUsage(); }
+
+StoredField::~StoredField() {
+  IsolatedMemoryScope scope{memory_pool_};
+  absl::MutexLock lock(&mutex_);
+  InternedStringMap<InternedStringPtr>().swap(values_);
+}
+
+void StoredField::Set(const InternedStringPtr &key, absl::string_view value) {
+  auto interned_value = StringInternStore::Intern(value);
+  IsolatedMemoryScope scope{memory_pool_};
+  absl::MutexLock lock(&mutex_);
+  values_.insert_or_assign(key, std::move(interned_value));
+}
+
+void StoredField::Erase(const InternedStringPtr &key) {
+  IsolatedMemoryScope scope{memory_pool_};
+  absl::MutexLock lock(&mutex_);
+  values_.erase(key);
+}
+
+}  // namespace valkey_search
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#ifndef VALKEYSEARCH_SRC_STORED_FIELD_H_
+#define VALKEYSEARCH_SRC_STORED_FIELD_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "src/utils/string_interning.h"
+#include "vmsdk/src/memory_tracker.h"
+
+namespace valkey_search {
+
+//
+// The raw values of a SORTABLE attribute, by key: a column of the index which
+// lets replies return the attribute without reading the keyspace. Values are
+// interned, so documents with the same value share it. Written by the writer
+// threads as they apply mutations, read by the reader threads.
+//
+// The values aren't saved in the RDB. Loading refills them through the same
+// mutations: the keys of the index extension are processed again, and without
+// the extension the backfill scans every key.
+//
+// The memory of the maps is charged to memory_pool_, the interned values stay
+// charged to the string intern store.
+//
+class StoredField {
+ public:
+  ~StoredField();
+  void Set(const InternedStringPtr &key, absl::string_view value);
+  void Erase(const InternedStringPtr &key);
+  // Null if no value is stored for the key.
+  InternedStringPtr Get(const InternedStringPtr &key) const {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto itr = values_.find(key);
+    return itr == values_.end() ? InternedStringPtr() : itr->second;
+  }
+  size_t Size() const {
+    absl::ReaderMutexLock lock(&mutex_);
+    return values_.size();
+  }
+  // The memory held by the stored fields of all the index schemas.
+  static int64_t GetMemoryUsage();
+
+ private:
+  static MemoryPool memory_pool_;
+  mutable absl::Mutex mutex_;
+  InternedStringMap<InternedStringPtr> values_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace valkey_search
+
+#endif  // VALKEYSEARCH_SRC_STORED_FIELD_H_
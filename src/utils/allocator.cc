@@ -8,6 +8,7 @@
 #include "src/utils/allocator.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <map>
@@ -17,6 +18,7 @@
 #include "absl/base/thread_annotations.h"
 #include "absl/log/check.h"
 #include "absl/synchronization/mutex.h"
+#include "vmsdk/src/huge_pages.h"
 
 namespace valkey_search {
 
@@ -32,7 +34,7 @@ class ChunkTracker {
     chunks_by_data_.insert(std::make_pair(chunk->data.get(), chunk));
   }
   const AllocatorChunk *FindChunk(char *ptr) const ABSL_LOCKS_EXCLUDED(mutex_) {
-    absl::MutexLock lock(&mutex_);
+    absl::ReaderMutexLock lock(&mutex_);
 
     auto it = chunks_by_data_.upper_bound(ptr);
     if (it != chunks_by_data_.begin()) {
@@ -70,15 +72,38 @@ size_t CalcChunkFreeGroup(size_t free_cnt) {
 
 int UpperBoundToMultipleOf8(int num) { return (num + 7) & ~7; }
 
+// Free buffers hold the link to the next one.
+size_t EntrySize(size_t size, bool require_ptr_alignment) {
+  if (require_ptr_alignment) {
+    size = UpperBoundToMultipleOf8(size);
+  }
+  return std::max(size, sizeof(char *));
+}
+
+// Threads are given magazines in turn, so the first kMagazineCount threads
+// don't share any.
+size_t ThreadMagazineIndex() {
+  static std::atomic<size_t> next_index{0};
+  thread_local size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed) % kMagazineCount;
+  return index;
+}
+
 // TODO: allow deletion of chunks when they are empty
-FixedSizeAllocator::FixedSizeAllocator(size_t size, bool require_ptr_alignment)
-    : size_(size), require_ptr_alignment_(require_ptr_alignment) {
-  if (require_ptr_alignment_) {
-    size_ = UpperBoundToMultipleOf8(size);
+FixedSizeAllocator::FixedSizeAllocator(size_t size, bool require_ptr_alignment,
+                                       size_t magazine_size)
+    : size_(EntrySize(size, require_ptr_alignment)),
+      require_ptr_alignment_(require_ptr_alignment),
+      magazine_size_(magazine_size) {
+  if (magazine_size_ > 0) {
+    magazines_ = std::make_unique<Magazine[]>(kMagazineCount);
   }
 }
 
 FixedSizeAllocator::~FixedSizeAllocator() {
+  if (magazines_) {
+    FlushMagazines();
+  }
   CHECK(fully_used_chunks_.Empty());
   for (auto &chunk_group : chunks_grouped_by_free_entries_) {
     CHECK(chunk_group.Empty());
@@ -95,30 +120,71 @@ size_t FixedSizeAllocator::ChunkCount() const {
 }
 
 char *FixedSizeAllocator::Allocate(size_t size) {
-  if (require_ptr_alignment_) {
-    size = UpperBoundToMultipleOf8(size);
-  }
-  CHECK_EQ(size, size_);
+  CHECK_EQ(EntrySize(size, require_ptr_alignment_), size_);
   return Allocate();
 }
 
 char *FixedSizeAllocator::Allocate() {
-  absl::MutexLock lock(&mutex_);
+  char *ptr;
+  if (!magazines_) {
+    absl::MutexLock lock(&mutex_);
+    ptr = AllocateFromChunks().second;
+  } else {
+    auto &magazine = GetMagazine();
+    absl::MutexLock magazine_lock(&magazine.mutex);
+    if (magazine.buffers.empty()) {
+      // Half a magazine, which leaves room for the frees which follow.
+      absl::MutexLock lock(&mutex_);
+      size_t count = std::max<size_t>(1, magazine_size_ / 2);
+      for (size_t i = 0; i < count; ++i) {
+        magazine.buffers.push_back(AllocateFromChunks());
+      }
+      // The first taken, from the fullest chunk, is handed out first.
+      std::reverse(magazine.buffers.begin(), magazine.buffers.end());
+    }
+    ptr = magazine.buffers.back().second;
+    magazine.buffers.pop_back();
+  }
+  ++active_allocations_;
+  IncrementRef();
+  return ptr;
+}
+
+FixedSizeAllocator::Buffer FixedSizeAllocator::AllocateFromChunks() {
   if (current_chunk_ == nullptr) {
     AllocateChunk();
   }
-  int old_free_group = CalcChunkFreeGroup(current_chunk_->free_list.size());
+  auto chunk = current_chunk_;
+  int old_free_group = CalcChunkFreeGroup(chunk->free_list.size());
   CHECK_GT(old_free_group, -1);
-  auto ptr = current_chunk_->free_list.top();
-  current_chunk_->free_list.pop();
-  ++active_allocations_;
+  auto ptr = chunk->free_list.top();
+  chunk->free_list.pop();
 
-  HandleChunkEntryUsageChange(current_chunk_, old_free_group);
+  HandleChunkEntryUsageChange(chunk, old_free_group);
   if (!current_chunk_) {
     SelectCurrentChunk();
   }
-  IncrementRef();
-  return ptr;
+  return {chunk, ptr};
+}
+
+FixedSizeAllocator::Magazine &FixedSizeAllocator::GetMagazine() {
+  return magazines_[ThreadMagazineIndex()];
+}
+
+void FixedSizeAllocator::FlushMagazines() {
+  for (size_t i = 0; i < kMagazineCount; ++i) {
+    absl::MutexLock magazine_lock(&magazines_[i].mutex);
+    absl::MutexLock lock(&mutex_);
+    FlushMagazine(magazines_[i], magazines_[i].buffers.size());
+  }
+}
+
+void FixedSizeAllocator::FlushMagazine(Magazine &magazine, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    FreeToChunk(magazine.buffers[i].first, magazine.buffers[i].second);
+  }
+  magazine.buffers.erase(magazine.buffers.begin(),
+                         magazine.buffers.begin() + count);
 }
 
 void FixedSizeAllocator::HandleChunkEntryUsageChange(AllocatorChunk *chunk,
@@ -165,27 +231,45 @@ void FixedSizeAllocator::AllocateChunk() {
 }
 
 void FixedSizeAllocator::Free(AllocatorChunk *chunk, char *ptr) {
-  {
-    absl::MutexLock lock(&mutex_);
+  if (!magazines_) {
     --active_allocations_;
-
-    int free_group = CalcChunkFreeGroup(chunk->free_list.size());
-    chunk->free_list.push(ptr);
-    HandleChunkEntryUsageChange(chunk, free_group);
-    if (chunk->free_list.size() == chunk->entries_in_chunk) {
-      chunks_grouped_by_free_entries_[CalcChunkFreeGroup(
-                                          chunk->free_list.size())]
-          .Remove(chunk);
-      if (chunk == current_chunk_) {
-        current_chunk_ = nullptr;
+    absl::MutexLock lock(&mutex_);
+    FreeToChunk(chunk, ptr);
+  } else {
+    {
+      auto &magazine = GetMagazine();
+      absl::MutexLock magazine_lock(&magazine.mutex);
+      if (magazine.buffers.size() >= magazine_size_) {
+        absl::MutexLock lock(&mutex_);
+        FlushMagazine(magazine, std::max<size_t>(1, magazine_size_ / 2));
       }
-      delete chunk;
+      magazine.buffers.emplace_back(chunk, ptr);
+    }
+    // The chunks are freed now rather than with the allocator, so that their
+    // memory is credited to the scope the buffers were freed in.
+    if (--active_allocations_ == 0) {
+      FlushMagazines();
     }
-    SelectCurrentChunk();
   }
   DecrementRef();
 }
 
+void FixedSizeAllocator::FreeToChunk(AllocatorChunk *chunk, char *ptr) {
+  int free_group = CalcChunkFreeGroup(chunk->free_list.size());
+  chunk->free_list.push(ptr);
+  HandleChunkEntryUsageChange(chunk, free_group);
+  if (chunk->free_list.size() == chunk->entries_in_chunk) {
+    chunks_grouped_by_free_entries_[CalcChunkFreeGroup(
+                                        chunk->free_list.size())]
+        .Remove(chunk);
+    if (chunk == current_chunk_) {
+      current_chunk_ = nullptr;
+    }
+    delete chunk;
+  }
+  SelectCurrentChunk();
+}
+
 size_t GetPageSize() { return static_cast<size_t>(sysconf(_SC_PAGESIZE)); }
 
 size_t EntriesFitInChunk(size_t size, size_t num_pages) {
@@ -194,11 +278,16 @@ size_t EntriesFitInChunk(size_t size, size_t num_pages) {
   return std::max<size_t>(kChunkBufferMinEntriesPerChunk, total_bytes / size);
 }
 
+size_t ChunkBufferPages() {
+  static const size_t huge_page_pages =
+      vmsdk::GetHugePageSize() / GetPageSize();
+  return vmsdk::IsHugePageArenaEnabled() ? huge_page_pages : kChunkBufferPages;
+}
+
 AllocatorChunk::AllocatorChunk(Allocator *allocator, size_t size)
-    : entries_in_chunk(EntriesFitInChunk(size, kChunkBufferPages)),
-      // Note: Using new[] to avoid calling constructor of char[].
-      data(std::unique_ptr<char[]>(
-          new char[BufferSize(entries_in_chunk, size)])),
+    : entries_in_chunk(EntriesFitInChunk(size, ChunkBufferPages())),
+      data(vmsdk::AllocateLargeBuffer(BufferSize(entries_in_chunk, size),
+                                      huge_pages)),
       allocator(allocator) {
   for (size_t i = 0; i < entries_in_chunk; ++i) {
     free_list.push(data.get() + i * size);
@@ -206,7 +295,12 @@ AllocatorChunk::AllocatorChunk(Allocator *allocator, size_t size)
   chunk_tracker.Track(this);
 }
 
-AllocatorChunk::~AllocatorChunk() { chunk_tracker.Untrack(this); }
+AllocatorChunk::~AllocatorChunk() {
+  chunk_tracker.Untrack(this);
+  vmsdk::FreeLargeBuffer(
+      data.release(),
+      BufferSize(entries_in_chunk, allocator->ChunkSize()), huge_pages);
+}
 
 bool Allocator::Free(char *ptr) {
   auto chunk = chunk_tracker.FindChunk(ptr);
@@ -8,10 +8,14 @@
 #ifndef VALKEYSEARCH_SRC_UTILS_ALLOCATOR_H_
 #define VALKEYSEARCH_SRC_UTILS_ALLOCATOR_H_
 
+#include <atomic>
 #include <cstddef>
+#include <cstring>
 #include <memory>
-#include <stack>
+#include <utility>
+#include <vector>
 
+#include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 #include "src/utils/intrusive_list.h"
@@ -21,6 +25,7 @@ namespace valkey_search {
 constexpr size_t kFreeEntriesPerChunkGroupSize = 7;
 constexpr size_t kChunkBufferPages = 10;
 constexpr size_t kChunkBufferMinEntriesPerChunk = 8;
+constexpr size_t kMagazineCount = 16;
 
 /*
 FixedSizeAllocator is responsible for allocating and managing contiguous
@@ -32,6 +37,15 @@ same-sized buffers.
 The `FixedSizeAllocator` prioritizes allocation from heavily utilized chunks.
 This approach enhances CPU cache locality and the formation of unutilized chunks
 which are deallocated.
+
+Optionally, free buffers are cached in per-thread magazines in front of the
+chunks, so that threads allocating at once rarely contend on the allocator's
+lock. Magazines are refilled from, and flushed back to, the chunks in batches,
+and all flushed once no buffer is allocated, so that the chunks are freed by
+the last free like they are without magazines.
+
+With the huge page arena enabled, new chunks span whole huge pages rather than
+kChunkBufferPages pages.
 */
 
 struct AllocatorChunk;
@@ -49,12 +63,36 @@ class Allocator {
 
 class FixedSizeAllocator;
 
+// A stack of free buffers, linked through the buffers themselves, which must
+// fit a pointer.
+class FreeList {
+ public:
+  void push(char *buffer) {
+    std::memcpy(buffer, &head_, sizeof(head_));
+    head_ = buffer;
+    ++size_;
+  }
+  char *top() const { return head_; }
+  void pop() {
+    std::memcpy(&head_, head_, sizeof(head_));
+    --size_;
+  }
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+ private:
+  char *head_{nullptr};
+  size_t size_{0};
+};
+
 struct AllocatorChunk {
   AllocatorChunk(Allocator *allocator, size_t size);
   ~AllocatorChunk();
   size_t entries_in_chunk;
+  // Whether the data came from the huge page arena.
+  bool huge_pages{false};
   std::unique_ptr<char[]> data;
-  std::stack<char *> free_list;
+  FreeList free_list;
   Allocator *allocator;
   // Intrusive linked list.
   AllocatorChunk *next{nullptr};
@@ -64,13 +102,12 @@ struct AllocatorChunk {
 class FixedSizeAllocator : public IntrusiveRefCount, public Allocator {
  public:
   friend class IntrusiveRefCount;
-  FixedSizeAllocator(size_t size, bool require_ptr_alignment);
+  // With a magazine size, each thread caches up to that many free buffers.
+  FixedSizeAllocator(size_t size, bool require_ptr_alignment,
+                     size_t magazine_size = 0);
   char *Allocate(size_t size) ABSL_LOCKS_EXCLUDED(mutex_) override;
   char *Allocate() ABSL_LOCKS_EXCLUDED(mutex_);
-  size_t ActiveAllocations() const ABSL_LOCKS_EXCLUDED(mutex_) {
-    absl::MutexLock lock(&mutex_);
-    return active_allocations_;
-  }
+  size_t ActiveAllocations() const { return active_allocations_; }
   size_t ChunkCount() const ABSL_LOCKS_EXCLUDED(mutex_);
   ~FixedSizeAllocator() override;
   size_t ChunkSize() const override { return size_; }
@@ -84,14 +121,31 @@ class FixedSizeAllocator : public IntrusiveRefCount, public Allocator {
   size_t size_;
   IntrusiveList<AllocatorChunk> fully_used_chunks_ ABSL_GUARDED_BY(mutex_);
   AllocatorChunk *current_chunk_ ABSL_GUARDED_BY(mutex_) = nullptr;
-  size_t active_allocations_ ABSL_GUARDED_BY(mutex_){0};
+  std::atomic<size_t> active_allocations_{0};
   mutable absl::Mutex mutex_;
+  using Buffer = std::pair<AllocatorChunk *, char *>;
+  struct alignas(ABSL_CACHELINE_SIZE) Magazine {
+    absl::Mutex mutex;
+    // The most recently freed buffers are at the back.
+    std::vector<Buffer> buffers ABSL_GUARDED_BY(mutex);
+  };
+  Magazine &GetMagazine();
+  // Returns the buffers of every magazine to their chunks.
+  void FlushMagazines() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns the oldest `count` buffers of the magazine to their chunks.
+  void FlushMagazine(Magazine &magazine, size_t count)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(magazine.mutex, mutex_);
   void HandleChunkEntryUsageChange(AllocatorChunk *chunk, int old_free_group)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void SelectCurrentChunk() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void AllocateChunk() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
-  void FreeImpl(char *ptr) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  Buffer AllocateFromChunks() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void FreeToChunk(AllocatorChunk *chunk, char *ptr)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   bool require_ptr_alignment_;
+  size_t magazine_size_;
+  // Null without a magazine size.
+  std::unique_ptr<Magazine[]> magazines_;
 };
 
 DEFINE_UNIQUE_PTR_TYPE(Allocator);
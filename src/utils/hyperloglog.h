@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#ifndef VALKEYSEARCH_SRC_UTILS_HYPERLOGLOG_H_
+#define VALKEYSEARCH_SRC_UTILS_HYPERLOGLOG_H_
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/strings/string_view.h"
+
+namespace valkey_search::utils {
+
+//
+// Estimates the number of distinct items added to it, in a fixed number of
+// one byte registers, with a standard error of about 1.04 / sqrt(2^kBits).
+// The items are added as 64 bit hashes, which must be computed the same way
+// by every sketch that is merged.
+//
+template <int kBits>
+class HyperLogLog {
+ public:
+  static constexpr size_t kRegisters = size_t(1) << kBits;
+
+  void Add(uint64_t hash) {
+    auto index = hash >> (64 - kBits);
+    // The position of the first one bit in the rest of the hash, with a
+    // sentinel bit for when there is none.
+    auto rest = (hash << kBits) | (uint64_t(1) << (kBits - 1));
+    auto rank = static_cast<uint8_t>(std::countl_zero(rest) + 1);
+    registers_[index] = std::max(registers_[index], rank);
+  }
+
+  // Folds in the items of other.
+  void Merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < kRegisters; ++i) {
+      registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+  }
+
+  double Estimate() const {
+    double sum = 0;
+    size_t zeros = 0;
+    for (auto reg : registers_) {
+      sum += std::ldexp(1.0, -reg);
+      zeros += reg == 0;
+    }
+    constexpr double m = kRegisters;
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // Linear counting is more accurate for small cardinalities.
+    if (estimate <= 2.5 * m && zeros) {
+      estimate = m * std::log(m / zeros);
+    }
+    return estimate;
+  }
+
+  // The registers, to ship the sketch elsewhere.
+  absl::string_view Serialize() const {
+    return absl::string_view(reinterpret_cast<const char*>(registers_),
+                             kRegisters);
+  }
+  // Folds in a serialized sketch. Returns false if it's malformed.
+  bool MergeSerialized(absl::string_view serialized) {
+    if (serialized.size() != kRegisters) {
+      return false;
+    }
+    HyperLogLog other;
+    std::memcpy(other.registers_, serialized.data(), kRegisters);
+    Merge(other);
+    return true;
+  }
+
+ private:
+  uint8_t registers_[kRegisters]{};
+};
+
+}  // namespace valkey_search::utils
+
+#endif  // VALKEYSEARCH_SRC_UTILS_HYPERLOGLOG_H_
@@ -28,24 +28,28 @@
 
 namespace valkey_search {
 
-template <typename T, typename Hasher, typename Equaler>
+// `Set` holds the values of a node. It defaults to a hash set, an ordered set
+// may be given to iterate the values in order.
+template <typename T, typename Hasher, typename Equaler,
+          typename Set = absl::flat_hash_set<T, Hasher, Equaler>>
 class PatriciaNode {
  public:
   PatriciaNode() = default;
   absl::flat_hash_map<std::string,
-                      std::unique_ptr<PatriciaNode<T, Hasher, Equaler>>>
+                      std::unique_ptr<PatriciaNode<T, Hasher, Equaler, Set>>>
       children;
   int64_t subtree_values_count = 0;
-  std::optional<absl::flat_hash_set<T, Hasher, Equaler>> value;
+  std::optional<Set> value;
   void PrintValue() {}
 };
 
 template <typename T, typename Hasher = absl::Hash<T>,
-          typename Equaler = std::equal_to<T>>
+          typename Equaler = std::equal_to<T>,
+          typename Set = absl::flat_hash_set<T, Hasher, Equaler>>
 class PatriciaTree {
  public:
-  using SetType = absl::flat_hash_set<T, Hasher, Equaler>;
-  using PatriciaNodeType = PatriciaNode<T, Hasher, Equaler>;
+  using SetType = Set;
+  using PatriciaNodeType = PatriciaNode<T, Hasher, Equaler, Set>;
   PatriciaTree(bool case_sensitive)
       : root_(std::make_unique<PatriciaNodeType>()),
         case_sensitive_(case_sensitive) {}
@@ -8,8 +8,10 @@
 #include "src/utils/string_interning.h"
 
 #include <cstring>
-#include <memory>
+#include <new>
+#include <optional>
 
+#include "absl/hash/hash.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "src/utils/allocator.h"
@@ -20,76 +22,95 @@ namespace valkey_search {
 
 MemoryPool StringInternStore::memory_pool_{0};
 
-InternedString::InternedString(absl::string_view str, bool shared)
-    : length_(str.length()), is_shared_(shared), is_data_owner_(true) {
-  data_ = new char[length_ + 1];
-  memcpy(data_, str.data(), length_);
-  data_[length_] = '\0';
+InternedString::InternedString(char* data, size_t length, bool shared,
+                               bool is_data_owner)
+    : data_(data),
+      length_(length),
+      is_shared_(shared),
+      is_data_owner_(is_data_owner) {}
+
+InternedString* InternedString::Make(absl::string_view str, bool shared) {
+  void* memory = ::operator new(sizeof(InternedString) + str.size() + 1);
+  char* data = static_cast<char*>(memory) + sizeof(InternedString);
+  memcpy(data, str.data(), str.size());
+  data[str.size()] = '\0';
+  return new (memory) InternedString(data, str.size(), shared, true);
 }
 
-InternedString::InternedString(char* data, size_t length)
-    : data_(data), length_(length), is_shared_(true), is_data_owner_(false) {}
+InternedStringPtr InternedString::MakeUninterned(absl::string_view str) {
+  return InternedStringPtr(Make(str, false));
+}
 
 InternedString::~InternedString() {
-  // NOTE: isolate memory tracking for deallocation.
-  IsolatedMemoryScope scope{StringInternStore::memory_pool_};
-
   if (is_shared_) {
     StringInternStore::Instance().Release(this);
   }
-
-  if (is_data_owner_) {
-    delete[] data_;
-  } else {
+  if (!is_data_owner_) {
     Allocator::Free(data_);
   }
 }
 
-void StringInternStore::Release(InternedString* str) {
-  absl::MutexLock lock(&mutex_);
-  auto it = str_to_interned_.find(*str);
-  if (it == str_to_interned_.end()) {
-    return;
+void InternedString::Destroy(InternedString* str) {
+  // NOTE: isolate memory tracking for deallocation, for the strings whose
+  // allocation was isolated too.
+  std::optional<IsolatedMemoryScope> scope;
+  if (str->is_shared_) {
+    scope.emplace(StringInternStore::memory_pool_);
   }
-  auto locked = it->second.lock();
-  // During `StringIntern` destruction, a new `StringIntern` may be stored,
-  // so we check if the `StringIntern` being released is the one currently
-  // stored before removing it.
-  if (!locked || locked.get() == str) {
-    str_to_interned_.erase(*str);
+  str->~InternedString();
+  ::operator delete(str);
+}
+
+StringInternStore::Shard& StringInternStore::GetShard(absl::string_view str) {
+  // Salted, so that the strings of a shard don't share the low bits of the
+  // hash its map buckets them by.
+  return shards_[absl::HashOf(str, kShardCount) % kShardCount];
+}
+
+void StringInternStore::Release(InternedString* str) {
+  auto& shard = GetShard(*str);
+  absl::MutexLock lock(&shard.mutex);
+  auto it = shard.str_to_interned.find(*str);
+  // While the string was on its way out, an equal one may have been interned
+  // in its place, which stays.
+  if (it != shard.str_to_interned.end() && it->second == str) {
+    shard.str_to_interned.erase(it);
   }
 }
 
-std::shared_ptr<InternedString> StringInternStore::Intern(
-    absl::string_view str, Allocator* allocator) {
+InternedStringPtr StringInternStore::Intern(absl::string_view str,
+                                            Allocator* allocator) {
   return Instance().InternImpl(str, allocator);
 }
 
-std::shared_ptr<InternedString> StringInternStore::InternImpl(
-    absl::string_view str, Allocator* allocator) {
+InternedStringPtr StringInternStore::InternImpl(absl::string_view str,
+                                                Allocator* allocator) {
   IsolatedMemoryScope scope{memory_pool_};
 
-  absl::MutexLock lock(&mutex_);
-  auto it = str_to_interned_.find(str);
-  if (it != str_to_interned_.end()) {
-    if (auto locked = it->second.lock()) {
-      return locked;
+  auto& shard = GetShard(str);
+  absl::MutexLock lock(&shard.mutex);
+  auto it = shard.str_to_interned.find(str);
+  if (it != shard.str_to_interned.end()) {
+    if (it->second->TryIncrementRef()) {
+      return InternedStringPtr(it->second);
     }
+    // The string is on its way out, its release blocked on the lock. Its key
+    // is about to dangle, so it makes way for the new string.
+    shard.str_to_interned.erase(it);
   }
 
-  std::shared_ptr<InternedString> interned_string;
+  InternedString* interned_string;
   if (allocator) {
     auto buffer = allocator->Allocate(str.size() + 1);
     memcpy(buffer, str.data(), str.size());
     buffer[str.size()] = '\0';
-    interned_string =
-        std::shared_ptr<InternedString>(new InternedString(buffer, str.size()));
+    interned_string = new (::operator new(sizeof(InternedString)))
+        InternedString(buffer, str.size(), true, false);
   } else {
-    interned_string =
-        std::shared_ptr<InternedString>(new InternedString(str, true));
+    interned_string = InternedString::Make(str, true);
   }
-  str_to_interned_.insert({*interned_string, interned_string});
-  return interned_string;
+  shard.str_to_interned.insert({*interned_string, interned_string});
+  return InternedStringPtr(interned_string);
 }
 
 int64_t StringInternStore::GetMemoryUsage() { return memory_pool_.GetUsage(); }
@@ -8,9 +8,13 @@
 #ifndef VALKEYSEARCH_SRC_UTILS_STRING_INTERNING_H_
 #define VALKEYSEARCH_SRC_UTILS_STRING_INTERNING_H_
 
+#include <array>
+#include <atomic>
 #include <cstddef>
-#include <memory>
+#include <cstdint>
+#include <utility>
 
+#include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -25,34 +29,92 @@ namespace valkey_search {
 
 class InternedString;
 
-class StringInternStore {
+//
+// A reference to an InternedString. It's a single pointer: the reference count
+// lives in the string, next to its length and, unless an allocator holds
+// them, its characters.
+//
+class InternedStringPtr {
  public:
+  using element_type = InternedString;
+
+  InternedStringPtr() = default;
+  InternedStringPtr(std::nullptr_t) {}  // NOLINT(google-explicit-constructor)
+  InternedStringPtr(const InternedStringPtr &other);
+  InternedStringPtr(InternedStringPtr &&other) noexcept
+      : str_(std::exchange(other.str_, nullptr)) {}
+  InternedStringPtr &operator=(const InternedStringPtr &other);
+  InternedStringPtr &operator=(InternedStringPtr &&other) noexcept;
+  ~InternedStringPtr() { reset(); }
+
+  InternedString *get() const { return str_; }
+  InternedString &operator*() const { return *str_; }
+  InternedString *operator->() const { return str_; }
+  explicit operator bool() const { return str_ != nullptr; }
+  void reset();
+
+  friend bool operator==(const InternedStringPtr &lhs,
+                         const InternedStringPtr &rhs) {
+    return lhs.str_ == rhs.str_;
+  }
+  friend bool operator==(const InternedStringPtr &lhs, std::nullptr_t) {
+    return lhs.str_ == nullptr;
+  }
+  template <typename H>
+  friend H AbslHashValue(H h, const InternedStringPtr &ptr) {
+    return H::combine(std::move(h), ptr.str_);
+  }
+
+ private:
   friend class InternedString;
+  friend class StringInternStore;
+  // Takes over a reference which is already counted.
+  explicit InternedStringPtr(InternedString *str) : str_(str) {}
+
+  InternedString *str_{nullptr};
+};
+
+class StringInternStore {
+ public:
   friend class InternedString;
   static StringInternStore &Instance() {
     static StringInternStore *instance = new StringInternStore();
     return *instance;
   }
-  static std::shared_ptr<InternedString> Intern(absl::string_view str,
-                                                Allocator *allocator = nullptr);
+  static InternedStringPtr Intern(absl::string_view str,
+                                  Allocator *allocator = nullptr);
 
   static int64_t GetMemoryUsage();
 
   size_t Size() const {
-    absl::MutexLock lock(&mutex_);
-    return str_to_interned_.size();
+    size_t size = 0;
+    for (const auto &shard : shards_) {
+      absl::MutexLock lock(&shard.mutex);
+      size += shard.str_to_interned.size();
+    }
+    return size;
   }
 
  private:
   static MemoryPool memory_pool_;
 
+  //
+  // The strings are spread over shards by hash, each with its own lock, so
+  // that the writer and reader threads rarely contend when interning.
+  //
+  static constexpr size_t kShardCount{64};
+  struct alignas(ABSL_CACHELINE_SIZE) Shard {
+    // The strings may be on their way out, once their count is 0.
+    absl::flat_hash_map<absl::string_view, InternedString *> str_to_interned
+        ABSL_GUARDED_BY(mutex);
+    mutable absl::Mutex mutex;
+  };
+
   StringInternStore() = default;
-  std::shared_ptr<InternedString> InternImpl(absl::string_view str,
-                                             Allocator *allocator);
+  Shard &GetShard(absl::string_view str);
+  InternedStringPtr InternImpl(absl::string_view str, Allocator *allocator);
   void Release(InternedString *str);
-  absl::flat_hash_map<absl::string_view, std::weak_ptr<InternedString>>
-      str_to_interned_ ABSL_GUARDED_BY(mutex_);
-  mutable absl::Mutex mutex_;
+  std::array<Shard, kShardCount> shards_;
 
   // Used for testing.
   static void SetMemoryUsage(int64_t value) {
@@ -65,35 +127,87 @@ class StringInternStore {
 
 class InternedString {
  public:
+  friend class InternedStringPtr;
   friend class StringInternStore;
   InternedString() = delete;
   InternedString(const InternedString &) = delete;
   InternedString &operator=(const InternedString &) = delete;
   InternedString(InternedString &&) = delete;
   InternedString &operator=(InternedString &&) = delete;
-  // Note: The constructor below does not perform actual string interning.
-  // It is intended for cases where an API requires a `StringIntern` object
-  // but interning is unnecessary or inefficient. For example, this applies
-  // when fetching data from remote nodes.
-  InternedString(absl::string_view str) : InternedString(str, false){};
-
-  ~InternedString();
+  // Note: The string made below is not actually interned. It is intended for
+  // cases where an API requires an `InternedStringPtr` but interning is
+  // unnecessary or inefficient. For example, this applies when fetching data
+  // from remote nodes.
+  static InternedStringPtr MakeUninterned(absl::string_view str);
 
   absl::string_view Str() const { return {data_, length_}; }
   operator absl::string_view() const { return Str(); }
   absl::string_view operator*() const { return Str(); }
 
  private:
-  InternedString(absl::string_view str, bool shared);
-  InternedString(char *data, size_t length);
+  // Made and destroyed with one allocation holding the characters after the
+  // string itself, or with the characters held by an allocator.
+  static InternedString *Make(absl::string_view str, bool shared);
+  InternedString(char *data, size_t length, bool shared, bool is_data_owner);
+  ~InternedString();
+  static void Destroy(InternedString *str);
+
+  void IncrementRef() { ref_count_.fetch_add(1, std::memory_order_relaxed); }
+  // Fails once the count is 0, when the string is on its way out.
+  bool TryIncrementRef() {
+    auto count = ref_count_.load(std::memory_order_relaxed);
+    while (count != 0) {
+      if (ref_count_.compare_exchange_weak(count, count + 1,
+                                           std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  void DecrementRef() {
+    if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Destroy(this);
+    }
+  }
 
   char *data_;
   size_t length_;
+  std::atomic<uint32_t> ref_count_{1};
   bool is_shared_;
   bool is_data_owner_;
 };
 
-using InternedStringPtr = std::shared_ptr<InternedString>;
+inline InternedStringPtr::InternedStringPtr(const InternedStringPtr &other)
+    : str_(other.str_) {
+  if (str_ != nullptr) {
+    str_->IncrementRef();
+  }
+}
+
+inline InternedStringPtr &InternedStringPtr::operator=(
+    const InternedStringPtr &other) {
+  if (other.str_ != nullptr) {
+    other.str_->IncrementRef();
+  }
+  reset();
+  str_ = other.str_;
+  return *this;
+}
+
+inline InternedStringPtr &InternedStringPtr::operator=(
+    InternedStringPtr &&other) noexcept {
+  if (this != &other) {
+    reset();
+    str_ = std::exchange(other.str_, nullptr);
+  }
+  return *this;
+}
+
+inline void InternedStringPtr::reset() {
+  if (str_ != nullptr) {
+    std::exchange(str_, nullptr)->DecrementRef();
+  }
+}
 
 struct InternedStringPtrHash {
   template <typename T>
@@ -109,6 +223,15 @@ struct InternedStringPtrEqual {
   }
 };
 
+// Orders interned strings by their characters. Unlike their addresses, the
+// order is the same across runs and restarts.
+struct InternedStringPtrLess {
+  bool operator()(const InternedStringPtr &lhs,
+                  const InternedStringPtr &rhs) const {
+    return lhs->Str() < rhs->Str();
+  }
+};
+
 template <typename T>
 using InternedStringMap =
     absl::flat_hash_map<InternedStringPtr, T, InternedStringPtrHash,
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#ifndef VALKEYSEARCH_SRC_UTILS_T_DIGEST_H_
+#define VALKEYSEARCH_SRC_UTILS_T_DIGEST_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace valkey_search::utils {
+
+//
+// A merging t-digest: estimates quantiles from weighted centroids which are
+// small near the tails and larger towards the median. Added values are
+// buffered and merged into the centroids in batches. The number of centroids
+// depends on the compression, and only grows with the log of the number of
+// values added.
+//
+class TDigest {
+ public:
+  static constexpr double kCompression = 100;
+
+  void Add(double value, double weight = 1) {
+    Extend(value, value);
+    buffer_.push_back({value, weight});
+    if (buffer_.size() >= kBufferSize) {
+      Compress();
+    }
+  }
+
+  // Folds in the values of other.
+  void Merge(const TDigest& other) {
+    if (other.Empty()) {
+      return;
+    }
+    Extend(other.min_, other.max_);
+    for (auto& centroid : other.Merged()) {
+      Add(centroid.mean_, centroid.weight_);
+    }
+  }
+
+  bool Empty() const { return centroids_.empty() && buffer_.empty(); }
+
+  // The value at quantile q, in [0, 1], interpolated between the centroids.
+  // Only meaningful once something was added.
+  double Quantile(double q) const {
+    auto centroids = Merged();
+    if (centroids.empty()) {
+      return 0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    double total = 0;
+    for (auto& centroid : centroids) {
+      total += centroid.weight_;
+    }
+    auto target = q * total;
+    auto& first = centroids.front();
+    if (target <= first.weight_ / 2) {
+      return Interpolate(min_, first.mean_, target / (first.weight_ / 2));
+    }
+    double cumulative = 0;
+    for (size_t i = 0; i + 1 < centroids.size(); ++i) {
+      auto& left = centroids[i];
+      auto& right = centroids[i + 1];
+      auto from = cumulative + left.weight_ / 2;
+      auto to = cumulative + left.weight_ + right.weight_ / 2;
+      if (target <= to) {
+        return Interpolate(left.mean_, right.mean_,
+                           (target - from) / (to - from));
+      }
+      cumulative += left.weight_;
+    }
+    auto& last = centroids.back();
+    auto from = total - last.weight_ / 2;
+    return Interpolate(last.mean_, max_,
+                       (target - from) / (last.weight_ / 2));
+  }
+
+  // The extremes and the centroids, to ship the digest elsewhere.
+  std::string Serialize() const {
+    if (Empty()) {
+      return {};
+    }
+    auto centroids = Merged();
+    std::string result(sizeof(double) * (2 + 2 * centroids.size()), '\0');
+    auto out = result.data();
+    out = Put(out, min_);
+    out = Put(out, max_);
+    for (auto& centroid : centroids) {
+      out = Put(out, centroid.mean_);
+      out = Put(out, centroid.weight_);
+    }
+    return result;
+  }
+  // Folds in a serialized digest. Returns false if it's malformed.
+  bool MergeSerialized(absl::string_view serialized) {
+    if (serialized.size() % (2 * sizeof(double)) != 0) {
+      return false;
+    }
+    auto in = serialized.data();
+    auto end = in + serialized.size();
+    if (in == end) {
+      return true;
+    }
+    double min, max;
+    in = Get(in, min);
+    in = Get(in, max);
+    if (in == end) {
+      return false;
+    }
+    Extend(min, max);
+    while (in != end) {
+      double mean, weight;
+      in = Get(in, mean);
+      in = Get(in, weight);
+      Add(mean, weight);
+    }
+    return true;
+  }
+
+ private:
+  struct Centroid {
+    double mean_;
+    double weight_;
+  };
+
+  static constexpr size_t kBufferSize = 5 * kCompression;
+
+  // Fast math can't be trusted with infinities, so there are no sentinels.
+  void Extend(double min, double max) {
+    min_ = Empty() ? min : std::min(min_, min);
+    max_ = Empty() ? max : std::max(max_, max);
+  }
+  static double Interpolate(double from, double to, double fraction) {
+    return from + (to - from) * std::clamp(fraction, 0.0, 1.0);
+  }
+  static char* Put(char* out, double d) {
+    std::memcpy(out, &d, sizeof(d));
+    return out + sizeof(d);
+  }
+  static const char* Get(const char* in, double& d) {
+    std::memcpy(&d, in, sizeof(d));
+    return in + sizeof(d);
+  }
+
+  // The centroids with the buffered values merged in. Neighbours are merged
+  // while the weight of the result stays under 4 * total * q * (1 - q) /
+  // compression, at both of its ends.
+  std::vector<Centroid> Merged() const {
+    std::vector<Centroid> all(centroids_);
+    all.insert(all.end(), buffer_.begin(), buffer_.end());
+    if (all.size() <= 1) {
+      return all;
+    }
+    std::sort(all.begin(), all.end(),
+              [](const Centroid& l, const Centroid& r) {
+                return l.mean_ < r.mean_;
+              });
+    double total = 0;
+    for (auto& centroid : all) {
+      total += centroid.weight_;
+    }
+    std::vector<Centroid> result;
+    auto current = all[0];
+    double before = 0;
+    for (size_t i = 1; i < all.size(); ++i) {
+      auto weight = current.weight_ + all[i].weight_;
+      auto q0 = before / total;
+      auto q1 = (before + weight) / total;
+      auto limit =
+          4 * total * std::min(q0 * (1 - q0), q1 * (1 - q1)) / kCompression;
+      if (weight <= limit) {
+        current.mean_ += (all[i].mean_ - current.mean_) * all[i].weight_ /
+                         weight;
+        current.weight_ = weight;
+      } else {
+        before += current.weight_;
+        result.push_back(current);
+        current = all[i];
+      }
+    }
+    result.push_back(current);
+    return result;
+  }
+
+  void Compress() {
+    centroids_ = Merged();
+    buffer_.clear();
+  }
+
+  std::vector<Centroid> centroids_;
+  std::vector<Centroid> buffer_;
+  double min_{0};
+  double max_{0};
+};
+
+}  // namespace valkey_search::utils
+
+#endif  // VALKEYSEARCH_SRC_UTILS_T_DIGEST_H_
@@ -28,12 +28,15 @@
 #include "src/coordinator/metadata_manager.h"
 #include "src/coordinator/server.h"
 #include "src/coordinator/util.h"
+#include "src/index_schema.h"
 #include "src/metrics.h"
 #include "src/rdb_serialization.h"
 #include "src/schema_manager.h"
+#include "src/stored_field.h"
 #include "src/utils/string_interning.h"
 #include "src/valkey_search_options.h"
 #include "src/vector_externalizer.h"
+#include "vmsdk/src/huge_pages.h"
 #include "vmsdk/src/info.h"
 #include "vmsdk/src/latency_sampler.h"
 #include "vmsdk/src/log.h"
@@ -113,6 +116,27 @@ static vmsdk::info_field::Integer reclaimable_memory(
         })
         .CrashSafe());
 
+static vmsdk::info_field::Integer index_content_hashes_memory(
+    "memory", "index_content_hashes_memory_bytes",
+    vmsdk::info_field::IntegerBuilder()
+        .App()
+        .Computed(IndexSchema::GetContentHashesMemoryUsage)
+        .CrashSafe());
+
+static vmsdk::info_field::Integer index_mutation_sequences_memory(
+    "memory", "index_mutation_sequences_memory_bytes",
+    vmsdk::info_field::IntegerBuilder()
+        .App()
+        .Computed(IndexSchema::GetMutationSequencesMemoryUsage)
+        .CrashSafe());
+
+static vmsdk::info_field::Integer index_stored_fields_memory(
+    "memory", "index_stored_fields_memory_bytes",
+    vmsdk::info_field::IntegerBuilder()
+        .App()
+        .Computed(StoredField::GetMemoryUsage)
+        .CrashSafe());
+
 static vmsdk::info_field::String background_indexing_status(
     "indexing", "background_indexing_status",
     vmsdk::info_field::StringBuilder().App().ComputedCharPtr(
@@ -204,6 +228,18 @@ static vmsdk::info_field::Integer ingest_total_batches(
       return Metrics::GetStats().ingest_total_batches;
     }));
 
+static vmsdk::info_field::Integer ingest_total_batched_keys(
+    "global_ingestion", "ingest_total_batched_keys",
+    vmsdk::info_field::IntegerBuilder().Dev().Computed([]() -> long long {
+      return Metrics::GetStats().ingest_total_batched_keys;
+    }));
+
+static vmsdk::info_field::Integer ingest_field_unchanged(
+    "global_ingestion", "ingest_field_unchanged",
+    vmsdk::info_field::IntegerBuilder().Dev().Computed([]() -> long long {
+      return Metrics::GetStats().ingest_field_unchanged;
+    }));
+
 static vmsdk::info_field::Integer ingest_total_failures(
     "global_ingestion", "ingest_total_failures",
     vmsdk::info_field::IntegerBuilder().Dev().Computed([]() -> long long {
@@ -355,6 +391,18 @@ static vmsdk::info_field::Integer query_prefiltering_requests_cnt(
       return Metrics::GetStats().query_prefiltering_requests_cnt;
     }));
 
+static vmsdk::info_field::Integer streamed_requests_count(
+    "query", "streamed_requests_count",
+    vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
+      return Metrics::GetStats().query_streamed_requests_cnt;
+    }));
+
+static vmsdk::info_field::Integer count_only_requests_count(
+    "query", "count_only_requests_count",
+    vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
+      return Metrics::GetStats().query_count_only_requests_cnt;
+    }));
+
 static vmsdk::info_field::Integer hnsw_add_exceptions_count(
     "hnswlib", "hnsw_add_exceptions_count",
     vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
@@ -391,6 +439,30 @@ static vmsdk::info_field::Integer string_interning_store_size(
       return StringInternStore::Instance().Size();
     }));
 
+static vmsdk::info_field::Integer huge_page_arena_region_count(
+    "huge_page_arena", "huge_page_arena_region_count",
+    vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
+      return vmsdk::GetHugePageArenaStats().region_cnt;
+    }));
+
+static vmsdk::info_field::Integer huge_page_arena_mapped_bytes(
+    "huge_page_arena", "huge_page_arena_mapped_bytes",
+    vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
+      return vmsdk::GetHugePageArenaStats().mapped_bytes;
+    }));
+
+static vmsdk::info_field::Integer huge_page_arena_advised_bytes(
+    "huge_page_arena", "huge_page_arena_advised_bytes",
+    vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
+      return vmsdk::GetHugePageArenaStats().advised_bytes;
+    }));
+
+static vmsdk::info_field::Integer huge_page_arena_map_failure_count(
+    "huge_page_arena", "huge_page_arena_map_failure_count",
+    vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
+      return vmsdk::GetHugePageArenaStats().map_failure_cnt;
+    }));
+
 static vmsdk::info_field::Integer vector_externing_entry_count(
     "vector_externing", "vector_externing_entry_count",
     vmsdk::info_field::IntegerBuilder().App().Computed([]() -> long long {
@@ -492,6 +564,34 @@ static vmsdk::info_field::Integer
               return ValkeySearch::Instance().UsingCoordinator();
             }));
 
+static vmsdk::info_field::Integer
+    coordinator_server_aggregate_index_partition_success_count(
+        "coordinator",
+        "coordinator_server_aggregate_index_partition_success_count",
+        vmsdk::info_field::IntegerBuilder()
+            .App()
+            .Computed([]() -> long long {
+              return Metrics::GetStats()
+                  .coordinator_server_aggregate_index_partition_success_cnt;
+            })
+            .VisibleIf([]() -> bool {
+              return ValkeySearch::Instance().UsingCoordinator();
+            }));
+
+static vmsdk::info_field::Integer
+    coordinator_server_aggregate_index_partition_failure_count(
+        "coordinator",
+        "coordinator_server_aggregate_index_partition_failure_count",
+        vmsdk::info_field::IntegerBuilder()
+            .App()
+            .Computed([]() -> long long {
+              return Metrics::GetStats()
+                  .coordinator_server_aggregate_index_partition_failure_cnt;
+            })
+            .VisibleIf([]() -> bool {
+              return ValkeySearch::Instance().UsingCoordinator();
+            }));
+
 static vmsdk::info_field::Integer
     coordinator_client_get_global_metadata_success_count(
         "coordinator", "coordinator_client_get_global_metadata_success_count",
@@ -546,6 +646,34 @@ static vmsdk::info_field::Integer
               return ValkeySearch::Instance().UsingCoordinator();
             }));
 
+static vmsdk::info_field::Integer
+    coordinator_client_aggregate_index_partition_success_count(
+        "coordinator",
+        "coordinator_client_aggregate_index_partition_success_count",
+        vmsdk::info_field::IntegerBuilder()
+            .App()
+            .Computed([]() -> long long {
+              return Metrics::GetStats()
+                  .coordinator_client_aggregate_index_partition_success_cnt;
+            })
+            .VisibleIf([]() -> bool {
+              return ValkeySearch::Instance().UsingCoordinator();
+            }));
+
+static vmsdk::info_field::Integer
+    coordinator_client_aggregate_index_partition_failure_count(
+        "coordinator",
+        "coordinator_client_aggregate_index_partition_failure_count",
+        vmsdk::info_field::IntegerBuilder()
+            .App()
+            .Computed([]() -> long long {
+              return Metrics::GetStats()
+                  .coordinator_client_aggregate_index_partition_failure_cnt;
+            })
+            .VisibleIf([]() -> bool {
+              return ValkeySearch::Instance().UsingCoordinator();
+            }));
+
 static vmsdk::info_field::Integer coordinator_bytes_out(
     "coordinator", "coordinator_bytes_out",
     vmsdk::info_field::IntegerBuilder()
@@ -8,6 +8,7 @@
 
 #include "valkey_search.h"
 #include "vmsdk/src/concurrency.h"
+#include "vmsdk/src/huge_pages.h"
 #include "vmsdk/src/module_config.h"
 #include "vmsdk/src/thread_pool.h"
 
@@ -273,6 +274,68 @@ static auto thread_pool_wait_time_samples =
         })
         .Build();
 
+/// Register the "--max-mutation-batch-size" flag. Controls the max number of
+/// keys a writer thread applies under one acquisition of the writer lock
+constexpr absl::string_view kMaxMutationBatchSizeConfig{
+    "max-mutation-batch-size"};
+constexpr uint32_t kDefaultMaxMutationBatchSize{32};
+constexpr uint32_t kMinimumMaxMutationBatchSize{1};  // no batching
+constexpr uint32_t kMaximumMaxMutationBatchSize{4096};
+static auto max_mutation_batch_size =
+    vmsdk::config::NumberBuilder(
+        kMaxMutationBatchSizeConfig,   // name
+        kDefaultMaxMutationBatchSize,  // default size (32)
+        kMinimumMaxMutationBatchSize,  // min size (1)
+        kMaximumMaxMutationBatchSize)  // max size (4096)
+        .Build();
+
+/// Register the "--cursor-max-idle-ms" flag. Controls how long an
+/// FT.AGGREGATE cursor may go unread before it is dropped, and caps MAXIDLE
+constexpr absl::string_view kCursorMaxIdleMsConfig{"cursor-max-idle-ms"};
+constexpr uint32_t kDefaultCursorMaxIdleMs{300000};    // 5 minutes
+constexpr uint32_t kMinimumCursorMaxIdleMs{1};         // 1ms
+constexpr uint32_t kMaximumCursorMaxIdleMs{86400000};  // 1 day
+static auto cursor_max_idle_ms =
+    vmsdk::config::NumberBuilder(
+        kCursorMaxIdleMsConfig,   // name
+        kDefaultCursorMaxIdleMs,  // default (5 minutes)
+        kMinimumCursorMaxIdleMs,  // min (1ms)
+        kMaximumCursorMaxIdleMs)  // max (1 day)
+        .Build();
+
+/// Register the "--cursor-max-memory" flag. Controls the approximate number of
+/// bytes which the records of all FT.AGGREGATE cursors may hold
+constexpr absl::string_view kCursorMaxMemoryConfig{"cursor-max-memory"};
+constexpr long long kDefaultCursorMaxMemory{256ll << 20};  // 256MB
+constexpr long long kMinimumCursorMaxMemory{0};            // no cursors
+constexpr long long kMaximumCursorMaxMemory{1ll << 40};    // 1TB
+static auto cursor_max_memory =
+    vmsdk::config::NumberBuilder(
+        kCursorMaxMemoryConfig,   // name
+        kDefaultCursorMaxMemory,  // default (256MB)
+        kMinimumCursorMaxMemory,  // min (no cursors)
+        kMaximumCursorMaxMemory)  // max (1TB)
+        .Build();
+
+/// Register the "--skip-unchanged-attributes" flag. When set, keyspace
+/// notifications remember a hash of each indexed attribute's content, and an
+/// attribute whose content didn't change isn't sent to its index again
+constexpr absl::string_view kSkipUnchangedAttributesConfig{
+    "skip-unchanged-attributes"};
+static auto skip_unchanged_attributes =
+    config::BooleanBuilder(kSkipUnchangedAttributesConfig, true).Build();
+
+/// Register the "--huge-page-arena" flag. When set, new vector allocator and
+/// HNSW chunks are allocated as whole, aligned huge pages, which the kernel is
+/// advised to back by transparent huge pages. Has no effect where huge pages
+/// exceed 2MB
+constexpr absl::string_view kHugePageArenaConfig{"huge-page-arena"};
+static auto huge_page_arena =
+    config::BooleanBuilder(kHugePageArenaConfig, false)
+        .WithModifyCallback(
+            [](bool value) { vmsdk::SetHugePageArenaEnabled(value); })
+        .Build();
+
 uint32_t GetQueryStringBytes() { return query_string_bytes->GetValue(); }
 
 vmsdk::config::Number& GetHNSWBlockSize() {
@@ -342,5 +405,25 @@ vmsdk::config::Number& GetThreadPoolWaitTimeSamples() {
   return dynamic_cast<vmsdk::config::Number&>(*thread_pool_wait_time_samples);
 }
 
+vmsdk::config::Number& GetMaxMutationBatchSize() {
+  return dynamic_cast<vmsdk::config::Number&>(*max_mutation_batch_size);
+}
+
+vmsdk::config::Number& GetCursorMaxIdleMs() {
+  return dynamic_cast<vmsdk::config::Number&>(*cursor_max_idle_ms);
+}
+
+vmsdk::config::Number& GetCursorMaxMemory() {
+  return dynamic_cast<vmsdk::config::Number&>(*cursor_max_memory);
+}
+
+vmsdk::config::Boolean& GetSkipUnchangedAttributes() {
+  return dynamic_cast<vmsdk::config::Boolean&>(*skip_unchanged_attributes);
+}
+
+vmsdk::config::Boolean& GetHugePageArena() {
+  return dynamic_cast<vmsdk::config::Boolean&>(*huge_page_arena);
+}
+
 }  // namespace options
 }  // namespace valkey_search
@@ -71,5 +71,22 @@ config::Number& GetLocalFanoutQueueWaitThreshold();
 /// Return the sample queue size for thread pool wait time tracking
 config::Number& GetThreadPoolWaitTimeSamples();
 
+/// Return the max number of keys applied under one writer lock acquisition
+config::Number& GetMaxMutationBatchSize();
+
+/// Return the max time in milliseconds an FT.AGGREGATE cursor may stay idle
+config::Number& GetCursorMaxIdleMs();
+
+/// Return the approximate max number of bytes held by FT.AGGREGATE cursors
+config::Number& GetCursorMaxMemory();
+
+/// Return the configuration entry for skipping attributes whose content didn't
+/// change
+config::Boolean& GetSkipUnchangedAttributes();
+
+/// Return the configuration entry for allocating vector and graph chunks from
+/// huge pages
+config::Boolean& GetHugePageArena();
+
 }  // namespace options
 }  // namespace valkey_search
@@ -6,8 +6,10 @@
 
 #include "src/expr/expr.h"
 
+#include <cmath>
 #include <map>
 #include <set>
+#include <sstream>
 
 #include "absl/container/flat_hash_map.h"
 #include "gtest/gtest.h"
@@ -42,6 +44,7 @@ class ExprTest : public testing::Test {
     std::set<std::string> known_attr{"one", "two", "notfound"};
     absl::flat_hash_map<std::string, std::string> params{{"one", "1"},
                                                          {"two", "2"}};
+    absl::flat_hash_map<std::string, std::string> computed;
     absl::StatusOr<std::unique_ptr<Expression::AttributeReference>>
     MakeReference(const absl::string_view s, bool create) override {
       auto itr = known_attr.find(std::string(s));
@@ -54,6 +57,14 @@ class ExprTest : public testing::Test {
       }
       return std::make_unique<Ref>(s);
     }
+    std::unique_ptr<Expression::AttributeReference> FindComputed(
+        absl::string_view key) override {
+      auto itr = computed.find(key);
+      if (itr == computed.end()) {
+        return nullptr;
+      }
+      return std::make_unique<Ref>(itr->second);
+    }
     absl::StatusOr<Value> GetParam(const absl::string_view s) const override {
       if (params.find(s) != params.end()) {
         return Value(params.find(s)->second);
@@ -175,5 +186,129 @@ TEST_F(ExprTest, TypesTest) {
   }
 }
 
+TEST_F(ExprTest, BatchTest) {
+  std::vector<std::unique_ptr<Record>> records;
+  for (auto [one, two] : std::vector<std::pair<Value, Value>>{
+           {Value(1.0), Value(2.0)},
+           {Value(-3.5), Value(0.0)},
+           {Value(), Value(2.0)},
+           {Value(), Value()},
+           {Value(true), Value(false)},
+           {Value("12"), Value("abc")},
+           {Value(std::nan("")), Value(1.0)},
+       }) {
+    auto record = std::make_unique<Record>();
+    record->attrs["one"] = one;
+    record->attrs["two"] = two;
+    records.push_back(std::move(record));
+  }
+  std::vector<const Expression::Record*> batch;
+  for (auto& record : records) {
+    batch.push_back(record.get());
+  }
+  std::vector<std::string> expressions = {
+      "@one",
+      "@one+@two",
+      "@one-@two*2",
+      "@one/@two",
+      "@one^@two",
+      "@one<@two",
+      "@one<=@two",
+      "@one==@two",
+      "@one!=@two",
+      "@one>@two",
+      "@one>=@two",
+      "@one>1&&@two<3",
+      "@one||@two",
+      "!@one",
+      "!(@one==@two)",
+      "1+2",
+      "'x'",
+      "$one+@two",
+      "abs(@one)",
+      "floor(@one/@two)",
+      "exists(@one)",
+      "strlen('abc')",
+      "startswith(upper('ab'), 'A')",
+      "substr('abc', 1, 1)",
+      "@one+'1'",
+      "@one*@two+@one*@two",
+      "floor(@one)-floor(@one)",
+      "(@one<@two)==(@one<@two)",
+  };
+  Expression::EvalContext ec;
+  for (auto& text : expressions) {
+    auto e = Expression::Compile(cc, text);
+    ASSERT_TRUE(e.ok()) << text << ": " << e.status();
+    Column column;
+    (*e)->EvaluateBatch(ec, batch, column);
+    ASSERT_EQ(column.Size(), records.size());
+    for (size_t row = 0; row < records.size(); ++row) {
+      auto expected = (*e)->Evaluate(ec, *records[row]);
+      auto actual = column.Get(row);
+      EXPECT_EQ(actual.IsNil(), expected.IsNil()) << text << " row " << row;
+      EXPECT_EQ(actual.IsBool(), expected.IsBool()) << text << " row " << row;
+      EXPECT_EQ(actual.IsDouble(), expected.IsDouble())
+          << text << " row " << row;
+      EXPECT_EQ(actual.IsString(), expected.IsString())
+          << text << " row " << row;
+      EXPECT_EQ(actual, expected) << text << " row " << row;
+      EXPECT_EQ(column.IsTrue(row), expected.IsTrue())
+          << text << " row " << row;
+    }
+  }
+}
+
+TEST_F(ExprTest, OptimizeTest) {
+  std::vector<std::pair<std::string, std::string>> x = {
+      {"1+2*3", "Constant(Dble(7))"},
+      {"$one+1", "Constant(Dble(2))"},
+      {"!(1>2)", "Constant(Bool(true))"},
+      {"upper(concat('a', $two))", "Constant('A2')"},
+      {"@one+'2'", "(number(@one)+Constant(Dble(2)))"},
+      {"@one+'x'", "(number(@one)+Constant(Nil(ctor)))"},
+      {"floor(@two)", "floor(number(@two))"},
+      {"@one<@two", "(@one<@two)"},
+      {"@one*@one+@one*@one",
+       "let(#0=number(@one),#1=(#0*#0)) in (#1+#1)"},
+      {"strlen(lower(@one))+strlen(lower(@one))",
+       "let(#0=strlen(lower(@one))) in (#0+#0)"},
+  };
+  for (auto& [text, plan] : x) {
+    auto e = Expression::Compile(cc, text);
+    ASSERT_TRUE(e.ok()) << text << ": " << e.status();
+    std::ostringstream os;
+    (*e)->Dump(os);
+    EXPECT_EQ(os.str(), plan) << text;
+  }
+  auto left = Expression::Compile(cc, "(@one*@one+@one*@one)*2");
+  ASSERT_TRUE(left.ok());
+  auto right = Expression::Compile(cc, "( @one * @one + @one * @one ) * 2.0");
+  ASSERT_TRUE(right.ok());
+  EXPECT_EQ((*left)->Key(), (*right)->Key());
+  EXPECT_NE((*left)->Key(), (*Expression::Compile(cc, "@one*3"))->Key());
+  Expression::EvalContext ec;
+  EXPECT_EQ((*left)->Evaluate(ec, *record_), Value(4.0));
+}
+
+TEST_F(ExprTest, ReuseTest) {
+  auto e = Expression::Compile(cc, "@one*2");
+  ASSERT_TRUE(e.ok());
+  auto key = (*e)->Key();
+  cc.computed[key] = "two";
+  auto reused = Expression::Compile(cc, "@one*2+1");
+  ASSERT_TRUE(reused.ok());
+  std::ostringstream os;
+  (*reused)->Dump(os);
+  EXPECT_EQ(os.str(), "(@two+Constant(Dble(1)))");
+  cc.computed.clear();
+  auto computed = Expression::Compile(cc, "@one*2+1");
+  ASSERT_TRUE(computed.ok());
+  EXPECT_EQ((*reused)->Key(), (*computed)->Key());
+  Expression::EvalContext ec;
+  EXPECT_EQ((*reused)->Evaluate(ec, *record_),
+            (*computed)->Evaluate(ec, *record_));
+}
+
 }  // namespace expr
 }  // namespace valkey_search
@@ -7,7 +7,10 @@
 #include "src/expr/value.h"
 
 #include <cmath>
+#include <memory>
+#include <string>
 
+#include "absl/hash/hash.h"
 #include "gtest/gtest.h"
 
 namespace valkey_search::expr {
@@ -265,4 +268,33 @@ TEST_F(ValueTest, timetest) {
   EXPECT_EQ(FuncDay(ts), Value(1739491200));
   EXPECT_EQ(FuncMonth(ts), Value(1738281600));
 }
+TEST_F(ValueTest, string_storage) {
+  std::string short_string(Value::kInlineCapacity, 's');
+  std::string long_string(Value::kInlineCapacity + 1, 'l');
+  Arena arena;
+  for (auto arena_ptr : {static_cast<Arena*>(nullptr), &arena}) {
+    for (auto& s : {short_string, long_string}) {
+      auto v = Value::MakeString(s, arena_ptr);
+      EXPECT_TRUE(v.IsString());
+      EXPECT_EQ(v.GetStringView(), s);
+      EXPECT_EQ(v, Value(s));
+      EXPECT_EQ(absl::HashOf(v), absl::HashOf(Value(absl::string_view(s))));
+      // Copies don't reference the original's inline storage.
+      auto copy = std::make_unique<Value>(v);
+      v = Value();
+      EXPECT_EQ(copy->GetStringView(), s);
+    }
+  }
+  EXPECT_GT(arena.GetBytes(), 0);
+  EXPECT_EQ(FuncUpper(Value(long_string), &arena).GetStringView(),
+            std::string(long_string.size(), 'L'));
+
+  // Parts of referenced strings reference the same storage.
+  absl::string_view base("abcdef");
+  auto part = FuncSubstr(Value(base), Value(1), Value(2));
+  EXPECT_TRUE(part.IsStringView());
+  EXPECT_EQ(part.GetStringView().data(), base.data() + 1);
+  EXPECT_FALSE(
+      FuncSubstr(Value(std::string(base)), Value(1), Value(2)).IsStringView());
+}
 }  // namespace valkey_search::expr
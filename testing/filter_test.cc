@@ -15,6 +15,7 @@
 #include "src/indexes/tag.h"
 #include "src/indexes/vector_base.h"
 #include "src/query/predicate.h"
+#include "src/query/predicate_program.h"
 #include "src/utils/string_interning.h"
 #include "testing/common.h"
 namespace valkey_search {
@@ -107,6 +108,8 @@ TEST_P(FilterTest, ParseParams) {
   EXPECT_EQ(
       test_case.evaluate_success,
       evaluator_.Evaluate(*parse_results.value().root_predicate, interned_key));
+  query::PredicateProgram program(*parse_results.value().root_predicate);
+  EXPECT_EQ(test_case.evaluate_success, program.Evaluate(interned_key));
 }
 
 INSTANTIATE_TEST_SUITE_P(
@@ -6,9 +6,25 @@
 
 #include "src/commands/ft_aggregate_exec.h"
 
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/notification.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "src/commands/ft_aggregate_parser.h"
+#include "src/commands/ft_aggregate_partition.h"
+#include "src/indexes/numeric.h"
+#include "src/query/search.h"
+#include "src/utils/cancel.h"
+#include "src/utils/string_interning.h"
+#include "src/valkey_search_options.h"
+#include "testing/common.h"
 #include "vmsdk/src/testing_infra/utils.h"
+#include "vmsdk/src/thread_pool.h"
 
 namespace valkey_search {
 namespace aggregate {
@@ -246,7 +262,11 @@ TEST_F(AggregateExecTest, ReducerTest) {
       {"groupby 1 @n2 reduce sum 1 @n1", 4, {6}},
       {"groupby 1 @n2 reduce stddev 1 @n1", 4, {1.2909944487358056}},
       {"groupby 1 @n2 reduce count_distinct 1 @n1", 4, {4}},
-      {"groupby 1 @n2 reduce avg 1 @n1", 4, {1.5}}};
+      {"groupby 1 @n2 reduce avg 1 @n1", 4, {1.5}},
+      {"groupby 1 @n2 reduce count_distinctish 1 @n1", 4, {4}},
+      {"groupby 1 @n2 reduce quantile 2 @n1 0.5", 4, {1.5}},
+      {"groupby 1 @n2 reduce quantile 2 @n1 1 reduce quantile 2 @n1 0", 4,
+       {3, 0}}};
   for (auto& tc : testcases) {
     std::cerr << "GroupTest: " << tc.text_ << "\n";
     auto param = MakeStages(tc.text_);
@@ -264,6 +284,231 @@ TEST_F(AggregateExecTest, ReducerTest) {
     }
   }
 }
+
+TEST_F(AggregateExecTest, SortKeysTest) {
+  struct Testcase {
+    std::string text_;
+    std::vector<expr::Value> n1_;
+    std::vector<size_t> order_;
+  };
+  Testcase testcases[]{
+      {"sortby 2 @n1 asc",
+       {expr::Value(2.0), expr::Value(-0.0), expr::Value(-3.5),
+        expr::Value(0.0), expr::Value(true)},
+       {2, 1, 3, 4, 0}},
+      {"sortby 2 @n1 desc max 3",
+       {expr::Value(2.0), expr::Value(-0.0), expr::Value(-3.5),
+        expr::Value(0.0), expr::Value(1e300)},
+       {4, 0, 1}},
+      {"sortby 2 @n1 asc",
+       {expr::Value("b"), expr::Value("ab"), expr::Value(""),
+        expr::Value("a"), expr::Value("a\xff")},
+       {2, 3, 1, 4, 0}},
+      {"sortby 4 @n1 desc @n2 asc",
+       {expr::Value("b"), expr::Value("ab"), expr::Value("b"),
+        expr::Value("a"), expr::Value("ab")},
+       {2, 0, 4, 1, 3}},
+      {"sortby 2 @n1 asc max 4",
+       {expr::Value("2"), expr::Value(3.0), expr::Value("10"),
+        expr::Value(1.0), expr::Value(2.0)},
+       {3, 0, 4, 1}},
+  };
+  for (auto& tc : testcases) {
+    std::cerr << "SortKeysTest: " << tc.text_ << "\n";
+    auto param = MakeStages(tc.text_);
+    RecordSet records(nullptr);
+    for (size_t i = 0; i < tc.n1_.size(); ++i) {
+      auto record = std::make_unique<Record>(2);
+      record->fields_[0] = tc.n1_[i];
+      record->fields_[1] = expr::Value(double(tc.n1_.size() - i));
+      records.push_back(std::move(record));
+    }
+    EXPECT_TRUE((param->stages_[0]->Execute(records)).ok());
+    ASSERT_EQ(records.size(), tc.order_.size());
+    for (size_t i = 0; i < tc.order_.size(); ++i) {
+      EXPECT_EQ(records[i]->fields_[1],
+                expr::Value(double(tc.n1_.size() - tc.order_[i])))
+          << " at " << i;
+    }
+  }
+}
+
+TEST_F(AggregateExecTest, MergeSortTest) {
+  constexpr size_t kRecords = 1000;
+  auto param = MakeStages("sortby 4 @n2 desc @n1 asc max 100000");
+  auto sort_by = dynamic_cast<const SortBy*>(param->stages_[0].get());
+  ASSERT_NE(sort_by, nullptr);
+  auto make_records = [&]() {
+    RecordSet records(nullptr);
+    for (size_t i = 0; i < kRecords; ++i) {
+      records.emplace_back(RecordNOfM((i * 7919) % kRecords, i % 13));
+    }
+    return records;
+  };
+  auto expected = make_records();
+  sort_by->Sort(expected, 1, nullptr);
+  ASSERT_EQ(expected.size(), kRecords);
+  for (size_t i = 1; i < kRecords; ++i) {
+    auto& l = expected[i - 1]->fields_;
+    auto& r = expected[i]->fields_;
+    EXPECT_TRUE(l[1] > r[1] || (l[1] == r[1] && l[0] < r[0])) << " at " << i;
+  }
+  for (size_t slices : {2, 3, 8}) {
+    auto records = make_records();
+    sort_by->Sort(records, slices, nullptr);
+    ASSERT_EQ(records.size(), kRecords);
+    for (size_t i = 0; i < kRecords; ++i) {
+      EXPECT_EQ(*records[i], *expected[i]);
+    }
+  }
+}
+
+TEST_F(AggregateExecTest, PartitionedGroupByTest) {
+  std::string testcases[]{
+      "groupby 1 @n2 reduce count 0 as c reduce sum 1 @n1 as s",
+      "groupby 2 @n1 @n2 reduce min 1 @n1 as lo reduce max 1 @n1 as hi",
+      "groupby 1 @n2 reduce count_distinct 1 @n1 as cd reduce stddev 1 @n1 "
+      "as sd",
+      "groupby 1 @n2 reduce count_distinctish 1 @n1 as cd reduce quantile 2 "
+      "@n1 0.5 as q",
+  };
+  constexpr size_t kRecords = 100;
+  auto sorted_strings = [](RecordSet& records) {
+    std::vector<std::string> result;
+    for (auto& record : records) {
+      std::ostringstream os;
+      os << *record;
+      result.push_back(os.str());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  vmsdk::ThreadPool pool("partitioned-groupby-", 4);
+  pool.StartWorkers();
+  for (auto& text : testcases) {
+    std::cerr << "PartitionedGroupByTest: " << text << "\n";
+    auto param = MakeStages(text);
+    auto group_by = dynamic_cast<const GroupBy*>(param->stages_[0].get());
+    ASSERT_NE(group_by, nullptr);
+    auto make_records = [&]() {
+      RecordSet records(param.get());
+      for (auto i = 0; i < kRecords; ++i) {
+        auto record =
+            std::make_unique<Record>(param->record_info_by_index_.size());
+        record->fields_[0] = expr::Value(double(i % 17));
+        record->fields_[1] = expr::Value(double(i % 7));
+        records.push_back(std::move(record));
+      }
+      return records;
+    };
+    auto serial = make_records();
+    VMSDK_EXPECT_OK(group_by->Execute(serial));
+    for (auto reduce_pool : {static_cast<vmsdk::ThreadPool*>(nullptr), &pool}) {
+      for (size_t partitions : {1, 3, 8}) {
+        auto records = make_records();
+        GroupBy::Groups groups;
+        auto field_count = group_by->ReducePartitioned(records, groups,
+                                                       partitions, reduce_pool);
+        EXPECT_TRUE(records.empty());
+        group_by->Emit(groups, field_count, records);
+        EXPECT_EQ(sorted_strings(records), sorted_strings(serial));
+      }
+    }
+    // Called from a thread of the pool, as on the reader threads, while the
+    // other threads are busy.
+    auto records = make_records();
+    GroupBy::Groups groups;
+    size_t field_count = 0;
+    absl::Notification reduced;
+    absl::Notification release_busy;
+    for (size_t i = 1; i < pool.Size(); ++i) {
+      pool.Schedule([&release_busy]() { release_busy.WaitForNotification(); },
+                    vmsdk::ThreadPool::Priority::kHigh);
+    }
+    pool.Schedule(
+        [&]() {
+          field_count = group_by->ReducePartitioned(records, groups, 8, &pool);
+          reduced.Notify();
+        },
+        vmsdk::ThreadPool::Priority::kHigh);
+    reduced.WaitForNotification();
+    release_busy.Notify();
+    EXPECT_TRUE(records.empty());
+    group_by->Emit(groups, field_count, records);
+    EXPECT_EQ(sorted_strings(records), sorted_strings(serial));
+  }
+  VMSDK_EXPECT_OK(pool.MarkForStop(vmsdk::ThreadPool::StopMode::kGraceful));
+  pool.JoinWorkers();
+}
+
+TEST_F(AggregateExecTest, PartitionTest) {
+  struct Testcase {
+    std::string text_;
+    size_t partition_stages_;
+  };
+  Testcase testcases[]{
+      {"filter @n1>1", 1},
+      {"apply @n1*2 as d", 1},
+      {"groupby 1 @n2 reduce count 0 as c reduce sum 1 @n1 as s reduce min 1 "
+       "@n1 as lo reduce max 1 @n1 as hi reduce avg 1 @n1 as a reduce stddev "
+       "1 @n1 as sd",
+       1},
+      {"sortby 2 @n1 desc max 3", 1},
+      {"filter @n1>2 groupby 1 @n2 reduce sum 1 @n1 as s sortby 2 @s desc", 2},
+      {"apply @n1*2 as d filter @d>4 limit 0 3", 2},
+      {"groupby 1 @n2 reduce count_distinct 1 @n1 as cd", 0},
+      {"limit 1 4", 0},
+  };
+  constexpr size_t kRecords = 12;
+  constexpr size_t kPartitions = 3;
+  for (auto& tc : testcases) {
+    std::cerr << "PartitionTest: " << tc.text_ << "\n";
+    auto param = MakeStages(tc.text_);
+    param->cancellation_token = cancel::Make(100000, nullptr);
+    EXPECT_EQ(PartitionStageCount(*param), tc.partition_stages_);
+    auto make_record = [&](size_t i) {
+      auto record =
+          std::make_unique<Record>(param->record_info_by_index_.size());
+      record->fields_[0] = expr::Value(double(i));
+      record->fields_[1] = expr::Value(double(i % 3));
+      return record;
+    };
+    auto sorted_strings = [](RecordSet& records) {
+      std::vector<std::string> result;
+      for (auto& record : records) {
+        std::ostringstream os;
+        os << *record;
+        result.push_back(os.str());
+      }
+      std::sort(result.begin(), result.end());
+      return result;
+    };
+
+    RecordSet local(param.get());
+    for (auto i = 0; i < kRecords; ++i) {
+      local.push_back(make_record(i));
+    }
+    VMSDK_EXPECT_OK(param->ExecuteStages(local, 0, param->stages_.size()));
+
+    RecordSet merged(param.get());
+    GroupBy::Groups groups;
+    for (auto partition = 0; partition < kPartitions; ++partition) {
+      RecordSet records(param.get());
+      for (auto i = partition * kRecords / kPartitions;
+           i < (partition + 1) * kRecords / kPartitions; ++i) {
+        records.push_back(make_record(i));
+      }
+      coordinator::AggregateIndexPartitionResponse response;
+      VMSDK_EXPECT_OK(ExecutePartitionStages(*param, records,
+                                             tc.partition_stages_, response));
+      VMSDK_EXPECT_OK(MergePartitionResults(*param, tc.partition_stages_,
+                                            response, merged, groups));
+    }
+    VMSDK_EXPECT_OK(
+        FinishPartitionResults(*param, tc.partition_stages_, merged, groups));
+    EXPECT_EQ(sorted_strings(merged), sorted_strings(local));
+  }
+}
 /*
 TEST_F(AggregateExecTest, testHash) {
   GroupKey key1({expr::Value(1.0), expr::Value(2.0)});
@@ -280,5 +525,167 @@ TEST_F(AggregateExecTest, testHash) {
   }));
 }
 */
+
+class AggregatePrepareReplyTest : public ValkeySearchTest {};
+
+TEST_F(AggregatePrepareReplyTest, StopsBetweenStagesWhenCancelled) {
+  FakeIndexInterface fake_index;
+  fake_index.fields_ = {{"n1", indexes::IndexerType::kNumeric}};
+  auto argv = vmsdk::ToValkeyStringVector("LIMIT 0 1");
+  vmsdk::ArgsIterator itr(argv.data(), argv.size());
+  AggregateParameters params(0);
+  params.parse_vars_.index_interface_ = &fake_index;
+  auto parser = CreateAggregateParser();
+  VMSDK_EXPECT_OK(parser.Parse(params, itr));
+  params.index_schema = CreateIndexSchema("index_schema_name").value();
+  params.cancellation_token = cancel::Make(100000, nullptr);
+  std::deque<indexes::Neighbor> neighbors;
+  VMSDK_EXPECT_OK(params.PrepareReply(neighbors));
+  EXPECT_TRUE(params.records_->empty());
+
+  params.cancellation_token->Cancel();
+  EXPECT_EQ(params.PrepareReply(neighbors).code(),
+            absl::StatusCode::kDeadlineExceeded);
+}
+
+TEST_F(AggregatePrepareReplyTest, BoundsTheRecordsOfCursors) {
+  FakeIndexInterface fake_index;
+  fake_index.fields_ = {{"n1", indexes::IndexerType::kNumeric}};
+  auto argv = vmsdk::ToValkeyStringVector("WITHCURSOR COUNT 1");
+  vmsdk::ArgsIterator itr(argv.data(), argv.size());
+  AggregateParameters params(0);
+  params.parse_vars_.index_interface_ = &fake_index;
+  auto parser = CreateAggregateParser();
+  VMSDK_EXPECT_OK(parser.Parse(params, itr));
+  params.index_schema = CreateIndexSchema("index_schema_name").value();
+  params.cancellation_token = cancel::Make(100000, nullptr);
+  std::deque<indexes::Neighbor> neighbors;
+  for (auto key : {"a", "b", "c"}) {
+    neighbors.emplace_back(StringInternStore::Intern(key), 0.0f);
+  }
+  VMSDK_EXPECT_OK(options::GetCursorMaxMemory().SetValue(0));
+  EXPECT_EQ(params.PrepareReply(neighbors).code(),
+            absl::StatusCode::kResourceExhausted);
+  // Records which fit in the first reply stay out of any cursor.
+  params.cursor_count_ = 3;
+  VMSDK_EXPECT_OK(params.PrepareReply(neighbors));
+  EXPECT_EQ(params.records_->size(), 3);
+  VMSDK_EXPECT_OK(options::GetCursorMaxMemory().SetValue(256ll << 20));
+}
+
+TEST_F(AggregatePrepareReplyTest, VerifiesIndexedLoadsOfMutatedKeys) {
+  auto index_schema =
+      CreateIndexSchema("index_schema_name", &fake_ctx_).value();
+  auto numeric_index =
+      std::make_shared<indexes::Numeric>(CreateNumericIndexProto());
+  VMSDK_EXPECT_OK(index_schema->AddIndex("price", "price", numeric_index));
+  auto unchanged_key = StringInternStore::Intern("prefix:unchanged");
+  auto changed_key = StringInternStore::Intern("prefix:changed");
+  auto moved_key = StringInternStore::Intern("prefix:moved");
+  VMSDK_EXPECT_OK(numeric_index->AddRecord(unchanged_key, "5"));
+  VMSDK_EXPECT_OK(numeric_index->AddRecord(changed_key, "5"));
+  VMSDK_EXPECT_OK(numeric_index->AddRecord(moved_key, "5"));
+
+  auto argv = vmsdk::ToValkeyStringVector("LOAD 2 __key @price");
+  vmsdk::ArgsIterator itr(argv.data(), argv.size());
+  AggregateParameters params(0);
+  params.index_schema = index_schema;
+  params.parse_vars.query_string = "@price:[0 10]";
+  VMSDK_EXPECT_OK(params.ParseCommand(itr));
+  params.cancellation_token = cancel::Make(100000, nullptr);
+  EXPECT_TRUE(params.reads_indexed_content);
+  auto neighbors = query::Search(params, query::SearchMode::kLocal);
+  VMSDK_EXPECT_OK(neighbors);
+  EXPECT_EQ(neighbors->size(), 3);
+
+  // Between the search and the reply, the changed key leaves the filter while
+  // the moved key stays within it.
+  EXPECT_CALL(*kMockValkeyModule, KeyType(testing::_))
+      .WillRepeatedly(testing::Return(VALKEYMODULE_KEYTYPE_HASH));
+  std::string price;
+  EXPECT_CALL(*kMockValkeyModule,
+              HashGet(testing::_, VALKEYMODULE_HASH_CFIELDS,
+                      testing::StrEq("price"),
+                      testing::An<ValkeyModuleString**>(),
+                      testing::TypedEq<void*>(nullptr)))
+      .WillRepeatedly([&price](ValkeyModuleKey* key, int flags,
+                               const char* field,
+                               ValkeyModuleString** value_out,
+                               void* terminating_null) {
+        *value_out =
+            TestValkeyModule_CreateStringPrintf(nullptr, "%s", price.c_str());
+        return VALKEYMODULE_OK;
+      });
+  for (const auto& [key, new_price] :
+       {std::make_pair(changed_key, "50"), std::make_pair(moved_key, "7")}) {
+    price = new_price;
+    auto key_str = vmsdk::MakeUniqueValkeyString(key->Str());
+    index_schema->OnKeyspaceNotification(&fake_ctx_, VALKEYMODULE_NOTIFY_HASH,
+                                         "hset", key_str.get());
+  }
+  EXPECT_EQ(*numeric_index->GetValue(changed_key), 50);
+  EXPECT_EQ(*numeric_index->GetValue(moved_key), 7);
+
+  VMSDK_EXPECT_OK(params.PrepareReply(*neighbors));
+  ASSERT_EQ(params.records_->size(), 2);
+  absl::flat_hash_map<std::string, expr::Value> prices;
+  while (!params.records_->empty()) {
+    auto rec = params.records_->pop_front();
+    prices.emplace(rec->fields_[0].AsStringView(),
+                   rec->fields_[params.record_indexes_by_alias_.at("price")]);
+  }
+  EXPECT_THAT(prices,
+              testing::UnorderedElementsAre(
+                  testing::Pair(unchanged_key->Str(), expr::Value(5.0)),
+                  testing::Pair(moved_key->Str(), expr::Value(7.0))));
+}
+
+TEST_F(AggregatePrepareReplyTest, LoadsSortableValuesAsWritten) {
+  auto index_schema =
+      CreateIndexSchema("index_schema_name", &fake_ctx_).value();
+  auto numeric_index =
+      std::make_shared<indexes::Numeric>(CreateNumericIndexProto());
+  VMSDK_EXPECT_OK(
+      index_schema->AddIndex("price", "price", numeric_index, true));
+  auto key = StringInternStore::Intern("prefix:key");
+  EXPECT_CALL(*kMockValkeyModule, KeyType(testing::_))
+      .WillRepeatedly(testing::Return(VALKEYMODULE_KEYTYPE_HASH));
+  EXPECT_CALL(*kMockValkeyModule,
+              HashGet(testing::_, VALKEYMODULE_HASH_CFIELDS,
+                      testing::StrEq("price"),
+                      testing::An<ValkeyModuleString**>(),
+                      testing::TypedEq<void*>(nullptr)))
+      .WillRepeatedly([](ValkeyModuleKey* key, int flags, const char* field,
+                         ValkeyModuleString** value_out,
+                         void* terminating_null) {
+        *value_out = TestValkeyModule_CreateStringPrintf(nullptr, "5.50");
+        return VALKEYMODULE_OK;
+      });
+  auto key_str = vmsdk::MakeUniqueValkeyString(key->Str());
+  index_schema->OnKeyspaceNotification(&fake_ctx_, VALKEYMODULE_NOTIFY_HASH,
+                                       "hset", key_str.get());
+  ASSERT_NE(index_schema->GetStoredField("price"), nullptr);
+  EXPECT_EQ(index_schema->GetStoredField("price")->Get(key)->Str(), "5.50");
+  // The index alone moves, so the loaded value can only come from the stored
+  // field.
+  VMSDK_EXPECT_OK(numeric_index->ModifyRecord(key, "6"));
+
+  auto argv = vmsdk::ToValkeyStringVector("LOAD 1 @price");
+  vmsdk::ArgsIterator itr(argv.data(), argv.size());
+  AggregateParameters params(0);
+  params.index_schema = index_schema;
+  params.parse_vars.query_string = "@price:[0 10]";
+  VMSDK_EXPECT_OK(params.ParseCommand(itr));
+  params.cancellation_token = cancel::Make(100000, nullptr);
+  EXPECT_TRUE(params.reads_indexed_content);
+  auto neighbors = query::Search(params, query::SearchMode::kLocal);
+  VMSDK_EXPECT_OK(neighbors);
+  VMSDK_EXPECT_OK(params.PrepareReply(*neighbors));
+  ASSERT_EQ(params.records_->size(), 1);
+  auto rec = params.records_->pop_front();
+  EXPECT_EQ(rec->fields_[params.record_indexes_by_alias_.at("price")],
+            expr::Value(5.5));
+}
+
 }  // namespace aggregate
 }  // namespace valkey_search
@@ -7,6 +7,7 @@
 #include "src/commands/ft_aggregate_parser.h"
 
 #include <map>
+#include <optional>
 
 #include "gtest/gtest.h"
 #include "vmsdk/src/testing_infra/utils.h"
@@ -261,5 +262,48 @@ TEST_F(AggregateTest, StageParserTest) {
   }
 }
 
+static struct WithCursorTestValue {
+  const char *text_;
+  bool ok_;
+  uint32_t count_;
+  std::optional<uint32_t> max_idle_ms_;
+} WithCursorCases[]{
+    {"WITHCURSOR", true, AggregateParameters::kDefaultCursorCount,
+     std::nullopt},
+    {"withcursor count 10", true, 10, std::nullopt},
+    {"WITHCURSOR MAXIDLE 500", true, AggregateParameters::kDefaultCursorCount,
+     500},
+    {"WITHCURSOR MaxIdle 500 COUNT 7", true, 7, 500},
+    {"WITHCURSOR COUNT 7 LIMIT 0 10", true, 7, std::nullopt},
+    {"WITHCURSOR COUNT", false, 0, std::nullopt},
+    {"WITHCURSOR COUNT 0", false, 0, std::nullopt},
+    {"WITHCURSOR COUNT fred", false, 0, std::nullopt},
+    {"WITHCURSOR MAXIDLE", false, 0, std::nullopt},
+};
+
+TEST_F(AggregateTest, WithCursorParserTest) {
+  for (const auto &test : WithCursorCases) {
+    std::cerr << "Running test: '" << test.text_ << "'\n";
+    auto argv = vmsdk::ToValkeyStringVector(test.text_);
+    vmsdk::ArgsIterator itr(argv.data(), argv.size());
+
+    AggregateParameters params(0);
+    params.parse_vars_.index_interface_ = &fake_index;
+
+    auto parser = CreateAggregateParser();
+    auto result = parser.Parse(params, itr);
+    EXPECT_EQ(result.ok(), test.ok_) << " Status: " << result;
+    if (test.ok_) {
+      EXPECT_TRUE(params.with_cursor_);
+      EXPECT_EQ(params.cursor_count_, test.count_);
+      EXPECT_EQ(params.cursor_max_idle_ms_, test.max_idle_ms_);
+    }
+    // Need to manually free the string vector
+    for (auto arg : argv) {
+      ValkeyModule_FreeString(nullptr, arg);
+    }
+  }
+}
+
 }  // namespace aggregate
 }  // namespace valkey_search
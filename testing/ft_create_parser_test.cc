@@ -32,6 +32,7 @@ struct AttributeParameters {
   absl::string_view identifier;
   absl::string_view attribute_alias;
   indexes::IndexerType indexer_type{indexes::IndexerType::kNone};
+  bool sortable{false};
 };
 
 struct FTCreateParameters {
@@ -108,6 +109,8 @@ TEST_P(FTCreateParserTest, ParseParams) {
                 test_case.expected.attributes[i].identifier);
       EXPECT_EQ(index_schema_proto->attributes(i).alias(),
                 test_case.expected.attributes[i].attribute_alias);
+      EXPECT_EQ(index_schema_proto->attributes(i).sortable(),
+                test_case.expected.attributes[i].sortable);
       if (test_case.expected.attributes[i].indexer_type ==
           indexes::IndexerType::kFlat) {
         EXPECT_TRUE(index_schema_proto->attributes(i)
@@ -563,6 +566,20 @@ INSTANTIATE_TEST_SUITE_P(
                               .indexer_type = indexes::IndexerType::kNumeric,
                           }}},
          },
+         {
+             .test_name = "happy_path_sortable_numeric_index_on_hash",
+             .success = true,
+             .command_str = "idx1 on HASH SChema hash_field1 as "
+                            "hash_field11 numeric SORTABLE ",
+             .expected = {.index_schema_name = "idx1",
+                          .on_data_type = data_model::ATTRIBUTE_DATA_TYPE_HASH,
+                          .attributes = {{
+                              .identifier = "hash_field1",
+                              .attribute_alias = "hash_field11",
+                              .indexer_type = indexes::IndexerType::kNumeric,
+                              .sortable = true,
+                          }}},
+         },
          {
              .test_name = "happy_path_tag_index_on_hash",
              .success = true,
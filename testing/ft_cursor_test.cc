@@ -0,0 +1,162 @@
+/*
+ * Copyright Valkey Contributors.
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ */
+
+#include "src/commands/ft_cursor.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "src/attribute_data_type.h"
+#include "src/commands/ft_aggregate_exec.h"
+#include "src/utils/string_interning.h"
+#include "vmsdk/src/managed_pointers.h"
+#include "vmsdk/src/testing_infra/utils.h"
+
+namespace valkey_search {
+namespace aggregate {
+
+static std::unique_ptr<Cursor> MakeCursor(
+    size_t m, absl::string_view index, uint32_t db_num = 0,
+    absl::Duration max_idle = absl::Seconds(10)) {
+  auto records = std::make_unique<RecordSet>(nullptr);
+  for (size_t i = 0; i < m; ++i) {
+    auto rec = std::make_unique<Record>(2);
+    rec->fields_[0] = expr::Value(double(i));
+    rec->fields_[1] = expr::Value(std::string(100, 'a' + i % 26));
+    records->push_back(std::move(rec));
+  }
+  return std::make_unique<Cursor>(std::string(index), db_num, ReplyFormat{},
+                                  std::move(records),
+                                  std::deque<indexes::Neighbor>(), 2,
+                                  max_idle);
+}
+
+class CursorTest : public vmsdk::ValkeyTest {};
+
+TEST_F(CursorTest, Take) {
+  auto cursor = MakeCursor(5, "idx");
+  auto memory = cursor->GetMemory();
+  EXPECT_GT(memory, 5 * 100);
+
+  auto chunk = cursor->Take(2);
+  ASSERT_EQ(chunk.size(), 2);
+  EXPECT_EQ(chunk[0]->fields_[0], expr::Value(0.0));
+  EXPECT_EQ(chunk[1]->fields_[0], expr::Value(1.0));
+  EXPECT_FALSE(cursor->Exhausted());
+
+  chunk = cursor->Take(10);
+  ASSERT_EQ(chunk.size(), 3);
+  EXPECT_EQ(chunk[0]->fields_[0], expr::Value(2.0));
+  EXPECT_TRUE(cursor->Exhausted());
+  // The memory is only freed with the whole cursor.
+  EXPECT_EQ(cursor->GetMemory(), memory);
+}
+
+TEST_F(CursorTest, MemoryOfNeighborsAndArena) {
+  auto records = std::make_unique<RecordSet>(nullptr);
+  std::deque<indexes::Neighbor> neighbors;
+  auto key = StringInternStore::Intern(std::string(200, 'k'));
+  RecordsMap contents;
+  contents.emplace("field",
+                   RecordsMapValue(vmsdk::MakeUniqueValkeyString("field"),
+                                   vmsdk::MakeUniqueValkeyString(
+                                       std::string(300, 'v'))));
+  neighbors.emplace_back(key, 0.0f, std::move(contents));
+  auto rec = std::make_unique<Record>(2);
+  // Views of the key and the arena aren't counted again by the record.
+  rec->fields_[0] = expr::Value(key->Str());
+  rec->fields_[1] =
+      expr::Value::MakeString(std::string(100, 'a'), &records->arena_);
+  auto record_memory = Cursor::RecordMemory(*rec);
+  EXPECT_EQ(record_memory,
+            sizeof(Record) + rec->fields_.capacity() * sizeof(expr::Value));
+  records->push_back(std::move(rec));
+  auto neighbor_memory = Cursor::NeighborMemory(neighbors.front());
+  EXPECT_GT(neighbor_memory, 200 + 300);
+  auto arena_memory = records->arena_.GetBytes();
+  EXPECT_GT(arena_memory, 100);
+
+  Cursor cursor("idx", 0, ReplyFormat{}, std::move(records),
+                std::move(neighbors), 2, absl::Seconds(10));
+  EXPECT_EQ(cursor.GetMemory(),
+            record_memory + neighbor_memory + arena_memory);
+}
+
+TEST_F(CursorTest, FindAndErase) {
+  CursorStore store;
+  auto now = absl::Now();
+  auto id = store.Add(MakeCursor(3, "idx", 1), 1 << 20, now);
+  ASSERT_TRUE(id.ok());
+  EXPECT_NE(*id, 0);
+  EXPECT_EQ(store.Size(), 1);
+
+  EXPECT_EQ(store.Find(1, "other", *id, now), nullptr);
+  EXPECT_EQ(store.Find(0, "idx", *id, now), nullptr);
+  EXPECT_EQ(store.Find(1, "idx", *id + 1, now), nullptr);
+  auto cursor = store.Find(1, "idx", *id, now);
+  ASSERT_NE(cursor, nullptr);
+  EXPECT_EQ(cursor->GetCount(), 2);
+
+  EXPECT_FALSE(store.Erase(1, "other", *id));
+  EXPECT_TRUE(store.Erase(1, "idx", *id));
+  EXPECT_FALSE(store.Erase(1, "idx", *id));
+  EXPECT_EQ(store.Size(), 0);
+}
+
+TEST_F(CursorTest, ExpireIdle) {
+  CursorStore store;
+  auto now = absl::Now();
+  auto id = store.Add(MakeCursor(3, "idx", 0, absl::Seconds(10)), 1 << 20,
+                      now);
+  ASSERT_TRUE(id.ok());
+  // Reading restarts the idle time.
+  EXPECT_NE(store.Find(0, "idx", *id, now + absl::Seconds(8)), nullptr);
+  EXPECT_NE(store.Find(0, "idx", *id, now + absl::Seconds(16)), nullptr);
+  EXPECT_EQ(store.Find(0, "idx", *id, now + absl::Seconds(27)), nullptr);
+  EXPECT_EQ(store.Size(), 0);
+}
+
+TEST_F(CursorTest, MaxMemory) {
+  CursorStore store;
+  auto now = absl::Now();
+  auto cursor = MakeCursor(4, "idx");
+  auto memory = cursor->GetMemory();
+  auto max_memory = memory * 3 / 2;
+  auto id = store.Add(std::move(cursor), max_memory, now);
+  ASSERT_TRUE(id.ok());
+  EXPECT_EQ(store.GetMemory(), memory);
+
+  auto full = store.Add(MakeCursor(4, "idx"), max_memory, now);
+  EXPECT_EQ(full.status().code(), absl::StatusCode::kResourceExhausted);
+  EXPECT_EQ(store.Size(), 1);
+
+  // Reading doesn't release memory, deleting does.
+  store.Find(0, "idx", *id, now)->Take(2);
+  EXPECT_EQ(store.GetMemory(), memory);
+  EXPECT_FALSE(store.Add(MakeCursor(4, "idx"), max_memory, now).ok());
+  EXPECT_TRUE(store.Erase(0, "idx", *id));
+  EXPECT_EQ(store.GetMemory(), 0);
+  EXPECT_TRUE(store.Add(MakeCursor(4, "idx"), max_memory, now).ok());
+  EXPECT_EQ(store.Size(), 1);
+
+  // Idle cursors are dropped to make room.
+  auto later = now + absl::Seconds(11);
+  EXPECT_TRUE(store.Add(MakeCursor(4, "idx"), max_memory, later).ok());
+  EXPECT_EQ(store.Size(), 1);
+  EXPECT_EQ(store.GetMemory(), memory);
+
+  // And by the cron, without any cursor command.
+  store.ExpireIdle(later + absl::Seconds(11));
+  EXPECT_EQ(store.Size(), 0);
+  EXPECT_EQ(store.GetMemory(), 0);
+}
+
+}  // namespace aggregate
+}  // namespace valkey_search
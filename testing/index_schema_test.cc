@@ -10,20 +10,27 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -37,6 +44,7 @@
 #include "src/keyspace_event_manager.h"
 #include "src/metrics.h"
 #include "src/schema_manager.h"
+#include "src/stored_field.h"
 #include "src/utils/string_interning.h"
 #include "src/valkey_search_options.h"
 #include "testing/common.h"
@@ -670,6 +678,331 @@ TEST_P(IndexSchemaSubscriptionSimpleTest, DropIndexPrematurely) {
             0);
 }
 
+class IndexSchemaMutationBatchTest : public ValkeySearchTest {
+ protected:
+  // Serves the keyspace notifications of hash keys: the writing client is
+  // blocked until its mutations are applied, and each of `fields` is read
+  // through `read_field`, which returns std::nullopt for a missing field.
+  void ExpectHashMutations(
+      const std::vector<std::string> &fields,
+      std::function<std::optional<std::string>(absl::string_view field)>
+          read_field) {
+    EXPECT_CALL(*kMockValkeyModule, KeyType(testing::_))
+        .WillRepeatedly(Return(VALKEYMODULE_KEYTYPE_HASH));
+    EXPECT_CALL(*kMockValkeyModule, GetClientId(testing::_))
+        .WillRepeatedly(testing::Return(1));
+    EXPECT_CALL(
+        *kMockValkeyModule,
+        BlockClient(testing::_, testing::_, testing::_, testing::_, testing::_))
+        .WillRepeatedly(Return((ValkeyModuleBlockedClient *)1));
+    EXPECT_CALL(*kMockValkeyModule,
+                UnblockClient((ValkeyModuleBlockedClient *)1, nullptr))
+        .WillRepeatedly(Return(1));
+    for (const auto &field : fields) {
+      EXPECT_CALL(*kMockValkeyModule,
+                  HashGet(testing::_, VALKEYMODULE_HASH_CFIELDS, StrEq(field),
+                          An<ValkeyModuleString **>(),
+                          TypedEq<void *>(nullptr)))
+          .WillRepeatedly([read_field](ValkeyModuleKey *key, int flags,
+                                       const char *field,
+                                       ValkeyModuleString **value_out,
+                                       void *terminating_null) {
+            auto content = read_field(field);
+            *value_out = content.has_value()
+                             ? TestValkeyModule_CreateStringPrintf(
+                                   nullptr, "%s", content->c_str())
+                             : nullptr;
+            return VALKEYMODULE_OK;
+          });
+    }
+  }
+};
+
+// Applies the mutations inline or on a writer thread pool.
+class IndexSchemaMutationTest : public IndexSchemaMutationBatchTest,
+                                public testing::WithParamInterface<bool> {};
+
+TEST_F(IndexSchemaMutationBatchTest, BatchedMutations) {
+  // Keys mutated while the writer thread is busy are applied by a single task,
+  // in one batch.
+  vmsdk::ThreadPool mutations_thread_pool("writer-thread-pool-", 1);
+  mutations_thread_pool.StartWorkers();
+  VMSDK_EXPECT_OK(mutations_thread_pool.SuspendWorkers());
+  std::vector<absl::string_view> key_prefixes = {"prefix:"};
+  std::string index_schema_name_str("index_schema_name");
+  auto index_schema =
+      MockIndexSchema::Create(&fake_ctx_, index_schema_name_str, key_prefixes,
+                              std::make_unique<HashAttributeDataType>(),
+                              &mutations_thread_pool)
+          .value();
+  auto mock_index = std::make_shared<MockIndex>();
+  VMSDK_EXPECT_OK(
+      index_schema->AddIndex("attribute_name", "vector", mock_index));
+
+  ExpectHashMutations({"vector"}, [](absl::string_view field) {
+    return std::optional<std::string>("vector_buffer");
+  });
+  EXPECT_CALL(*mock_index, IsTracked(testing::_))
+      .WillRepeatedly(Return(false));
+  constexpr int kKeys = 5;
+  EXPECT_CALL(*mock_index, AddRecord(testing::_, testing::_))
+      .Times(kKeys)
+      .WillRepeatedly(Return(true));
+
+  auto &metrics = Metrics::GetStats();
+  uint64_t initial_batches = metrics.ingest_total_batches;
+  uint64_t initial_batched_keys = metrics.ingest_total_batched_keys;
+  for (int i = 0; i < kKeys; ++i) {
+    auto key = vmsdk::MakeUniqueValkeyString(absl::StrCat("prefix:", i));
+    index_schema->OnKeyspaceNotification(&fake_ctx_, VALKEYMODULE_NOTIFY_HASH,
+                                         "event", key.get());
+  }
+  EXPECT_EQ(mutations_thread_pool.QueueSize(), 1);
+  VMSDK_EXPECT_OK(mutations_thread_pool.ResumeWorkers());
+  WaitWorkerTasksAreCompleted(mutations_thread_pool);
+  EXPECT_EQ(metrics.ingest_total_batches, initial_batches + 1);
+  EXPECT_EQ(metrics.ingest_total_batched_keys, initial_batched_keys + kKeys);
+  EXPECT_EQ(metrics.ingest_last_batch_size, kKeys);
+  EXPECT_EQ(index_schema->GetStats().document_cnt, kKeys);
+  {
+    absl::MutexLock lock(&index_schema->GetStats().mutex_);
+    EXPECT_EQ(index_schema->GetStats().mutation_queue_size_, 0);
+  }
+  EXPECT_EQ(vmsdk::BlockedClientTracker::GetInstance().GetClientCount(
+                vmsdk::BlockedClientCategory::kHash),
+            0);
+}
+
+TEST_F(IndexSchemaMutationBatchTest, ParallelAttributeMutations) {
+  // With a vector attribute among several, each attribute's index is updated
+  // by a writer thread of its own, and each document is counted once.
+  vmsdk::ThreadPool mutations_thread_pool("writer-thread-pool-", 2);
+  mutations_thread_pool.StartWorkers();
+  VMSDK_EXPECT_OK(mutations_thread_pool.SuspendWorkers());
+  std::vector<absl::string_view> key_prefixes = {"prefix:"};
+  std::string index_schema_name_str("index_schema_name");
+  auto index_schema =
+      MockIndexSchema::Create(&fake_ctx_, index_schema_name_str, key_prefixes,
+                              std::make_unique<HashAttributeDataType>(),
+                              &mutations_thread_pool)
+          .value();
+  auto vector_index = std::make_shared<MockIndex>(indexes::IndexerType::kHNSW);
+  auto numeric_index =
+      std::make_shared<MockIndex>(indexes::IndexerType::kNumeric);
+  VMSDK_EXPECT_OK(index_schema->AddIndex("vector", "vector", vector_index));
+  VMSDK_EXPECT_OK(index_schema->AddIndex("numeric", "numeric", numeric_index));
+
+  ExpectHashMutations({"vector", "numeric"}, [](absl::string_view field) {
+    return std::optional<std::string>("1");
+  });
+  constexpr int kKeys = 5;
+  // Each add waits for an add on another thread, so the attribute jobs
+  // can't all be run by the thread which took the batch.
+  absl::Mutex threads_mutex;
+  absl::flat_hash_set<std::thread::id> threads;
+  auto add_record = [&](const InternedStringPtr &key,
+                        absl::string_view record) -> absl::StatusOr<bool> {
+    absl::MutexLock lock(&threads_mutex);
+    threads.insert(std::this_thread::get_id());
+    threads_mutex.AwaitWithTimeout(
+        absl::Condition(
+            +[](absl::flat_hash_set<std::thread::id> *threads) {
+              return threads->size() > 1;
+            },
+            &threads),
+        absl::Seconds(10));
+    return true;
+  };
+  for (auto &index : {vector_index, numeric_index}) {
+    EXPECT_CALL(*index, IsTracked(testing::_)).WillRepeatedly(Return(false));
+    EXPECT_CALL(*index, AddRecord(testing::_, testing::_))
+        .Times(kKeys)
+        .WillRepeatedly(add_record);
+  }
+
+  for (int i = 0; i < kKeys; ++i) {
+    auto key = vmsdk::MakeUniqueValkeyString(absl::StrCat("prefix:", i));
+    index_schema->OnKeyspaceNotification(&fake_ctx_, VALKEYMODULE_NOTIFY_HASH,
+                                         "event", key.get());
+  }
+  auto &metrics = Metrics::GetStats();
+  uint64_t initial_batches = metrics.ingest_total_batches;
+  VMSDK_EXPECT_OK(mutations_thread_pool.ResumeWorkers());
+  WaitWorkerTasksAreCompleted(mutations_thread_pool);
+  EXPECT_EQ(metrics.ingest_total_batches, initial_batches + 1);
+  {
+    absl::MutexLock lock(&threads_mutex);
+    EXPECT_EQ(threads.size(), 2);
+  }
+  EXPECT_EQ(index_schema->GetStats().document_cnt, kKeys);
+  {
+    absl::MutexLock lock(&index_schema->GetStats().mutex_);
+    EXPECT_EQ(index_schema->GetStats().mutation_queue_size_, 0);
+  }
+}
+
+TEST_P(IndexSchemaMutationTest, SkipUnchangedAttributes) {
+  // A write which leaves an attribute's content as it was doesn't reach its
+  // index again.
+  vmsdk::ThreadPool mutations_thread_pool("writer-thread-pool-", 1);
+  mutations_thread_pool.StartWorkers();
+  auto use_thread_pool = GetParam();
+  std::vector<absl::string_view> key_prefixes = {"prefix:"};
+  std::string index_schema_name_str("index_schema_name");
+  auto index_schema =
+      MockIndexSchema::Create(
+          &fake_ctx_, index_schema_name_str, key_prefixes,
+          std::make_unique<HashAttributeDataType>(),
+          use_thread_pool ? &mutations_thread_pool : nullptr)
+          .value();
+  auto mock_index = std::make_shared<MockIndex>(indexes::IndexerType::kTag);
+  VMSDK_EXPECT_OK(index_schema->AddIndex("tag", "tag", mock_index));
+
+  std::string content = "a";
+  ExpectHashMutations({"tag"}, [&content](absl::string_view field) {
+    return std::optional<std::string>(content);
+  });
+  bool is_tracked = false;
+  EXPECT_CALL(*mock_index, IsTracked(testing::_))
+      .WillRepeatedly([&is_tracked](const InternedStringPtr &key) {
+        return is_tracked;
+      });
+  EXPECT_CALL(*mock_index, AddRecord(testing::_, "a"))
+      .WillOnce([&is_tracked](const InternedStringPtr &key,
+                              absl::string_view data) {
+        is_tracked = true;
+        return true;
+      });
+  EXPECT_CALL(*mock_index, ModifyRecord(testing::_, "b"))
+      .WillOnce(Return(true));
+
+  auto &metrics = Metrics::GetStats();
+  uint64_t initial_unchanged = metrics.ingest_field_unchanged;
+  auto key = vmsdk::MakeUniqueValkeyString("prefix:1");
+  auto notify = [&]() {
+    index_schema->OnKeyspaceNotification(&fake_ctx_, VALKEYMODULE_NOTIFY_HASH,
+                                         "event", key.get());
+    if (use_thread_pool) {
+      WaitWorkerTasksAreCompleted(mutations_thread_pool);
+    }
+  };
+  notify();
+  notify();
+  EXPECT_EQ(metrics.ingest_field_unchanged, initial_unchanged + 1);
+  content = "b";
+  notify();
+  EXPECT_EQ(metrics.ingest_field_unchanged, initial_unchanged + 1);
+  EXPECT_EQ(index_schema->GetStats().document_cnt, 1);
+}
+
+TEST_P(IndexSchemaMutationTest, SortableStoredField) {
+  vmsdk::ThreadPool mutations_thread_pool("writer-thread-pool-", 1);
+  mutations_thread_pool.StartWorkers();
+  auto use_thread_pool = GetParam();
+  std::vector<absl::string_view> key_prefixes = {"prefix:"};
+  std::string index_schema_name_str("index_schema_name");
+  auto index_schema =
+      MockIndexSchema::Create(
+          &fake_ctx_, index_schema_name_str, key_prefixes,
+          std::make_unique<HashAttributeDataType>(),
+          use_thread_pool ? &mutations_thread_pool : nullptr)
+          .value();
+  auto mock_index = std::make_shared<MockIndex>(indexes::IndexerType::kTag);
+  VMSDK_EXPECT_OK(index_schema->AddIndex("tag", "tag", mock_index, true));
+  auto other_index = std::make_shared<MockIndex>(indexes::IndexerType::kTag);
+  VMSDK_EXPECT_OK(index_schema->AddIndex("other", "other", other_index));
+  EXPECT_EQ(index_schema->GetStoredField("other"), nullptr);
+  auto stored_field = index_schema->GetStoredField("tag");
+  ASSERT_NE(stored_field, nullptr);
+
+  std::optional<std::string> content = "a|b";
+  // The other attribute is missing from the key.
+  ExpectHashMutations({"tag", "other"}, [&content](absl::string_view field) {
+    return field == "tag" ? content : std::nullopt;
+  });
+  EXPECT_CALL(*mock_index, IsTracked(testing::_))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(*mock_index, AddRecord(testing::_, "a|b"))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_index, AddRecord(testing::_, "c"))
+      .WillOnce(Return(false));
+  EXPECT_CALL(*mock_index, RemoveRecord(testing::_, testing::_))
+      .WillRepeatedly(Return(true));
+
+  auto key_str = vmsdk::MakeUniqueValkeyString("prefix:1");
+  auto key = StringInternStore::Intern("prefix:1");
+  auto notify = [&]() {
+    index_schema->OnKeyspaceNotification(&fake_ctx_, VALKEYMODULE_NOTIFY_HASH,
+                                         "event", key_str.get());
+    if (use_thread_pool) {
+      WaitWorkerTasksAreCompleted(mutations_thread_pool);
+    }
+  };
+  auto initial_memory = StoredField::GetMemoryUsage();
+  notify();
+  ASSERT_NE(stored_field->Get(key), nullptr);
+  EXPECT_EQ(stored_field->Get(key)->Str(), "a|b");
+  EXPECT_GT(StoredField::GetMemoryUsage(), initial_memory);
+  // A value the index rejects isn't stored either.
+  content = "c";
+  notify();
+  EXPECT_EQ(stored_field->Get(key), nullptr);
+  content = "a|b";
+  notify();
+  EXPECT_EQ(stored_field->Size(), 1);
+  content = std::nullopt;
+  notify();
+  EXPECT_EQ(stored_field->Get(key), nullptr);
+  EXPECT_EQ(stored_field->Size(), 0);
+}
+
+TEST_P(IndexSchemaMutationTest, MutatedSince) {
+  vmsdk::ThreadPool mutations_thread_pool("writer-thread-pool-", 1);
+  mutations_thread_pool.StartWorkers();
+  auto use_thread_pool = GetParam();
+  std::vector<absl::string_view> key_prefixes = {"prefix:"};
+  std::string index_schema_name_str("index_schema_name");
+  auto index_schema =
+      MockIndexSchema::Create(
+          &fake_ctx_, index_schema_name_str, key_prefixes,
+          std::make_unique<HashAttributeDataType>(),
+          use_thread_pool ? &mutations_thread_pool : nullptr)
+          .value();
+  auto mock_index = std::make_shared<MockIndex>(indexes::IndexerType::kTag);
+  VMSDK_EXPECT_OK(index_schema->AddIndex("tag", "tag", mock_index));
+
+  ExpectHashMutations({"tag"}, [](absl::string_view field) {
+    return std::optional<std::string>("a");
+  });
+  EXPECT_CALL(*mock_index, IsTracked(testing::_))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(*mock_index, AddRecord(testing::_, "a"))
+      .WillRepeatedly(Return(true));
+
+  auto key = StringInternStore::Intern("prefix:1");
+  auto other_key = StringInternStore::Intern("prefix:2");
+  auto before = index_schema->GetMutationSequence();
+  EXPECT_FALSE(index_schema->MutatedSince(key, before));
+
+  auto key_str = vmsdk::MakeUniqueValkeyString("prefix:1");
+  index_schema->OnKeyspaceNotification(&fake_ctx_, VALKEYMODULE_NOTIFY_HASH,
+                                       "event", key_str.get());
+  if (use_thread_pool) {
+    WaitWorkerTasksAreCompleted(mutations_thread_pool);
+  }
+  auto after = index_schema->GetMutationSequence();
+  EXPECT_GT(after, before);
+  EXPECT_TRUE(index_schema->MutatedSince(key, before));
+  EXPECT_FALSE(index_schema->MutatedSince(key, after));
+  EXPECT_FALSE(index_schema->MutatedSince(other_key, before));
+}
+
+INSTANTIATE_TEST_SUITE_P(IndexSchemaMutationTests, IndexSchemaMutationTest,
+                         ::testing::Values(false, true),
+                         [](const testing::TestParamInfo<bool> &info) {
+                           return std::to_string(info.param);
+                         });
+
 TEST_P(IndexSchemaSubscriptionSimpleTest, EmptyKeyPrefixesTest) {
   vmsdk::ThreadPool mutations_thread_pool("writer-thread-pool-", 1);
   auto use_thread_pool = GetParam();
@@ -1507,6 +1840,35 @@ TEST_F(IndexSchemaFriendTest, MutatedAttributes) {
   }
 }
 
+TEST_F(IndexSchemaFriendTest, MutationSequenceEviction) {
+  // Past the cap, the oldest mutation is forgotten rather than all of them.
+  auto evicted_key = StringInternStore::Intern("evicted_key");
+  auto remutated_key = StringInternStore::Intern("remutated_key");
+  auto unmutated_key = StringInternStore::Intern("unmutated_key");
+  auto start = index_schema->GetMutationSequence();
+  {
+    absl::MutexLock lock(&index_schema->mutated_records_mutex_);
+    index_schema->NoteAppliedMutation(evicted_key);
+    index_schema->NoteAppliedMutation(remutated_key);
+    index_schema->NoteAppliedMutation(remutated_key);
+    // Evicts the mutation of evicted_key, then the stale one of remutated_key.
+    for (size_t i = 1; i < IndexSchema::kMaxMutationSequences; ++i) {
+      index_schema->NoteAppliedMutation(
+          StringInternStore::Intern(absl::StrCat("key_", i)));
+    }
+    EXPECT_EQ(index_schema->mutation_sequences_.by_key.size(),
+              IndexSchema::kMaxMutationSequences);
+    EXPECT_EQ(index_schema->mutation_sequences_.in_order.size(),
+              IndexSchema::kMaxMutationSequences);
+  }
+  // Only searches which began before the evicted mutation lose track of it.
+  EXPECT_TRUE(index_schema->MutatedSince(unmutated_key, start));
+  EXPECT_FALSE(index_schema->MutatedSince(unmutated_key, start + 1));
+  EXPECT_FALSE(index_schema->MutatedSince(evicted_key, start + 1));
+  EXPECT_TRUE(index_schema->MutatedSince(remutated_key, start + 2));
+  EXPECT_FALSE(index_schema->MutatedSince(remutated_key, start + 3));
+}
+
 TEST_F(IndexSchemaFriendTest, ConsistencyTest) {
   auto vectors = DeterministicallyGenerateVectors(1000, dimensions, 2);
   auto itr = index_schema->attributes_.find(attribute_identifier);
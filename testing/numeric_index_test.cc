@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -165,6 +166,17 @@ TEST_F(NumericIndexTest, RangeSearchInclusiveExclusive) {
               testing::UnorderedElementsAre("key1", "key2", "key5"));
 }
 
+TEST_F(NumericIndexTest, GetCount) {
+  EXPECT_TRUE(index.AddRecord("key1", "1.0").value());
+  EXPECT_TRUE(index.AddRecord("key2", "2.0").value());
+  EXPECT_TRUE(index.AddRecord("key3", "3.0").value());
+  EXPECT_EQ(index.GetCount(1.0, 3.0, true, true), 3);
+  EXPECT_EQ(index.GetCount(1.0, 3.0, false, false), 1);
+  EXPECT_EQ(index.GetCount(2.0, 2.0, true, true), 1);
+  EXPECT_EQ(index.GetCount(2.0, 2.0, true, false), 0);
+  EXPECT_EQ(index.GetCount(3.0, 1.0, true, true), 0);
+}
+
 TEST_F(NumericIndexTest, RangeSearchInclusiveExclusive1) {
   VMSDK_EXPECT_OK(index.AddRecord("key1", "1.0"));
   VMSDK_EXPECT_OK(index.AddRecord("key2", "2.1"));
@@ -312,6 +324,46 @@ TEST_F(NumericIndexTest, DeletedKeysNegativeSearchTest) {
   EXPECT_THAT(Fetch(*entries_fetcher), testing::UnorderedElementsAre("doc0"));
 }
 
+TEST_F(NumericIndexTest, SortedSearchSkipTo) {
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(
+        index.AddRecord(absl::StrCat("key", i), absl::StrCat(i)).value());
+  }
+  // Shares the posting list of key3.
+  EXPECT_TRUE(index.AddRecord("key10", "3").value());
+  std::string attribute_id = "attribute_id";
+  std::string attribute_alias = "attribute_alias";
+  query::NumericPredicate predicate(&index, attribute_alias, attribute_id, 2.0,
+                                    true, 7.0, true);
+  auto fetcher = index.Search(predicate, false);
+  std::vector<const PostingList*> lists;
+  EXPECT_FALSE(fetcher->AppendPostingLists(5, lists));
+  EXPECT_TRUE(lists.empty());
+  EXPECT_TRUE(fetcher->AppendPostingLists(6, lists));
+  EXPECT_EQ(lists.size(), 6);
+
+  auto itr = fetcher->SortedBegin();
+  std::vector<std::string> keys;
+  for (; !itr->Done(); itr->Next()) {
+    keys.push_back(std::string((**itr)->Str()));
+  }
+  EXPECT_THAT(keys, testing::ElementsAre("key10", "key2", "key3", "key4",
+                                         "key5", "key6", "key7"));
+
+  itr = fetcher->SortedBegin();
+  itr->SkipTo(StringInternStore::Intern("key4"));
+  ASSERT_FALSE(itr->Done());
+  EXPECT_EQ((**itr)->Str(), "key4");
+  // Skipping backwards does not move the iterator.
+  itr->SkipTo(StringInternStore::Intern("key2"));
+  EXPECT_EQ((**itr)->Str(), "key4");
+  // Skipping to a key which isn't fetched stops at the next one.
+  itr->SkipTo(StringInternStore::Intern("key65"));
+  ASSERT_FALSE(itr->Done());
+  EXPECT_EQ((**itr)->Str(), "key7");
+  itr->Next();
+  EXPECT_TRUE(itr->Done());
+}
 }  // namespace
 
 }  // namespace valkey_search::indexes
@@ -7,10 +7,12 @@
 
 #include "src/query/response_generator.h"
 
+#include <atomic>
 #include <cstddef>
 #include <deque>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -18,7 +20,9 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "src/attribute_data_type.h"
@@ -29,6 +33,7 @@
 #include "src/utils/string_interning.h"
 #include "testing/common.h"
 #include "vmsdk/src/managed_pointers.h"
+#include "vmsdk/src/thread_pool.h"
 #include "vmsdk/src/valkey_module_api/valkey_module.h"
 
 namespace valkey_search {
@@ -275,6 +280,161 @@ TEST_F(ResponseGeneratorTest, ProcessNeighborsForReplyContentLimits) {
   EXPECT_EQ(Metrics::GetStats().query_result_record_dropped_cnt, 2);
 }
 
+TEST_F(ResponseGeneratorTest, ProcessNeighborsForReplyOffMainThread) {
+  // Off the main thread, the content is fetched under the GIL, a batch at a
+  // time.
+  ValkeyModuleCtx fake_ctx;
+  VMSDK_EXPECT_OK(options::GetContentFetchBatchSize().SetValue(2));
+  std::deque<indexes::Neighbor> neighbors;
+  for (int i = 0; i < 5; ++i) {
+    neighbors.push_back(indexes::Neighbor(
+        StringInternStore::Intern(absl::StrCat("id", i)), 0));
+  }
+  query::SearchParameters parameters(100000, nullptr, 0);
+  parameters.attribute_alias = "some_attribute_name";
+  MockAttributeDataType data_type;
+  EXPECT_CALL(data_type, ToProto()).WillRepeatedly([]() {
+    return data_model::AttributeDataType::ATTRIBUTE_DATA_TYPE_HASH;
+  });
+  int locks = 0;
+  bool locked = false;
+  EXPECT_CALL(*kMockValkeyModule, ThreadSafeContextTryLock(&fake_ctx))
+      .Times(3)
+      .WillRepeatedly([&](ValkeyModuleCtx *ctx) {
+        EXPECT_FALSE(locked);
+        locked = true;
+        ++locks;
+        return VALKEYMODULE_OK;
+      });
+  EXPECT_CALL(*kMockValkeyModule, ThreadSafeContextUnlock(&fake_ctx))
+      .Times(3)
+      .WillRepeatedly([&](ValkeyModuleCtx *ctx) {
+        EXPECT_TRUE(locked);
+        locked = false;
+      });
+  EXPECT_CALL(data_type, FetchAllRecords(&fake_ctx, testing::_, testing::_,
+                                         testing::_, testing::_))
+      .Times(5)
+      .WillRepeatedly(
+          [&](ValkeyModuleCtx *ctx, const std::string &query_attribute_alias,
+              ValkeyModuleKey *open_key, absl::string_view key,
+              const absl::flat_hash_set<absl::string_view> &identifiers)
+              -> absl::StatusOr<RecordsMap> {
+            EXPECT_TRUE(locked);
+            return ToRecordsMap({{"field", "value"}});
+          });
+
+  std::thread reader([&]() {
+    ProcessNeighborsForReply(&fake_ctx, data_type, neighbors, parameters,
+                             parameters.attribute_alias);
+  });
+  reader.join();
+  EXPECT_EQ(locks, 3);
+  EXPECT_FALSE(locked);
+  EXPECT_EQ(neighbors.size(), 5);
+  VMSDK_EXPECT_OK(options::GetContentFetchBatchSize().SetValue(0));
+}
+
+TEST_F(ResponseGeneratorTest, ProcessNeighborsForReplyYieldsToSuspension) {
+  // At fork, the main thread holds the GIL while it suspends the reader pool,
+  // which a fetch waiting for the GIL mustn't hold up.
+  ValkeyModuleCtx fake_ctx;
+  VMSDK_EXPECT_OK(options::GetContentFetchBatchSize().SetValue(1));
+  std::deque<indexes::Neighbor> neighbors;
+  neighbors.push_back(indexes::Neighbor(StringInternStore::Intern("id"), 0));
+  query::SearchParameters parameters(100000, nullptr, 0);
+  parameters.attribute_alias = "some_attribute_name";
+  MockAttributeDataType data_type;
+  EXPECT_CALL(data_type, ToProto()).WillRepeatedly([]() {
+    return data_model::AttributeDataType::ATTRIBUTE_DATA_TYPE_HASH;
+  });
+  std::atomic<bool> gil_held{true};
+  absl::Notification waiting;
+  EXPECT_CALL(*kMockValkeyModule, ThreadSafeContextTryLock(&fake_ctx))
+      .WillRepeatedly([&](ValkeyModuleCtx *ctx) {
+        if (!gil_held) {
+          return VALKEYMODULE_OK;
+        }
+        if (!waiting.HasBeenNotified()) {
+          waiting.Notify();
+        }
+        return VALKEYMODULE_ERR;
+      });
+  EXPECT_CALL(*kMockValkeyModule, ThreadSafeContextUnlock(&fake_ctx))
+      .Times(1);
+  EXPECT_CALL(data_type, FetchAllRecords(&fake_ctx, testing::_, testing::_,
+                                         testing::_, testing::_))
+      .WillOnce([&](ValkeyModuleCtx *ctx,
+                    const std::string &query_attribute_alias,
+                    ValkeyModuleKey *open_key, absl::string_view key,
+                    const absl::flat_hash_set<absl::string_view> &identifiers)
+                    -> absl::StatusOr<RecordsMap> {
+        EXPECT_FALSE(gil_held);
+        return ToRecordsMap({{"field", "value"}});
+      });
+
+  vmsdk::ThreadPool reader_pool("reader-", 1);
+  reader_pool.StartWorkers();
+  absl::Notification fetched;
+  EXPECT_TRUE(reader_pool.Schedule(
+      [&]() {
+        ProcessNeighborsForReply(&fake_ctx, data_type, neighbors, parameters,
+                                 parameters.attribute_alias);
+        fetched.Notify();
+      },
+      vmsdk::ThreadPool::Priority::kHigh));
+  waiting.WaitForNotification();
+  VMSDK_EXPECT_OK(reader_pool.SuspendWorkers());
+  EXPECT_FALSE(fetched.HasBeenNotified());
+  gil_held = false;
+  VMSDK_EXPECT_OK(reader_pool.ResumeWorkers());
+  fetched.WaitForNotification();
+  EXPECT_EQ(neighbors.size(), 1);
+  VMSDK_EXPECT_OK(options::GetContentFetchBatchSize().SetValue(0));
+}
+
+TEST_F(ResponseGeneratorTest, ProcessNeighborsForReplyUnmutatedKeys) {
+  // Keys which weren't mutated since the search aren't checked against the
+  // filter again.
+  ValkeyModuleCtx fake_ctx;
+  auto index_schema = CreateIndexSchema("index_schema_name").value();
+  std::deque<indexes::Neighbor> neighbors;
+  for (int i = 0; i < 2; ++i) {
+    neighbors.push_back(indexes::Neighbor(
+        StringInternStore::Intern(absl::StrCat("prefix:", i)), 0));
+  }
+  query::SearchParameters parameters(100000, nullptr, 0);
+  parameters.attribute_alias = "some_attribute_name";
+  parameters.index_schema = index_schema;
+  parameters.mutation_sequence = index_schema->GetMutationSequence();
+  parameters.return_attributes.push_back(
+      {.identifier = vmsdk::MakeUniqueValkeyString("id1"),
+       .alias = vmsdk::MakeUniqueValkeyString("id1")});
+  parameters.filter_parse_results.filter_identifiers = {"id2"};
+  auto predicate =
+      std::make_unique<MockPredicate>(query::PredicateType::kNumeric);
+  EXPECT_CALL(*predicate, Evaluate(testing::_)).Times(0);
+  parameters.filter_parse_results.root_predicate = std::move(predicate);
+  MockAttributeDataType data_type;
+  EXPECT_CALL(data_type, ToProto()).WillRepeatedly([]() {
+    return data_model::AttributeDataType::ATTRIBUTE_DATA_TYPE_HASH;
+  });
+  absl::flat_hash_set<absl::string_view> expected_identifiers = {"id1"};
+  EXPECT_CALL(data_type, FetchAllRecords(&fake_ctx, testing::_, testing::_,
+                                         testing::_, expected_identifiers))
+      .Times(2)
+      .WillRepeatedly(
+          [](ValkeyModuleCtx *ctx, const std::string &query_attribute_alias,
+             ValkeyModuleKey *open_key, absl::string_view key,
+             const absl::flat_hash_set<absl::string_view> &identifiers)
+              -> absl::StatusOr<RecordsMap> {
+            return ToRecordsMap({{"id1", "value"}});
+          });
+  ProcessNeighborsForReply(&fake_ctx, data_type, neighbors, parameters,
+                           parameters.attribute_alias);
+  EXPECT_EQ(neighbors.size(), 2);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     ResponseGeneratorTests, ResponseGeneratorTest,
     ValuesIn<ResponseGeneratorTestCase>(
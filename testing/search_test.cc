@@ -117,6 +117,12 @@ class TestedNumericEntriesFetcher : public indexes::Numeric::EntriesFetcher {
 
     return std::make_unique<TestedNumericEntriesFetcherIterator>(keys);
   }
+  bool AppendPostingLists(
+      size_t max_lists,
+      std::vector<const indexes::PostingList *> &lists) const override {
+    // The tested keys are not backed by the entries range.
+    return false;
+  }
 
  private:
   std::pair<size_t, size_t> key_range_;
@@ -134,11 +140,8 @@ class MockTag : public indexes::Tag {
 class TestedTagEntriesFetcher : public indexes::Tag::EntriesFetcher {
  public:
   TestedTagEntriesFetcher(
-      size_t size,
-      PatriciaTree<InternedStringPtr, InternedStringPtrHash,
-                   InternedStringPtrEqual> &tree,
-      absl::flat_hash_set<PatriciaNode<InternedStringPtr, InternedStringPtrHash,
-                                       InternedStringPtrEqual> *> &entries,
+      size_t size, indexes::Tag::PatriciaTreeIndex &tree,
+      absl::flat_hash_set<indexes::Tag::PatriciaNodeIndex *> &entries,
       bool negate, InternedStringSet &untracked_keys)
       : indexes::Tag::EntriesFetcher(tree, entries, size, negate,
                                      untracked_keys),
@@ -197,11 +200,8 @@ void InitIndexSchema(MockIndexSchema *index_schema) {
 
   VMSDK_EXPECT_OK(index_schema->AddIndex("tag_index_100_15", "tag_index_100_15",
                                          tag_index_100_15));
-  PatriciaTree<InternedStringPtr, InternedStringPtrHash, InternedStringPtrEqual>
-      tree(false);
-  absl::flat_hash_set<PatriciaNode<InternedStringPtr, InternedStringPtrHash,
-                                   InternedStringPtrEqual> *>
-      entries;
+  indexes::Tag::PatriciaTreeIndex tree(false);
+  absl::flat_hash_set<indexes::Tag::PatriciaNodeIndex *> entries;
   InternedStringSet untracked_keys;
   EXPECT_CALL(*tag_index_100_15, Search(_, false))
       .WillRepeatedly(Return(ByMove(std::make_unique<TestedTagEntriesFetcher>(
@@ -391,6 +391,10 @@ struct LocalSearchTestCase {
   std::string filter;
   size_t expected_neighbors_size;
   bool is_vector_search_query = true;
+  std::optional<query::LimitParameter> limit;
+  std::optional<size_t> expected_total_count;
+  // When set, the keys of the neighbors, in order.
+  std::vector<std::string> expected_keys;
 };
 
 class LocalSearchTest : public ValkeySearchTestWithParam<LocalSearchTestCase> {
@@ -413,12 +417,24 @@ TEST_P(LocalSearchTest, LocalSearchTest) {
   FilterParser parser(*index_schema, test_case.filter);
   params.filter_parse_results = std::move(parser.Parse().value());
   params.index_schema = index_schema;
+  if (test_case.limit.has_value()) {
+    params.limit = test_case.limit.value();
+    params.limit_non_vector_neighbors = true;
+  }
   auto time_slice_queries = Metrics::GetStats().time_slice_queries.load();
   auto neighbors = Search(params, valkey_search::query::SearchMode::kLocal);
   EXPECT_EQ(time_slice_queries + 1,
             Metrics::GetStats().time_slice_queries.load());
   VMSDK_EXPECT_OK(neighbors);
   EXPECT_EQ(neighbors.value().size(), test_case.expected_neighbors_size);
+  EXPECT_EQ(params.total_count, test_case.expected_total_count);
+  if (!test_case.expected_keys.empty()) {
+    std::vector<std::string> keys;
+    for (const auto &neighbor : neighbors.value()) {
+      keys.push_back(std::string(neighbor.external_id->Str()));
+    }
+    EXPECT_EQ(keys, test_case.expected_keys);
+  }
 }
 
 INSTANTIATE_TEST_SUITE_P(
@@ -478,12 +494,145 @@ INSTANTIATE_TEST_SUITE_P(
             .expected_neighbors_size = 4,
             .is_vector_search_query = false,
         },
+        {
+            // The tag clauses are joined, the numeric one, made of more
+            // posting lists than the smallest clause has keys, is verified.
+            .test_name = "non_vector_numeric_and_two_tags_filter",
+            .filter = "@numeric:[0 4] @tag:{LT5} @tag:{LT3}",
+            .expected_neighbors_size = 3,
+            .is_vector_search_query = false,
+            .expected_keys = {"0", "1", "2"},
+        },
+        {
+            // Joined matches come out in key order rather than value order.
+            .test_name = "non_vector_joined_filter_in_key_order",
+            .filter = "@tag:{LT10000} @numeric:[9 11]",
+            .expected_neighbors_size = 3,
+            .is_vector_search_query = false,
+            .expected_keys = {"10", "11", "9"},
+        },
+        {
+            .test_name = "non_vector_numeric_and_tag_and_negate_tag_filter",
+            .filter = "@numeric:[1 10] @tag:{LT5} -@tag:{LT3}",
+            .expected_neighbors_size = 2,
+            .is_vector_search_query = false,
+        },
+        {
+            .test_name = "non_vector_negate_numeric_or_filter",
+            .filter = "-(@numeric:[5 10000] | @numeric:[0 1])",
+            .expected_neighbors_size = 3,
+            .is_vector_search_query = false,
+        },
+        {
+            .test_name = "non_vector_numeric_filter_in_index_order",
+            .filter = "@numeric:[1 5]",
+            .expected_neighbors_size = 5,
+            .is_vector_search_query = false,
+            .expected_keys = {"1", "2", "3", "4", "5"},
+        },
+        {
+            // The keys carrying both tags are returned once.
+            .test_name = "non_vector_multi_tag_filter",
+            .filter = "@tag:{LT5,LT3}",
+            .expected_neighbors_size = 5,
+            .is_vector_search_query = false,
+            .expected_keys = {"0", "1", "2", "3", "4"},
+        },
+        {
+            .test_name = "non_vector_overlapping_numeric_or_tag_filter",
+            .filter = "@numeric:[2 6] | @tag:{LT5,LT3}",
+            .expected_neighbors_size = 7,
+            .is_vector_search_query = false,
+            .expected_keys = {"0", "1", "2", "3", "4", "5", "6"},
+        },
         {
             .test_name = "non_vector_numeric_or_numeric_filter",
             .filter = "@numeric:[1 10] | @numeric:[21 25]",
             .expected_neighbors_size = 15,
             .is_vector_search_query = false,
         },
+        {
+            .test_name = "non_vector_limited_numeric_filter",
+            .filter = "@numeric:[1 10]",
+            .expected_neighbors_size = 5,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{2, 3},
+            .expected_total_count = 10,
+        },
+        {
+            .test_name = "non_vector_limited_tag_filter",
+            .filter = "@tag:{LT5}",
+            .expected_neighbors_size = 2,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 2},
+            .expected_total_count = 5,
+        },
+        {
+            .test_name = "non_vector_limited_numeric_and_tag_filter",
+            .filter = "@numeric:[1 10] @tag:{LT5}",
+            .expected_neighbors_size = 2,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 2},
+            .expected_total_count = 4,
+        },
+        {
+            // The numeric clause is made of too many posting lists to join,
+            // so only the tag clause is fetched.
+            .test_name = "non_vector_limited_uneven_numeric_and_tag_filter",
+            .filter = "@numeric:[1 40] @tag:{LT5}",
+            .expected_neighbors_size = 2,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 2},
+            .expected_total_count = 4,
+        },
+        {
+            .test_name = "non_vector_limited_multi_tag_filter",
+            .filter = "@tag:{LT5,LT3}",
+            .expected_neighbors_size = 0,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 0},
+            .expected_total_count = 5,
+        },
+        {
+            .test_name = "non_vector_count_only_numeric_ranges",
+            .filter = "@numeric:[1 10] @numeric:[5 20]",
+            .expected_neighbors_size = 0,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{3, 0},
+            .expected_total_count = 6,
+        },
+        {
+            .test_name = "non_vector_count_only_disjoint_numeric_ranges",
+            .filter = "@numeric:[1 10] @numeric:(10 20]",
+            .expected_neighbors_size = 0,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 0},
+            .expected_total_count = 0,
+        },
+        {
+            .test_name = "non_vector_count_only_uneven_numeric_and_tag",
+            .filter = "@numeric:[1 40] @tag:{LT5}",
+            .expected_neighbors_size = 0,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 0},
+            .expected_total_count = 4,
+        },
+        {
+            .test_name = "non_vector_count_only_and_with_or",
+            .filter = "@tag:{LT5} (@numeric:[0 1] | @numeric:[4 8])",
+            .expected_neighbors_size = 0,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 0},
+            .expected_total_count = 3,
+        },
+        {
+            .test_name = "non_vector_count_only_numeric_and_tag",
+            .filter = "@numeric:[0 3] @tag:{LT5}",
+            .expected_neighbors_size = 0,
+            .is_vector_search_query = false,
+            .limit = query::LimitParameter{0, 0},
+            .expected_total_count = 4,
+        },
     }),
     [](const testing::TestParamInfo<LocalSearchTestCase> &info) {
       return info.param.test_name;
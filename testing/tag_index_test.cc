@@ -5,11 +5,14 @@
  *
  */
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "src/indexes/index_base.h"
@@ -272,6 +275,90 @@ TEST_F(TagIndexTest, DeletedKeysNegativeSearchTest) {
       true);
   EXPECT_THAT(Fetch(*entries_fetcher), testing::UnorderedElementsAre("doc0"));
 }
+TEST_F(TagIndexTest, SortedSearchTest) {
+  EXPECT_TRUE(index->AddRecord("doc1", "red,blue").value());
+  EXPECT_TRUE(index->AddRecord("doc2", "red").value());
+  EXPECT_TRUE(index->AddRecord("doc3", "blue").value());
+  EXPECT_TRUE(index->AddRecord("doc4", "green").value());
+
+  std::string raw_tag_string = "red,blue";
+  auto entries_fetcher = index->Search(
+      query::TagPredicate(
+          index.get(), alias, identifier, raw_tag_string,
+          indexes::Tag::ParseSearchTags(raw_tag_string, index->GetSeparator())
+              .value()),
+      false);
+  auto itr = entries_fetcher->SortedBegin();
+  // doc1 is held by the lists of both tags but is only returned once.
+  std::vector<std::string> keys;
+  for (; !itr->Done(); itr->Next()) {
+    keys.push_back(std::string((**itr)->Str()));
+  }
+  EXPECT_THAT(keys, testing::ElementsAre("doc1", "doc2", "doc3"));
+
+  itr = entries_fetcher->SortedBegin();
+  itr->SkipTo(StringInternStore::Intern("doc2"));
+  ASSERT_FALSE(itr->Done());
+  EXPECT_EQ((**itr)->Str(), "doc2");
+  itr->Next();
+  ASSERT_FALSE(itr->Done());
+  EXPECT_EQ((**itr)->Str(), "doc3");
+  itr->Next();
+  EXPECT_TRUE(itr->Done());
+}
+
+TEST_F(TagIndexTest, EstimateMatchesTest) {
+  EXPECT_TRUE(index->AddRecord("doc1", "red,blue").value());
+  EXPECT_TRUE(index->AddRecord("doc2", "red").value());
+  std::string raw_tag_string = "red,blue";
+  auto parsed_tags =
+      indexes::Tag::ParseSearchTags(raw_tag_string, index->GetSeparator())
+          .value();
+  query::TagPredicate predicate(index.get(), alias, identifier, raw_tag_string,
+                                parsed_tags);
+  EXPECT_EQ(index->Search(predicate, false)->Size(), 3);
+  EXPECT_EQ(predicate.GetEstimatedMatches(), 3);
+
+  // The count taken by the search is reused for the rest of the query.
+  EXPECT_TRUE(index->AddRecord("doc3", "blue").value());
+  EXPECT_EQ(index->EstimateMatches(predicate), 3);
+  query::TagPredicate next_predicate(index.get(), alias, identifier,
+                                     raw_tag_string, parsed_tags);
+  EXPECT_EQ(index->EstimateMatches(next_predicate), 4);
+}
+
+TEST_F(TagIndexTest, WideOrSearchTest) {
+  std::vector<std::string> tags;
+  for (int i = 0; i < 50; ++i) {
+    tags.push_back(absl::StrCat("tag", i));
+  }
+  std::vector<std::string> expected_keys;
+  for (int i = 0; i < 100; ++i) {
+    // Each key carries three of the searched tags.
+    auto key = absl::StrCat("doc", i);
+    EXPECT_TRUE(index
+                    ->AddRecord(key, absl::StrCat(tags[i % 50], ",",
+                                                  tags[(i + 1) % 50], ",",
+                                                  tags[(i + 7) % 50]))
+                    .value());
+    expected_keys.push_back(key);
+  }
+  std::sort(expected_keys.begin(), expected_keys.end());
+
+  std::string raw_tag_string = absl::StrJoin(tags, ",");
+  auto parsed_tags =
+      indexes::Tag::ParseSearchTags(raw_tag_string, index->GetSeparator())
+          .value();
+  query::TagPredicate predicate(index.get(), alias, identifier, raw_tag_string,
+                                parsed_tags);
+  auto entries_fetcher = index->Search(predicate, false);
+  // The size counts the keys once per tag, but each is fetched once, in key
+  // order.
+  EXPECT_EQ(entries_fetcher->Size(), 300);
+  EXPECT_FALSE(entries_fetcher->MayRepeatKeys());
+  EXPECT_EQ(Fetch(*entries_fetcher), expected_keys);
+  EXPECT_EQ(Fetch(*entries_fetcher), expected_keys);
+}
 }  // namespace
 
 }  // namespace valkey_search::indexes
@@ -7,13 +7,17 @@
 
 #include "src/utils/allocator.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "gtest/gtest.h"
 #include "src/utils/intrusive_ref_count.h"
+#include "vmsdk/src/huge_pages.h"
 #include "vmsdk/src/testing_infra/utils.h"
 
 #ifndef SAN_BUILD
@@ -214,6 +218,92 @@ TEST_P(AllocatorTest, FixedSizeAllocatorMultipleChunksWithFreeEntries) {
   }
 }
 
+TEST_P(AllocatorTest, FixedSizeAllocatorMagazines) {
+  const size_t size = 64;
+  const size_t magazine_size = 4;
+  auto memory_alignment = GetParam();
+  auto allocator = CREATE_UNIQUE_PTR(FixedSizeAllocator, size,
+                                     memory_alignment, magazine_size);
+  std::vector<char *> buffers;
+  for (size_t i = 0; i < 10; ++i) {
+    buffers.push_back(allocator->Allocate(size));
+  }
+  EXPECT_EQ(allocator->ActiveAllocations(), 10);
+  EXPECT_EQ(allocator->ChunkCount(), 1);
+  // The last freed buffer is cached, and handed out first.
+  auto last = buffers.back();
+  buffers.pop_back();
+  Allocator::Free(last);
+  EXPECT_EQ(allocator->Allocate(size), last);
+  buffers.push_back(last);
+  for (auto &buffer : buffers) {
+    Allocator::Free(buffer);
+  }
+  EXPECT_EQ(allocator->ActiveAllocations(), 0);
+  // Once no buffer is allocated, the magazines are flushed, which frees the
+  // chunk.
+  EXPECT_EQ(allocator->ChunkCount(), 0);
+  buffers.clear();
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&allocator, size]() {
+      std::vector<char *> thread_buffers;
+      for (size_t round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < 100; ++i) {
+          thread_buffers.push_back(allocator->Allocate(size));
+        }
+        for (auto &buffer : thread_buffers) {
+          Allocator::Free(buffer);
+        }
+        thread_buffers.clear();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(allocator->ActiveAllocations(), 0);
+  EXPECT_EQ(allocator->ChunkCount(), 0);
+  allocator.reset();
+}
+
+TEST_P(AllocatorTest, FixedSizeAllocatorHugePageArena) {
+  const size_t size = 128;
+  auto memory_alignment = GetParam();
+  auto allocator =
+      CREATE_UNIQUE_PTR(FixedSizeAllocator, size, memory_alignment);
+  auto stats = vmsdk::GetHugePageArenaStats();
+  vmsdk::SetHugePageArenaEnabled(true);
+  std::vector<char *> buffers;
+  // A chunk fills a huge page.
+  size_t entries = vmsdk::GetHugePageSize() / size;
+  for (size_t i = 0; i < entries; ++i) {
+    buffers.push_back(allocator->Allocate(size));
+  }
+  vmsdk::SetHugePageArenaEnabled(false);
+  EXPECT_EQ(allocator->ChunkCount(), 1);
+  auto arena_stats = vmsdk::GetHugePageArenaStats();
+  if (arena_stats.map_failure_cnt == stats.map_failure_cnt) {
+    EXPECT_EQ(arena_stats.region_cnt, stats.region_cnt + 1);
+    EXPECT_EQ(arena_stats.mapped_bytes,
+              stats.mapped_bytes + vmsdk::GetHugePageSize());
+    auto data = *std::min_element(buffers.begin(), buffers.end());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % vmsdk::GetHugePageSize(), 0);
+  }
+  // Chunks allocated with the arena disabled come from the heap.
+  buffers.push_back(allocator->Allocate(size));
+  EXPECT_EQ(allocator->ChunkCount(), 2);
+  EXPECT_EQ(vmsdk::GetHugePageArenaStats().region_cnt,
+            arena_stats.region_cnt);
+  for (auto &buffer : buffers) {
+    Allocator::Free(buffer);
+  }
+  EXPECT_EQ(allocator->ChunkCount(), 0);
+  EXPECT_EQ(vmsdk::GetHugePageArenaStats().region_cnt, stats.region_cnt);
+  EXPECT_EQ(vmsdk::GetHugePageArenaStats().mapped_bytes, stats.mapped_bytes);
+}
+
 INSTANTIATE_TEST_SUITE_P(AllocatorTests, AllocatorTest,
                          ::testing::Values(true, false),
                          [](const testing::TestParamInfo<bool> &info) {
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#include "src/utils/hyperloglog.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+namespace valkey_search::utils {
+
+namespace {
+
+uint64_t Hash(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+TEST(HyperLogLogTest, Empty) {
+  HyperLogLog<8> hll;
+  EXPECT_EQ(hll.Estimate(), 0);
+}
+
+TEST(HyperLogLogTest, Estimate) {
+  for (uint64_t count : {1, 10, 100, 1000, 10000, 100000}) {
+    HyperLogLog<10> hll;
+    for (uint64_t i = 0; i < count; ++i) {
+      // Duplicates don't count.
+      hll.Add(Hash(i));
+      hll.Add(Hash(i));
+    }
+    EXPECT_NEAR(hll.Estimate(), count, 0.1 * count + 1) << count;
+  }
+}
+
+TEST(HyperLogLogTest, Merge) {
+  HyperLogLog<8> all;
+  HyperLogLog<8> even;
+  HyperLogLog<8> odd;
+  for (uint64_t i = 0; i < 5000; ++i) {
+    all.Add(Hash(i));
+    (i % 2 ? odd : even).Add(Hash(i));
+  }
+  HyperLogLog<8> merged;
+  merged.Merge(even);
+  EXPECT_TRUE(merged.MergeSerialized(odd.Serialize()));
+  EXPECT_EQ(merged.Estimate(), all.Estimate());
+  EXPECT_FALSE(merged.MergeSerialized("short"));
+}
+
+}  // namespace
+
+}  // namespace valkey_search::utils
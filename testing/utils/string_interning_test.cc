@@ -10,11 +10,16 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "src/utils/allocator.h"
 #include "src/utils/intrusive_ref_count.h"
+#include "vmsdk/src/huge_pages.h"
 #include "vmsdk/src/memory_allocation.h"
 #include "vmsdk/src/memory_allocation_overrides.h"
 #include "vmsdk/src/memory_tracker.h"
@@ -69,7 +74,7 @@ TEST_F(StringInterningTest, BasicTest) {
     auto interned_key_1 = StringInternStore::Intern("key1");
     auto interned_key_2 = StringInternStore::Intern("key2");
     auto interned_key_2_1 = StringInternStore::Intern("key2");
-    auto interned_key_3 = std::make_shared<InternedString>("key3");
+    auto interned_key_3 = InternedString::MakeUninterned("key3");
 
     EXPECT_EQ(std::string(*interned_key_1), "key1");
     EXPECT_EQ(std::string(*interned_key_2), "key2");
@@ -80,6 +85,57 @@ TEST_F(StringInterningTest, BasicTest) {
   EXPECT_EQ(StringInternStore::Instance().Size(), 0);
 }
 
+TEST_F(StringInterningTest, Handle) {
+  static_assert(sizeof(InternedStringPtr) == sizeof(void*));
+  InternedStringPtr copy;
+  {
+    auto interned = StringInternStore::Intern("key1");
+    copy = interned;
+    InternedStringPtr moved = std::move(interned);
+    EXPECT_EQ(moved, copy);
+    EXPECT_EQ(StringInternStore::Intern("key1"), copy);
+  }
+  // The last reference keeps the string interned.
+  EXPECT_EQ(StringInternStore::Instance().Size(), 1);
+  EXPECT_EQ(copy->Str(), "key1");
+  copy.reset();
+  EXPECT_EQ(StringInternStore::Instance().Size(), 0);
+
+  auto uninterned = InternedString::MakeUninterned("key1");
+  EXPECT_EQ(uninterned->Str(), "key1");
+  EXPECT_EQ(StringInternStore::Instance().Size(), 0);
+  EXPECT_NE(StringInternStore::Intern("key1"), uninterned);
+}
+
+TEST_F(StringInterningTest, ConcurrentIntern) {
+  // Threads interning the same strings at once end up sharing them.
+  constexpr int kThreads = 4;
+  constexpr int kStrings = 1000;
+  std::vector<std::vector<InternedStringPtr>> interned(kThreads);
+  {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([t, &interned]() {
+        for (int i = 0; i < kStrings; ++i) {
+          interned[t].push_back(
+              StringInternStore::Intern(absl::StrCat("key", i)));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  EXPECT_EQ(StringInternStore::Instance().Size(), kStrings);
+  for (int t = 1; t < kThreads; ++t) {
+    for (int i = 0; i < kStrings; ++i) {
+      EXPECT_EQ(interned[t][i].get(), interned[0][i].get());
+    }
+  }
+  interned.clear();
+  EXPECT_EQ(StringInternStore::Instance().Size(), 0);
+}
+
 TEST_P(StringInterningTest, WithAllocator) {
   bool require_ptr_alignment = GetParam();
   auto allocator = CREATE_UNIQUE_PTR(
@@ -112,7 +168,7 @@ TEST_P(StringInterningTest, WithAllocator) {
 
 TEST_F(StringInterningTest, StringInternStoreTracksMemoryInternally) {
   MemoryPool caller_pool{0};
-  std::shared_ptr<InternedString> interned_str;
+  InternedStringPtr interned_str;
   auto allocator = std::make_unique<MockAllocator>();
 
   {
@@ -124,6 +180,25 @@ TEST_F(StringInterningTest, StringInternStoreTracksMemoryInternally) {
   EXPECT_EQ(StringInternStore::GetMemoryUsage(), 12);
 
   interned_str.reset();
+
+  // The chunks of an allocator with magazines are freed with the last string,
+  // within the store's scope rather than when the allocator is destroyed.
+  // Chunks from the huge page arena report their memory.
+  auto usage = StringInternStore::GetMemoryUsage();
+  auto magazine_allocator = CREATE_UNIQUE_PTR(FixedSizeAllocator, 12, false, 8);
+  vmsdk::SetHugePageArenaEnabled(true);
+  {
+    NestedMemoryScope scope{caller_pool};
+    interned_str =
+        StringInternStore::Intern("test_string", magazine_allocator.get());
+  }
+  vmsdk::SetHugePageArenaEnabled(false);
+  EXPECT_EQ(caller_pool.GetUsage(), 0);
+  EXPECT_EQ(magazine_allocator->ChunkCount(), 1);
+
+  interned_str.reset();
+  EXPECT_EQ(magazine_allocator->ChunkCount(), 0);
+  EXPECT_EQ(StringInternStore::GetMemoryUsage(), usage);
 }
 
 INSTANTIATE_TEST_SUITE_P(StringInterningTests, StringInterningTest,
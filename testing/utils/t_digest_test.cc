@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#include "src/utils/t_digest.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace valkey_search::utils {
+
+namespace {
+
+TEST(TDigestTest, Exact) {
+  TDigest digest;
+  EXPECT_TRUE(digest.Empty());
+  for (double value : {4.0, 1.0, 3.0, 2.0}) {
+    digest.Add(value);
+  }
+  EXPECT_FALSE(digest.Empty());
+  EXPECT_EQ(digest.Quantile(0), 1);
+  EXPECT_EQ(digest.Quantile(0.5), 2.5);
+  EXPECT_EQ(digest.Quantile(1), 4);
+  EXPECT_EQ(digest.Quantile(2), 4);
+}
+
+TEST(TDigestTest, Quantiles) {
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> dist(0, 1000);
+  std::vector<double> values;
+  TDigest digest;
+  for (int i = 0; i < 100000; ++i) {
+    values.push_back(dist(gen));
+    digest.Add(values.back());
+  }
+  std::sort(values.begin(), values.end());
+  for (double q : {0.0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 1.0}) {
+    auto exact = values[std::min(values.size() - 1, size_t(q * values.size()))];
+    EXPECT_NEAR(digest.Quantile(q), exact, 5) << q;
+  }
+  // The memory used doesn't grow with the number of values.
+  EXPECT_LT(digest.Serialize().size(), 16 * 1000);
+}
+
+TEST(TDigestTest, Merge) {
+  TDigest all;
+  TDigest low;
+  TDigest high;
+  for (int i = 0; i < 10000; ++i) {
+    all.Add(i);
+    (i < 5000 ? low : high).Add(i);
+  }
+  TDigest merged;
+  merged.Merge(low);
+  EXPECT_TRUE(merged.MergeSerialized(high.Serialize()));
+  EXPECT_TRUE(merged.MergeSerialized(TDigest().Serialize()));
+  EXPECT_FALSE(merged.MergeSerialized("bad"));
+  EXPECT_EQ(merged.Quantile(0), 0);
+  EXPECT_EQ(merged.Quantile(1), 9999);
+  for (double q : {0.1, 0.5, 0.9}) {
+    EXPECT_NEAR(merged.Quantile(q), all.Quantile(q), 50) << q;
+  }
+}
+
+}  // namespace
+
+}  // namespace valkey_search::utils
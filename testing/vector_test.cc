@@ -32,8 +32,10 @@
 #include "src/utils/cancel.h"
 #include "src/utils/string_interning.h"
 #include "testing/common.h"
+#include "third_party/hnswlib/hnswlib.h"
 #include "third_party/hnswlib/space_ip.h"
 #include "third_party/hnswlib/space_l2.h"
+#include "vmsdk/src/huge_pages.h"
 #include "vmsdk/src/managed_pointers.h"
 #include "vmsdk/src/type_conversions.h"
 
@@ -362,6 +364,27 @@ TEST_F(VectorIndexTest, ResizeFlat) ABSL_NO_THREAD_SAFETY_ANALYSIS {
   }
 }
 
+TEST_F(VectorIndexTest, ChunkedArrayHugePageArena) {
+  const size_t huge_page_size = vmsdk::GetHugePageSize();
+  auto stats = vmsdk::GetHugePageArenaStats();
+  vmsdk::SetHugePageArenaEnabled(true);
+  {
+    // Chunks smaller than a huge page come from the heap.
+    hnswlib::ChunkedArray small(huge_page_size / 64, 8, 16);
+    EXPECT_EQ(vmsdk::GetHugePageArenaStats().region_cnt, stats.region_cnt);
+    hnswlib::ChunkedArray large(huge_page_size / 8, 8, 16);
+    vmsdk::SetHugePageArenaEnabled(false);
+    auto arena_stats = vmsdk::GetHugePageArenaStats();
+    if (arena_stats.map_failure_cnt == stats.map_failure_cnt) {
+      EXPECT_EQ(arena_stats.region_cnt, stats.region_cnt + 2);
+      EXPECT_EQ(arena_stats.mapped_bytes,
+                stats.mapped_bytes + 2 * huge_page_size);
+    }
+  }
+  EXPECT_EQ(vmsdk::GetHugePageArenaStats().region_cnt, stats.region_cnt);
+  EXPECT_EQ(vmsdk::GetHugePageArenaStats().mapped_bytes, stats.mapped_bytes);
+}
+
 float CalcRecall(VectorFlat<float>* flat_index, VectorHNSW<float>* hnsw_index,
                  uint64_t k, int dimensions, std::optional<size_t> ef_runtime) {
   auto search_vectors = DeterministicallyGenerateVectors(50, dimensions, 1.5);
@@ -7,6 +7,7 @@
 #ifdef VMSDK_ENABLE_MEMORY_ALLOCATION_OVERRIDES
 #include "vmsdk/src/memory_allocation_overrides.h"  // IWYU pragma: keep
 #endif
+#include "vmsdk/src/huge_pages.h"  // VALKEYSEARCH
 
 // https://github.com/nmslib/hnswlib/pull/508
 // This allows others to provide their own error stream (e.g. RcppHNSW)
@@ -283,10 +284,12 @@ class ChunkedArray {
   }
 
   void clear() {
-    for (auto chunk : chunks_) {
-      delete[] chunk;
+    for (size_t i = 0; i < chunks_.size(); i++) {
+      vmsdk::FreeLargeBuffer(chunks_[i], getSizePerChunk(),
+                             huge_page_chunks_[i]);  // VALKEYSEARCH
     }
     chunks_.clear();
+    huge_page_chunks_.clear();
     element_count_ = 0;
   }
 
@@ -295,8 +298,18 @@ class ChunkedArray {
     size_t new_chunk_count = getChunkCount(new_element_count);
 
     chunks_.resize(new_chunk_count);
+    huge_page_chunks_.resize(new_chunk_count);
     for (size_t i = chunk_count; i < new_chunk_count; i++) {
-      chunks_[i] = new char[elements_per_chunk_ * element_byte_size_];
+      // VALKEYSEARCH: chunks spanning a huge page come from huge pages when
+      // the arena is enabled. Smaller ones, e.g. those of the link lists,
+      // would waste most of the huge page they are rounded up to.
+      bool huge_pages = false;
+      if (getSizePerChunk() >= vmsdk::GetHugePageSize()) {
+        chunks_[i] = vmsdk::AllocateLargeBuffer(getSizePerChunk(), huge_pages);
+      } else {
+        chunks_[i] = new char[getSizePerChunk()];
+      }
+      huge_page_chunks_[i] = huge_pages;
       // Note that we don't initialize the memory on purpose. The caller
       // is expected to track the initialization state.
     }
@@ -312,6 +325,7 @@ class ChunkedArray {
   size_t elements_per_chunk_;
   size_t element_count_;
   std::deque<char *> chunks_;
+  std::vector<bool> huge_page_chunks_;  // VALKEYSEARCH
 };
 
 }  // namespace hnswlib
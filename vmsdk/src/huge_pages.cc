@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#include "vmsdk/src/huge_pages.h"
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+
+#include "absl/base/no_destructor.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/check.h"
+#include "absl/synchronization/mutex.h"
+#include "vmsdk/src/log.h"
+#include "vmsdk/src/memory_allocation.h"
+
+namespace vmsdk {
+
+namespace {
+
+std::atomic<bool> huge_page_arena_enabled{false};
+
+std::atomic<uint64_t> region_cnt{0};
+std::atomic<uint64_t> mapped_bytes{0};
+std::atomic<uint64_t> advised_bytes{0};
+std::atomic<uint64_t> map_failure_cnt{0};
+
+// The regions which the kernel refused to advise, e.g. when transparent huge
+// pages are disabled. Rare, so a set is cheaper than tracking every region.
+absl::Mutex unadvised_regions_mutex;
+absl::NoDestructor<absl::flat_hash_set<char*>> unadvised_regions
+    ABSL_GUARDED_BY(unadvised_regions_mutex);
+
+constexpr size_t kDefaultHugePageSize = 2 * 1024 * 1024;
+// The largest huge page the arena maps buffers on. Buffers are rounded up to
+// whole huge pages, so with larger ones, e.g. 512MB on arm64 with 64KB pages,
+// each allocator chunk would reserve hundreds of megabytes.
+constexpr size_t kMaxArenaHugePageSize = 2 * 1024 * 1024;
+
+size_t ReadHugePageSize() {
+  std::ifstream file("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+  size_t size = 0;
+  // The rounding below relies on a power of two.
+  if (!(file >> size) || size == 0 || (size & (size - 1)) != 0) {
+    return kDefaultHugePageSize;
+  }
+  return size;
+}
+
+size_t RoundUpToHugePage(size_t size) {
+  const size_t huge_page_size = GetHugePageSize();
+  return (size + huge_page_size - 1) & ~(huge_page_size - 1);
+}
+
+}  // namespace
+
+size_t GetHugePageSize() {
+  static const size_t huge_page_size = ReadHugePageSize();
+  return huge_page_size;
+}
+
+void SetHugePageArenaEnabled(bool enabled) {
+  if (enabled && GetHugePageSize() > kMaxArenaHugePageSize) {
+    VMSDK_LOG(WARNING, nullptr)
+        << "The huge page arena stays disabled: huge pages of "
+        << GetHugePageSize() << " bytes exceed its maximum of "
+        << kMaxArenaHugePageSize << " bytes";
+    enabled = false;
+  }
+  huge_page_arena_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsHugePageArenaEnabled() {
+  return huge_page_arena_enabled.load(std::memory_order_relaxed);
+}
+
+char* AllocateHugePages(size_t size) {
+  size_t bytes = RoundUpToHugePage(size);
+  // mmap only aligns to pages: map an extra huge page and trim both ends.
+  size_t map_bytes = bytes + GetHugePageSize();
+  void* mapped = mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    ++map_failure_cnt;
+    return nullptr;
+  }
+  auto start = reinterpret_cast<uintptr_t>(mapped);
+  auto aligned_start = RoundUpToHugePage(start);
+  if (aligned_start > start) {
+    munmap(mapped, aligned_start - start);
+  }
+  auto end = start + map_bytes;
+  auto aligned_end = aligned_start + bytes;
+  if (end > aligned_end) {
+    munmap(reinterpret_cast<void*>(aligned_end), end - aligned_end);
+  }
+  auto ptr = reinterpret_cast<char*>(aligned_start);
+  bool advised = false;
+#ifdef MADV_HUGEPAGE
+  advised = madvise(ptr, bytes, MADV_HUGEPAGE) == 0;
+#endif
+  if (advised) {
+    advised_bytes += bytes;
+  } else {
+    absl::MutexLock lock(&unadvised_regions_mutex);
+    unadvised_regions->insert(ptr);
+  }
+  ++region_cnt;
+  mapped_bytes += bytes;
+  ReportAllocMemorySize(bytes);
+  return ptr;
+}
+
+void FreeHugePages(char* ptr, size_t size) {
+  size_t bytes = RoundUpToHugePage(size);
+  bool advised;
+  {
+    absl::MutexLock lock(&unadvised_regions_mutex);
+    advised = unadvised_regions->erase(ptr) == 0;
+  }
+  if (advised) {
+    advised_bytes -= bytes;
+  }
+  CHECK_EQ(munmap(ptr, bytes), 0);
+  --region_cnt;
+  mapped_bytes -= bytes;
+  ReportFreeMemorySize(bytes);
+}
+
+char* AllocateLargeBuffer(size_t size, bool& huge_pages) {
+  if (IsHugePageArenaEnabled()) {
+    if (auto ptr = AllocateHugePages(size)) {
+      huge_pages = true;
+      return ptr;
+    }
+  }
+  huge_pages = false;
+  // Note: Using new[] to avoid calling constructor of char[].
+  return new char[size];
+}
+
+void FreeLargeBuffer(char* ptr, size_t size, bool huge_pages) {
+  if (huge_pages) {
+    FreeHugePages(ptr, size);
+  } else {
+    delete[] ptr;
+  }
+}
+
+HugePageArenaStats GetHugePageArenaStats() {
+  return HugePageArenaStats{
+      .region_cnt = region_cnt,
+      .mapped_bytes = mapped_bytes,
+      .advised_bytes = advised_bytes,
+      .map_failure_cnt = map_failure_cnt,
+  };
+}
+
+}  // namespace vmsdk
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025, valkey-search contributors
+ * All rights reserved.
+ * SPDX-License-Identifier: BSD 3-Clause
+ *
+ */
+
+#ifndef VMSDK_SRC_HUGE_PAGES_H_
+#define VMSDK_SRC_HUGE_PAGES_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vmsdk {
+
+// The size of a transparent huge page, read once from
+// /sys/kernel/mm/transparent_hugepage/hpage_pmd_size: 2MB on x86-64, but e.g.
+// 512MB on arm64 with 64KB pages. Falls back to 2MB where it can't be read.
+size_t GetHugePageSize();
+
+// Whether large, long lived buffers, such as the chunks holding vectors and
+// graphs, should be allocated with AllocateHugePages. Off by default: huge
+// pages cut TLB misses when scanning large indexes, but each write after a
+// fork copies a whole huge page. Stays off, with a warning, where huge pages
+// exceed 2MB, as every buffer would reserve at least one.
+void SetHugePageArenaEnabled(bool enabled);
+bool IsHugePageArenaEnabled();
+
+// Maps at least `size` bytes, rounded up to whole huge pages and aligned to a
+// huge page, and advises the kernel to back them with transparent huge pages.
+// The memory is reported as used. Returns null if the mapping fails.
+char* AllocateHugePages(size_t size);
+// Unmaps memory of AllocateHugePages, given the same size.
+void FreeHugePages(char* ptr, size_t size);
+
+// Allocates a buffer of `size` bytes, from huge pages if the arena is enabled
+// and the mapping succeeds, else from the heap. Sets `huge_pages` to where the
+// buffer came from, to be passed to FreeLargeBuffer with the same size.
+char* AllocateLargeBuffer(size_t size, bool& huge_pages);
+void FreeLargeBuffer(char* ptr, size_t size, bool huge_pages);
+
+struct HugePageArenaStats {
+  // The mapped regions, and the bytes they span.
+  uint64_t region_cnt{0};
+  uint64_t mapped_bytes{0};
+  // The mapped bytes which the kernel was advised to back by huge pages.
+  uint64_t advised_bytes{0};
+  // Mappings which failed, making the buffers fall back to the heap.
+  uint64_t map_failure_cnt{0};
+};
+HugePageArenaStats GetHugePageArenaStats();
+
+}  // namespace vmsdk
+
+#endif  // VMSDK_SRC_HUGE_PAGES_H_
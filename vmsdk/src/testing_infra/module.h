@@ -151,6 +151,9 @@ class MockValkeyModule {
   MOCK_METHOD(ValkeyModuleCtx *, GetThreadSafeContext,
               (ValkeyModuleBlockedClient * bc));
   MOCK_METHOD(void, FreeThreadSafeContext, (ValkeyModuleCtx * ctx));
+  MOCK_METHOD(void, ThreadSafeContextLock, (ValkeyModuleCtx * ctx));
+  MOCK_METHOD(int, ThreadSafeContextTryLock, (ValkeyModuleCtx * ctx));
+  MOCK_METHOD(void, ThreadSafeContextUnlock, (ValkeyModuleCtx * ctx));
   MOCK_METHOD(int, SelectDb, (ValkeyModuleCtx * ctx, int newid));
   MOCK_METHOD(int, GetSelectedDb, (ValkeyModuleCtx * ctx));
   MOCK_METHOD(void *, ModuleTypeGetValue, (ValkeyModuleKey * key));
@@ -929,6 +932,18 @@ inline void TestValkeyModule_FreeThreadSafeContext(ValkeyModuleCtx *ctx) {
   return kMockValkeyModule->FreeThreadSafeContext(ctx);
 }
 
+inline void TestValkeyModule_ThreadSafeContextLock(ValkeyModuleCtx *ctx) {
+  return kMockValkeyModule->ThreadSafeContextLock(ctx);
+}
+
+inline int TestValkeyModule_ThreadSafeContextTryLock(ValkeyModuleCtx *ctx) {
+  return kMockValkeyModule->ThreadSafeContextTryLock(ctx);
+}
+
+inline void TestValkeyModule_ThreadSafeContextUnlock(ValkeyModuleCtx *ctx) {
+  return kMockValkeyModule->ThreadSafeContextUnlock(ctx);
+}
+
 inline int TestValkeyModule_SelectDb(ValkeyModuleCtx *ctx, int newid) {
   return kMockValkeyModule->SelectDb(ctx, newid);
 }
@@ -1522,6 +1537,11 @@ inline void TestValkeyModule_Init() {
       &TestValkeyModule_GetDetachedThreadSafeContext;
   ValkeyModule_GetThreadSafeContext = &TestValkeyModule_GetThreadSafeContext;
   ValkeyModule_FreeThreadSafeContext = &TestValkeyModule_FreeThreadSafeContext;
+  ValkeyModule_ThreadSafeContextLock = &TestValkeyModule_ThreadSafeContextLock;
+  ValkeyModule_ThreadSafeContextTryLock =
+      &TestValkeyModule_ThreadSafeContextTryLock;
+  ValkeyModule_ThreadSafeContextUnlock =
+      &TestValkeyModule_ThreadSafeContextUnlock;
   ValkeyModule_SelectDb = &TestValkeyModule_SelectDb;
   ValkeyModule_GetSelectedDb = &TestValkeyModule_GetSelectedDb;
   ValkeyModule_ModuleTypeGetValue = &TestValkeyModule_ModuleTypeGetValue;
@@ -27,6 +27,9 @@
 
 namespace {
 
+// The pool which the current thread works for, if any.
+thread_local vmsdk::ThreadPool *current_pool = nullptr;
+
 class ThreadRunContext {
  public:
   ThreadRunContext(vmsdk::ThreadPool *pool,
@@ -204,7 +207,20 @@ void ThreadPool::AwaitSuspensionCleared()
   }
 }
 
+bool ThreadPool::YieldToSuspension() {
+  if (current_pool == nullptr) {
+    return false;
+  }
+  absl::MutexLock lock(&current_pool->queue_mutex_);
+  if (!current_pool->suspend_workers_) {
+    return false;
+  }
+  current_pool->AwaitSuspensionCleared();
+  return true;
+}
+
 void ThreadPool::WorkerThread(std::shared_ptr<Thread> thread) {
+  current_pool = this;
   while (true) {
     absl::AnyInvocable<void()> task;
     {
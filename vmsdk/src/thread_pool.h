@@ -66,6 +66,11 @@ class ThreadPool {
     return suspend_workers_;
   }
   absl::Status ResumeWorkers();
+  /// Called by a task waiting on something which the thread suspending its
+  /// pool may hold, such as the GIL at fork. If a suspension is pending, the
+  /// calling worker counts as suspended until the pool resumes. Returns
+  /// whether it waited; off the workers of a pool, it never does.
+  static bool YieldToSuspension();
   virtual ~ThreadPool();
 
   size_t Size() const { return threads_.Size(); }